@@ -0,0 +1,189 @@
+/*
+ * This source file is part of the Swift.org open source project
+ *
+ * Copyright (c) 2026 Apple Inc. and the Swift project authors
+ *
+ * Licensed under Apache License v2.0 with Runtime Library Exception
+ *
+ * See https://swift.org/LICENSE.txt for license information
+ * See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+ *
+ */
+
+#include "dispatch_bench.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Throughput is reported per 4 KiB page moved, rounds move 1 MiB each
+#define DBENCH_IO_PAGE_SIZE		4096u
+#define DBENCH_IO_ROUND_SIZE	(256u * DBENCH_IO_PAGE_SIZE)
+
+typedef struct dbench_io_s {
+	dispatch_semaphore_t dio_sema;
+	dispatch_queue_t dio_queue;
+	dispatch_data_t dio_data;
+	int dio_fd;
+	int volatile dio_error;
+	char dio_path[64];
+} dbench_io_s;
+
+static void
+_dbench_io_setup(dbench_t b, dbench_io_s *dio)
+{
+	void *buf = malloc(DBENCH_IO_ROUND_SIZE);
+	const char *tmpdir = getenv("TMPDIR");
+
+	if (!buf) dbench_fail(b, "malloc() failed");
+	memset(buf, 0xa5, DBENCH_IO_ROUND_SIZE);
+	dio->dio_data = dispatch_data_create(buf, DBENCH_IO_ROUND_SIZE, NULL,
+			DISPATCH_DATA_DESTRUCTOR_FREE);
+
+	snprintf(dio->dio_path, sizeof(dio->dio_path), "%s/dispatch-bench.XXXXXX",
+			tmpdir && strlen(tmpdir) < 32 ? tmpdir : "/tmp");
+	dio->dio_fd = mkstemp(dio->dio_path);
+	if (dio->dio_fd < 0) dbench_fail(b, "mkstemp() failed");
+	unlink(dio->dio_path);
+
+	dio->dio_sema = dispatch_semaphore_create(0);
+	dio->dio_queue = dispatch_queue_create("dispatch-bench.io", NULL);
+	dio->dio_error = 0;
+}
+
+static void
+_dbench_io_teardown(dbench_io_s *dio)
+{
+	dispatch_release(dio->dio_data);
+	dispatch_release(dio->dio_sema);
+	dispatch_release(dio->dio_queue);
+	close(dio->dio_fd);
+}
+
+static void
+_dbench_io_done(void *ctxt, dispatch_data_t data, int error)
+{
+	dbench_io_s *dio = ctxt;
+	(void)data;
+	if (error) dio->dio_error = error;
+	dispatch_semaphore_signal(dio->dio_sema);
+}
+
+static void
+_dbench_io_write_round(dbench_t b, dbench_io_s *dio)
+{
+	if (lseek(dio->dio_fd, 0, SEEK_SET) < 0) {
+		dbench_fail(b, "lseek() failed");
+	}
+	dispatch_write_f(dio->dio_fd, dio->dio_data, dio->dio_queue, dio,
+			_dbench_io_done);
+	dispatch_semaphore_wait(dio->dio_sema, DISPATCH_TIME_FOREVER);
+	if (dio->dio_error) dbench_fail(b, "dispatch_write_f() failed");
+}
+
+#pragma mark -
+#pragma mark dispatch_read / dispatch_write
+
+// One round: 1 MiB written through dispatch_write_f
+static void
+dbench_io_write(dbench_t b, uintptr_t arg)
+{
+	dbench_io_s dio;
+	(void)arg;
+
+	_dbench_io_setup(b, &dio);
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		_dbench_io_write_round(b, &dio);
+		dbench_record(b, dbench_now() - start,
+				DBENCH_IO_ROUND_SIZE / DBENCH_IO_PAGE_SIZE);
+	}
+	_dbench_io_teardown(&dio);
+}
+
+// One round: 1 MiB read back through dispatch_read_f
+static void
+dbench_io_read(dbench_t b, uintptr_t arg)
+{
+	dbench_io_s dio;
+	(void)arg;
+
+	_dbench_io_setup(b, &dio);
+	_dbench_io_write_round(b, &dio);
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		if (lseek(dio.dio_fd, 0, SEEK_SET) < 0) {
+			dbench_fail(b, "lseek() failed");
+		}
+		uint64_t start = dbench_now();
+		dispatch_read_f(dio.dio_fd, DBENCH_IO_ROUND_SIZE, dio.dio_queue, &dio,
+				_dbench_io_done);
+		dispatch_semaphore_wait(dio.dio_sema, DISPATCH_TIME_FOREVER);
+		if (dio.dio_error) dbench_fail(b, "dispatch_read_f() failed");
+		dbench_record(b, dbench_now() - start,
+				DBENCH_IO_ROUND_SIZE / DBENCH_IO_PAGE_SIZE);
+	}
+	_dbench_io_teardown(&dio);
+}
+
+#pragma mark -
+#pragma mark dispatch_io channels
+
+static void
+_dbench_io_channel_cleanup(void *ctxt, int error)
+{
+	dbench_io_s *dio = ctxt;
+	(void)error;
+	dispatch_semaphore_signal(dio->dio_sema);
+}
+
+static void
+_dbench_io_channel_handler(void *ctxt, bool done, dispatch_data_t data,
+		int error)
+{
+	dbench_io_s *dio = ctxt;
+	(void)data;
+	if (error) dio->dio_error = error;
+	if (done) dispatch_semaphore_signal(dio->dio_sema);
+}
+
+// One round: 1 MiB read from a random-access channel with a page sized
+// low-water mark, so that the handler runs once per page
+static void
+dbench_io_channel_read(dbench_t b, uintptr_t arg)
+{
+	dbench_io_s dio;
+	(void)arg;
+
+	_dbench_io_setup(b, &dio);
+	_dbench_io_write_round(b, &dio);
+
+	dispatch_io_t channel = dispatch_io_create_f(DISPATCH_IO_RANDOM,
+			dio.dio_fd, dio.dio_queue, &dio, _dbench_io_channel_cleanup);
+	if (!channel) dbench_fail(b, "dispatch_io_create_f() failed");
+	dispatch_io_set_low_water(channel, DBENCH_IO_PAGE_SIZE);
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		dispatch_io_read_f(channel, 0, DBENCH_IO_ROUND_SIZE, dio.dio_queue,
+				&dio, _dbench_io_channel_handler);
+		dispatch_semaphore_wait(dio.dio_sema, DISPATCH_TIME_FOREVER);
+		if (dio.dio_error) dbench_fail(b, "dispatch_io_read_f() failed");
+		dbench_record(b, dbench_now() - start,
+				DBENCH_IO_ROUND_SIZE / DBENCH_IO_PAGE_SIZE);
+	}
+
+	dispatch_io_close(channel, 0);
+	dispatch_release(channel);
+	// the channel owns the descriptor until its cleanup handler has run
+	dispatch_semaphore_wait(dio.dio_sema, DISPATCH_TIME_FOREVER);
+	_dbench_io_teardown(&dio);
+}
+
+const dbench_case_s dbench_io_cases[] = {
+	DBENCH_CASE("io.write", dbench_io_write, 0),
+	DBENCH_CASE("io.read", dbench_io_read, 0),
+	DBENCH_CASE("io.channel.read", dbench_io_channel_read, 0),
+	{ .dbc_name = NULL },
+};
@@ -0,0 +1,1239 @@
+/*
+ * This source file is part of the Swift.org open source project
+ *
+ * Copyright (c) 2026 Apple Inc. and the Swift project authors
+ *
+ * Licensed under Apache License v2.0 with Runtime Library Exception
+ *
+ * See https://swift.org/LICENSE.txt for license information
+ * See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+ *
+ */
+
+#include "dispatch_bench.h"
+#include <dispatch/trace_ring_private.h>
+
+#include <sys/resource.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+enum {
+	DBENCH_QUEUE_SERIAL,
+	DBENCH_QUEUE_CONCURRENT,
+	DBENCH_QUEUE_GLOBAL,
+	DBENCH_QUEUE_COOPERATIVE,
+};
+
+typedef struct dbench_countdown_s {
+	dispatch_semaphore_t dcd_sema;
+	size_t volatile dcd_remaining;
+} dbench_countdown_s;
+
+static dispatch_queue_t
+_dbench_queue_create(uintptr_t kind)
+{
+	switch (kind) {
+	case DBENCH_QUEUE_SERIAL:
+		return dispatch_queue_create("dispatch-bench.serial",
+				DISPATCH_QUEUE_SERIAL);
+	case DBENCH_QUEUE_CONCURRENT:
+		return dispatch_queue_create("dispatch-bench.concurrent",
+				DISPATCH_QUEUE_CONCURRENT);
+	case DBENCH_QUEUE_COOPERATIVE:
+		return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,
+				DISPATCH_QUEUE_COOPERATIVE);
+	default:
+		return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+	}
+}
+
+static void
+_dbench_queue_release(dispatch_queue_t dq, uintptr_t kind)
+{
+	if (kind == DBENCH_QUEUE_SERIAL || kind == DBENCH_QUEUE_CONCURRENT) {
+		dispatch_release(dq);
+	}
+}
+
+static void
+_dbench_countdown(void *ctxt)
+{
+	dbench_countdown_s *dcd = ctxt;
+	if (__atomic_sub_fetch(&dcd->dcd_remaining, 1, __ATOMIC_ACQ_REL) == 0) {
+		dispatch_semaphore_signal(dcd->dcd_sema);
+	}
+}
+
+#pragma mark -
+#pragma mark dispatch_async
+
+// One round: submit a batch of trivial items and wait for the last one
+static void
+dbench_async(dbench_t b, uintptr_t kind)
+{
+	dispatch_queue_t dq = _dbench_queue_create(kind);
+	dbench_countdown_s dcd = { .dcd_sema = dispatch_semaphore_create(0) };
+	size_t batch = dbench_batch(b);
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		dcd.dcd_remaining = batch;
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			dispatch_async_f(dq, &dcd, _dbench_countdown);
+		}
+		dispatch_semaphore_wait(dcd.dcd_sema, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	dispatch_release(dcd.dcd_sema);
+	_dbench_queue_release(dq, kind);
+}
+
+// One round: the same batch as dbench_async, submitted with a single
+// dispatch_async_batch_f call
+static void
+dbench_async_batch(dbench_t b, uintptr_t kind)
+{
+	dispatch_queue_t dq = _dbench_queue_create(kind);
+	dbench_countdown_s dcd = { .dcd_sema = dispatch_semaphore_create(0) };
+	size_t batch = dbench_batch(b);
+	void **contexts = calloc(batch, sizeof(void *));
+
+	if (!contexts) dbench_fail(b, "calloc() failed");
+	for (size_t j = 0; j < batch; j++) {
+		contexts[j] = &dcd;
+	}
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		dcd.dcd_remaining = batch;
+		uint64_t start = dbench_now();
+		dispatch_async_batch_f(dq, batch, contexts, _dbench_countdown);
+		dispatch_semaphore_wait(dcd.dcd_sema, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	free(contexts);
+	dispatch_release(dcd.dcd_sema);
+	_dbench_queue_release(dq, kind);
+}
+
+// One round: the same batch as dbench_async, submitted as blocks, which are
+// small enough for dispatch_async to copy them into their continuation
+static void
+dbench_async_block(dbench_t b, uintptr_t kind)
+{
+	dispatch_queue_t dq = _dbench_queue_create(kind);
+	dbench_countdown_s dcd = { .dcd_sema = dispatch_semaphore_create(0) };
+	dbench_countdown_s *dcdp = &dcd;
+	size_t batch = dbench_batch(b);
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		dcd.dcd_remaining = batch;
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			dispatch_async(dq, ^{
+				_dbench_countdown(dcdp);
+			});
+		}
+		dispatch_semaphore_wait(dcd.dcd_sema, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	dispatch_release(dcd.dcd_sema);
+	_dbench_queue_release(dq, kind);
+}
+
+// Same as dbench_async_block, with a __block variable per item that is
+// copied to the heap along with the block
+static void
+dbench_async_block_byref(dbench_t b, uintptr_t kind)
+{
+	dispatch_queue_t dq = _dbench_queue_create(kind);
+	dbench_countdown_s dcd = { .dcd_sema = dispatch_semaphore_create(0) };
+	dbench_countdown_s *dcdp = &dcd;
+	size_t batch = dbench_batch(b);
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		dcd.dcd_remaining = batch;
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			__block size_t ran = 0;
+			dispatch_async(dq, ^{
+				dbench_sink = ++ran;
+				_dbench_countdown(dcdp);
+			});
+		}
+		dispatch_semaphore_wait(dcd.dcd_sema, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	dispatch_release(dcd.dcd_sema);
+	_dbench_queue_release(dq, kind);
+}
+
+// Captured by value, so that the block is too large to be copied into its
+// continuation and dispatch_async has to Block_copy() it to the heap
+typedef struct dbench_block_payload_s {
+	uintptr_t dbp_words[16];
+} dbench_block_payload_s;
+
+// Same as dbench_async_block, with a block that captures a
+// dbench_block_payload_s
+static void
+dbench_async_block_large(dbench_t b, uintptr_t kind)
+{
+	dispatch_queue_t dq = _dbench_queue_create(kind);
+	dbench_countdown_s dcd = { .dcd_sema = dispatch_semaphore_create(0) };
+	dbench_countdown_s *dcdp = &dcd;
+	dbench_block_payload_s payload = { .dbp_words = { 0 } };
+	size_t batch = dbench_batch(b);
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		dcd.dcd_remaining = batch;
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			payload.dbp_words[0] = j;
+			dispatch_async(dq, ^{
+				dbench_sink = payload.dbp_words[0];
+				_dbench_countdown(dcdp);
+			});
+		}
+		dispatch_semaphore_wait(dcd.dcd_sema, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	dispatch_release(dcd.dcd_sema);
+	_dbench_queue_release(dq, kind);
+}
+
+// One round: a single item, measures submit-to-execution latency
+static void
+dbench_async_latency(dbench_t b, uintptr_t kind)
+{
+	dispatch_queue_t dq = _dbench_queue_create(kind);
+	dbench_countdown_s dcd = { .dcd_sema = dispatch_semaphore_create(0) };
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		dcd.dcd_remaining = 1;
+		uint64_t start = dbench_now();
+		dispatch_async_f(dq, &dcd, _dbench_countdown);
+		dispatch_semaphore_wait(dcd.dcd_sema, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, 1);
+	}
+	dispatch_release(dcd.dcd_sema);
+	_dbench_queue_release(dq, kind);
+}
+
+#pragma mark -
+#pragma mark continuation depot
+
+// One round: the calling thread allocates a batch of work items that are all
+// freed by the worker draining the queue, which is the pattern the
+// continuation depot is meant for. The depot hit rate over the run is
+// printed on stderr.
+static void
+dbench_async_cross_thread(dbench_t b, uintptr_t kind)
+{
+	dispatch_continuation_depot_stats_s before, after;
+
+	_dispatch_continuation_depot_get_stats(&before);
+	dbench_async(b, kind);
+	_dispatch_continuation_depot_get_stats(&after);
+
+	uint64_t hits = after.dcds_hits - before.dcds_hits;
+	uint64_t misses = after.dcds_misses - before.dcds_misses;
+	fprintf(stderr, "continuation depot: %llu hits, %llu misses (%.1f%%), "
+			"%llu returns, %llu overflows\n", (unsigned long long)hits,
+			(unsigned long long)misses,
+			hits + misses ? 100.0 * (double)hits / (double)(hits + misses) : 0,
+			(unsigned long long)(after.dcds_returns - before.dcds_returns),
+			(unsigned long long)(after.dcds_overflows - before.dcds_overflows));
+}
+
+// One round of dbench_async_block, or of dbench_async_block_large when
+// `large` is set, on the global queue. The heap allocations per item are
+// printed on stderr: a continuation comes from the heap when both the thread
+// cache and the depot are empty, and each block that isn't copied into its
+// continuation costs a Block_copy() allocation on top.
+static void
+dbench_async_block_allocs(dbench_t b, uintptr_t large)
+{
+	dispatch_continuation_depot_stats_s before, after;
+	dispatch_continuation_depot_stats_s inline_before, inline_after;
+	uint64_t items = (uint64_t)dbench_samples(b) * dbench_batch(b);
+	uint64_t heap, copies;
+
+	_dispatch_continuation_depot_get_stats(&before);
+	_dispatch_continuation_inline_depot_get_stats(&inline_before);
+	if (large) {
+		dbench_async_block_large(b, DBENCH_QUEUE_GLOBAL);
+	} else {
+		dbench_async_block(b, DBENCH_QUEUE_GLOBAL);
+	}
+	_dispatch_continuation_depot_get_stats(&after);
+	_dispatch_continuation_inline_depot_get_stats(&inline_after);
+
+	heap = (after.dcds_misses - before.dcds_misses) +
+			(inline_after.dcds_misses - inline_before.dcds_misses);
+	// nothing ever went through the inline depot: blocks aren't inlined
+	copies = large || !(inline_after.dcds_hits + inline_after.dcds_misses) ?
+			items : 0;
+	fprintf(stderr, "%llu items: %llu continuations from the heap, "
+			"%llu block copies, %.3f allocations per dispatch_async\n",
+			(unsigned long long)items, (unsigned long long)heap,
+			(unsigned long long)copies,
+			items ? (double)(heap + copies) / (double)items : 0);
+}
+
+#pragma mark -
+#pragma mark cooperative pool
+
+// Every task burns DBENCH_COOP_SLICES slices of DBENCH_COOP_SPINS iterations
+#define DBENCH_COOP_SLICES	16u
+#define DBENCH_COOP_SPINS	20000u
+
+typedef struct dbench_coop_task_s {
+	dispatch_queue_t dct_queue;
+	dbench_countdown_s *dct_countdown;
+	unsigned int dct_slice;
+} dbench_coop_task_s;
+
+static void
+_dbench_coop_task(void *ctxt)
+{
+	dbench_coop_task_s *dct = ctxt;
+	uint64_t x = (uintptr_t)dct;
+
+	while (dct->dct_slice < DBENCH_COOP_SLICES) {
+		for (unsigned int i = 0; i < DBENCH_COOP_SPINS; i++) {
+			x = x * 6364136223846793005ull + 1442695040888963407ull;
+		}
+		dbench_sink += (uintptr_t)x;
+		if (++dct->dct_slice < DBENCH_COOP_SLICES &&
+				dispatch_cooperative_yield()) {
+			// let the items queued behind us run, and resume later
+			dispatch_async_f(dct->dct_queue, dct, _dbench_coop_task);
+			return;
+		}
+	}
+	_dbench_countdown(dct->dct_countdown);
+}
+
+static uint64_t
+_dbench_context_switches(void)
+{
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) < 0) return 0;
+	return (uint64_t)ru.ru_nvcsw + (uint64_t)ru.ru_nivcsw;
+}
+
+// One round: four CPU-bound tasks per CPU, on the regular or cooperative
+// global queue. Tasks poll dispatch_cooperative_yield() between slices, which
+// is a no-op on the regular queue. The number of context switches per task
+// over the run is printed on stderr.
+static void
+dbench_cooperative_cpu(dbench_t b, uintptr_t kind)
+{
+	dispatch_queue_t dq = _dbench_queue_create(kind);
+	dbench_countdown_s dcd = { .dcd_sema = dispatch_semaphore_create(0) };
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t ntasks = 4 * (size_t)(ncpus > 0 ? ncpus : 1);
+	dbench_coop_task_s *tasks = calloc(ntasks, sizeof(*tasks));
+	uint64_t csw = _dbench_context_switches();
+
+	if (!tasks) dbench_fail(b, "calloc() failed");
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		dcd.dcd_remaining = ntasks;
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < ntasks; j++) {
+			tasks[j].dct_queue = dq;
+			tasks[j].dct_countdown = &dcd;
+			tasks[j].dct_slice = 0;
+			dispatch_async_f(dq, &tasks[j], _dbench_coop_task);
+		}
+		dispatch_semaphore_wait(dcd.dcd_sema, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, ntasks);
+	}
+	csw = _dbench_context_switches() - csw;
+	fprintf(stderr, "context switches: %llu (%.2f per task)\n",
+			(unsigned long long)csw,
+			(double)csw / (double)(ntasks * dbench_samples(b)));
+
+	free(tasks);
+	dispatch_release(dcd.dcd_sema);
+	_dbench_queue_release(dq, kind);
+}
+
+#pragma mark -
+#pragma mark actors
+
+// Each actor owns DBENCH_ACTOR_STATE bytes that every message walks, and
+// messages hop DBENCH_ACTOR_HOPS times around the ring of actors
+#define DBENCH_ACTOR_COUNT	16u
+#define DBENCH_ACTOR_STATE	4096u
+#define DBENCH_ACTOR_HOPS	64u
+#define DBENCH_ACTOR_MESSAGES	8u // in flight per actor
+
+typedef struct dbench_actor_s {
+	dispatch_queue_t da_queue;
+	uint64_t da_state[DBENCH_ACTOR_STATE / sizeof(uint64_t)];
+} dbench_actor_s;
+
+static dbench_actor_s *_dbench_actors;
+static dbench_countdown_s _dbench_actor_countdown;
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+// perf counters only follow the thread that opened them, so every worker
+// which runs a message opens its own, and they are summed at the end
+#define DBENCH_ACTOR_MAX_THREADS 256u
+
+static int _dbench_actor_perf_fds[DBENCH_ACTOR_MAX_THREADS];
+static unsigned int _dbench_actor_perf_count;
+static bool _dbench_actor_perf_enabled;
+static __thread bool _dbench_actor_perf_opened;
+
+static void
+_dbench_actor_perf_open(void)
+{
+	struct perf_event_attr attr = {
+		.type = PERF_TYPE_HW_CACHE,
+		.size = sizeof(attr),
+		.config = PERF_COUNT_HW_CACHE_L1D |
+				(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				(PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		.exclude_kernel = 1,
+		.exclude_hv = 1,
+	};
+	unsigned int idx;
+	int fd;
+
+	_dbench_actor_perf_opened = true;
+	if (!__atomic_load_n(&_dbench_actor_perf_enabled, __ATOMIC_RELAXED)) {
+		return;
+	}
+	fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+	if (fd < 0) return;
+	idx = __atomic_fetch_add(&_dbench_actor_perf_count, 1, __ATOMIC_RELAXED);
+	if (idx >= DBENCH_ACTOR_MAX_THREADS) {
+		close(fd);
+		return;
+	}
+	_dbench_actor_perf_fds[idx] = fd;
+}
+
+static void
+_dbench_actor_perf_start(void)
+{
+	_dbench_actor_perf_count = 0;
+	__atomic_store_n(&_dbench_actor_perf_enabled, true, __ATOMIC_RELAXED);
+}
+
+// Returns false when no counter could be opened (no PMU, or
+// perf_event_paranoid forbids it)
+static bool
+_dbench_actor_perf_stop(uint64_t *misses)
+{
+	unsigned int count = _dbench_actor_perf_count;
+	uint64_t total = 0, value;
+
+	__atomic_store_n(&_dbench_actor_perf_enabled, false, __ATOMIC_RELAXED);
+	if (count > DBENCH_ACTOR_MAX_THREADS) count = DBENCH_ACTOR_MAX_THREADS;
+	for (unsigned int i = 0; i < count; i++) {
+		if (read(_dbench_actor_perf_fds[i], &value, sizeof(value)) ==
+				(ssize_t)sizeof(value)) {
+			total += value;
+		}
+		close(_dbench_actor_perf_fds[i]);
+	}
+	*misses = total;
+	return count > 0;
+}
+#else
+static void _dbench_actor_perf_start(void) { }
+
+static bool
+_dbench_actor_perf_stop(uint64_t *misses)
+{
+	*misses = 0;
+	return false;
+}
+#endif
+
+static void
+_dbench_actor_message(void *ctxt)
+{
+	uintptr_t msg = (uintptr_t)ctxt;
+	uintptr_t actor = msg % DBENCH_ACTOR_COUNT;
+	uintptr_t hops = msg / DBENCH_ACTOR_COUNT;
+	dbench_actor_s *da = &_dbench_actors[actor];
+	uint64_t x = msg;
+
+#if defined(__linux__)
+	if (!_dbench_actor_perf_opened) _dbench_actor_perf_open();
+#endif
+	for (size_t i = 0; i < DBENCH_ACTOR_STATE / sizeof(uint64_t); i++) {
+		x = x * 6364136223846793005ull + da->da_state[i];
+		da->da_state[i] = x;
+	}
+	dbench_sink += (uintptr_t)x;
+
+	if (hops == 0) {
+		return _dbench_countdown(&_dbench_actor_countdown);
+	}
+	actor = (actor + 1) % DBENCH_ACTOR_COUNT;
+	msg = (hops - 1) * DBENCH_ACTOR_COUNT + actor;
+	dispatch_async_f(_dbench_actors[actor].da_queue, (void *)msg,
+			_dbench_actor_message);
+}
+
+// One round: DBENCH_ACTOR_MESSAGES messages per actor, each hopping
+// DBENCH_ACTOR_HOPS times around a ring of serial queues which own some
+// state, optionally marked sticky. L1D read misses per message are printed
+// on stderr where perf counters are available, context switches otherwise.
+static void
+dbench_actor_ring(dbench_t b, uintptr_t sticky)
+{
+	size_t nmsgs = DBENCH_ACTOR_COUNT * DBENCH_ACTOR_MESSAGES;
+	uint64_t csw = _dbench_context_switches(), misses;
+
+	_dbench_actors = calloc(DBENCH_ACTOR_COUNT, sizeof(dbench_actor_s));
+	if (!_dbench_actors) dbench_fail(b, "calloc() failed");
+	_dbench_actor_countdown.dcd_sema = dispatch_semaphore_create(0);
+	for (size_t i = 0; i < DBENCH_ACTOR_COUNT; i++) {
+		dispatch_queue_t dq = dispatch_queue_create("dispatch-bench.actor",
+				DISPATCH_QUEUE_SERIAL);
+		if (sticky) dispatch_queue_set_sticky(dq, true);
+		_dbench_actors[i].da_queue = dq;
+	}
+
+	_dbench_actor_perf_start();
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		_dbench_actor_countdown.dcd_remaining = nmsgs;
+		uint64_t start = dbench_now();
+		for (uintptr_t j = 0; j < nmsgs; j++) {
+			uintptr_t actor = j % DBENCH_ACTOR_COUNT;
+			dispatch_async_f(_dbench_actors[actor].da_queue,
+					(void *)(DBENCH_ACTOR_HOPS * DBENCH_ACTOR_COUNT + actor),
+					_dbench_actor_message);
+		}
+		dispatch_semaphore_wait(_dbench_actor_countdown.dcd_sema,
+				DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start,
+				nmsgs * (DBENCH_ACTOR_HOPS + 1));
+	}
+	nmsgs *= (DBENCH_ACTOR_HOPS + 1) * dbench_samples(b);
+	if (_dbench_actor_perf_stop(&misses)) {
+		fprintf(stderr, "L1D read misses: %llu (%.2f per message)\n",
+				(unsigned long long)misses, (double)misses / (double)nmsgs);
+	} else {
+		csw = _dbench_context_switches() - csw;
+		fprintf(stderr, "context switches: %llu (%.4f per message)\n",
+				(unsigned long long)csw, (double)csw / (double)nmsgs);
+	}
+
+	for (size_t i = 0; i < DBENCH_ACTOR_COUNT; i++) {
+		dispatch_release(_dbench_actors[i].da_queue);
+	}
+	dispatch_release(_dbench_actor_countdown.dcd_sema);
+	free(_dbench_actors);
+	_dbench_actors = NULL;
+}
+
+#define DBENCH_STICKY_IDLE_ITEMS	64u
+#define DBENCH_STICKY_IDLE_GAP_US	1000u
+
+typedef struct dbench_sticky_idle_s {
+	dispatch_semaphore_t dsi_sema;
+	int dsi_last_cpu;
+	size_t dsi_kept;
+	size_t dsi_drains;
+} dbench_sticky_idle_s;
+
+static void
+_dbench_sticky_idle_item(void *ctxt)
+{
+	dbench_sticky_idle_s *dsi = ctxt;
+#if defined(__linux__)
+	int cpu = sched_getcpu();
+#else
+	int cpu = -1;
+#endif
+
+	if (cpu >= 0 && dsi->dsi_last_cpu >= 0) {
+		dsi->dsi_drains++;
+		if (cpu == dsi->dsi_last_cpu) dsi->dsi_kept++;
+	}
+	dsi->dsi_last_cpu = cpu;
+	dispatch_semaphore_signal(dsi->dsi_sema);
+}
+
+// One round: DBENCH_STICKY_IDLE_ITEMS items submitted one at a time to a
+// serial queue, optionally sticky, with a pause before each so that the
+// pool is idle when it is pushed. How often an item ran on the CPU of the
+// previous one is printed on stderr where the CPU number is available.
+static void
+dbench_sticky_idle(dbench_t b, uintptr_t sticky)
+{
+	dbench_sticky_idle_s dsi = { .dsi_last_cpu = -1 };
+	dispatch_queue_t dq = dispatch_queue_create("dispatch-bench.sticky",
+			DISPATCH_QUEUE_SERIAL);
+
+	if (sticky) dispatch_queue_set_sticky(dq, true);
+	dsi.dsi_sema = dispatch_semaphore_create(0);
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t elapsed = 0;
+		for (size_t j = 0; j < DBENCH_STICKY_IDLE_ITEMS; j++) {
+			usleep(DBENCH_STICKY_IDLE_GAP_US);
+			uint64_t start = dbench_now();
+			dispatch_async_f(dq, &dsi, _dbench_sticky_idle_item);
+			dispatch_semaphore_wait(dsi.dsi_sema, DISPATCH_TIME_FOREVER);
+			elapsed += dbench_now() - start;
+		}
+		dbench_record(b, elapsed, DBENCH_STICKY_IDLE_ITEMS);
+	}
+	if (dsi.dsi_drains) {
+		fprintf(stderr, "kept CPU: %zu of %zu items (%.1f%%)\n",
+				dsi.dsi_kept, dsi.dsi_drains,
+				100.0 * (double)dsi.dsi_kept / (double)dsi.dsi_drains);
+	}
+
+	dispatch_release(dq);
+	dispatch_release(dsi.dsi_sema);
+}
+
+#pragma mark -
+#pragma mark bounded queues
+
+#define DBENCH_BOUNDED_ITEMS	100000u
+#define DBENCH_BOUNDED_CAPACITY	256u
+#define DBENCH_BOUNDED_SPINS	200u // the consumer is a bit slower
+
+enum {
+	DBENCH_BOUNDED_NONE,
+	DBENCH_BOUNDED_TRY,
+	DBENCH_BOUNDED_BLOCK,
+	DBENCH_BOUNDED_DROP_OLDEST,
+};
+
+static size_t volatile _dbench_bounded_consumed;
+static size_t volatile _dbench_bounded_dropped;
+
+static void
+_dbench_bounded_consume(void *ctxt)
+{
+	uint64_t x = (uintptr_t)ctxt;
+	for (unsigned int i = 0; i < DBENCH_BOUNDED_SPINS; i++) {
+		x = x * 6364136223846793005ull + 1442695040888963407ull;
+	}
+	dbench_sink += (uintptr_t)x;
+	__atomic_fetch_add(&_dbench_bounded_consumed, 1, __ATOMIC_RELAXED);
+}
+
+static void
+_dbench_bounded_drop(void *ctxt)
+{
+	(void)ctxt;
+	__atomic_fetch_add(&_dbench_bounded_dropped, 1, __ATOMIC_RELAXED);
+}
+
+static void
+_dbench_flush(void *ctxt)
+{
+	(void)ctxt;
+}
+
+// One round: a single producer floods a serial queue whose consumer can't keep
+// up, unbounded or with a capacity and each of its policies. The largest
+// number of pending items seen by the producer, and the number of items
+// dropped, are printed on stderr.
+static void
+dbench_bounded_producer(dbench_t b, uintptr_t kind)
+{
+	dispatch_queue_t dq;
+	size_t submitted = 0, rejected = 0, max_pending = 0, pending;
+
+	_dbench_bounded_consumed = 0;
+	_dbench_bounded_dropped = 0;
+	if (kind == DBENCH_BOUNDED_NONE) {
+		dq = dispatch_queue_create("dispatch-bench.bounded",
+				DISPATCH_QUEUE_SERIAL);
+	} else {
+		dq = dispatch_queue_create("dispatch-bench.bounded",
+				DISPATCH_QUEUE_SERIAL_INACTIVE);
+		dispatch_queue_set_capacity(dq, DBENCH_BOUNDED_CAPACITY,
+				kind == DBENCH_BOUNDED_TRY ? DISPATCH_QUEUE_CAPACITY_FAIL :
+				kind == DBENCH_BOUNDED_BLOCK ? DISPATCH_QUEUE_CAPACITY_BLOCK :
+				DISPATCH_QUEUE_CAPACITY_DROP_OLDEST);
+		dispatch_queue_set_capacity_drop_handler_f(dq, _dbench_bounded_drop);
+		dispatch_activate(dq);
+	}
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		for (uintptr_t j = 0; j < DBENCH_BOUNDED_ITEMS; j++) {
+			if (kind == DBENCH_BOUNDED_TRY) {
+				while (!dispatch_async_try_f(dq, (void *)j,
+						_dbench_bounded_consume)) {
+					rejected++;
+					sched_yield();
+				}
+			} else {
+				dispatch_async_f(dq, (void *)j, _dbench_bounded_consume);
+			}
+			submitted++;
+			pending = submitted - __atomic_load_n(&_dbench_bounded_consumed,
+					__ATOMIC_RELAXED) - _dbench_bounded_dropped;
+			if (pending > max_pending) max_pending = pending;
+		}
+		// sync waiters are neither bounded nor dropped
+		dispatch_sync_f(dq, NULL, _dbench_flush);
+		dbench_record(b, dbench_now() - start, DBENCH_BOUNDED_ITEMS);
+	}
+
+	if (kind == DBENCH_BOUNDED_DROP_OLDEST) {
+		fprintf(stderr, "max pending: %zu, dropped: %zu of %zu\n",
+				max_pending, _dbench_bounded_dropped, submitted);
+	} else {
+		fprintf(stderr, "max pending: %zu, rejected: %zu\n",
+				max_pending, rejected);
+	}
+	dispatch_release(dq);
+}
+
+#pragma mark -
+#pragma mark deadline queues
+
+#define DBENCH_DEADLINE_BURST		32u
+#define DBENCH_DEADLINE_SPINS		2000u
+#define DBENCH_DEADLINE_URGENT_NS	(100 * 1000ull)
+#define DBENCH_DEADLINE_RELAXED_NS	(10 * 1000 * 1000ull)
+
+enum {
+	DBENCH_DEADLINE_FIFO,
+	DBENCH_DEADLINE_EDF,
+	DBENCH_DEADLINE_EDF_DROP_EXPIRED,
+};
+
+static void
+_dbench_deadline_work(void *ctxt)
+{
+	uint64_t x = (uintptr_t)ctxt;
+	for (unsigned int i = 0; i < DBENCH_DEADLINE_SPINS; i++) {
+		x = x * 6364136223846793005ull + 1442695040888963407ull;
+	}
+	dbench_sink += (uintptr_t)x;
+}
+
+static void
+_dbench_deadline_urgent(void *ctxt)
+{
+	_dbench_deadline_work(NULL);
+	dispatch_semaphore_signal(ctxt);
+}
+
+// One round: a burst of items with a relaxed deadline followed by an urgent
+// one, on a serial queue. Only the urgent item is waited for, so under EDF
+// the backlog of relaxed items keeps growing. Measures the submit to
+// completion latency of the urgent item, deadline counters are printed on
+// stderr. The FIFO case submits the same way to a regular queue, which
+// ignores deadlines.
+static void
+dbench_deadline_overload(dbench_t b, uintptr_t kind)
+{
+	dispatch_semaphore_t dsema = dispatch_semaphore_create(0);
+	dispatch_queue_t dq = dispatch_queue_create("dispatch-bench.deadline",
+			DISPATCH_QUEUE_SERIAL_INACTIVE);
+	dispatch_queue_deadline_stats_s stats;
+
+	if (kind != DBENCH_DEADLINE_FIFO) {
+		dispatch_queue_set_deadline_scheduling(dq,
+				kind == DBENCH_DEADLINE_EDF_DROP_EXPIRED ?
+				DISPATCH_QUEUE_DEADLINE_DROP_EXPIRED :
+				DISPATCH_QUEUE_DEADLINE_NONE);
+	}
+	dispatch_activate(dq);
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		for (uintptr_t j = 0; j < DBENCH_DEADLINE_BURST; j++) {
+			dispatch_async_with_deadline_f(dq,
+					dispatch_time(DISPATCH_TIME_NOW,
+					DBENCH_DEADLINE_RELAXED_NS),
+					(void *)j, _dbench_deadline_work);
+		}
+		dispatch_async_with_deadline_f(dq,
+				dispatch_time(DISPATCH_TIME_NOW, DBENCH_DEADLINE_URGENT_NS),
+				dsema, _dbench_deadline_urgent);
+		dispatch_semaphore_wait(dsema, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, 1);
+	}
+	dispatch_sync_f(dq, NULL, _dbench_flush);
+
+	if (kind != DBENCH_DEADLINE_FIFO) {
+		dispatch_queue_get_deadline_stats(dq, &stats);
+		fprintf(stderr, "executed: %llu, missed: %llu, dropped: %llu, "
+				"max lateness: %lluus\n",
+				(unsigned long long)stats.dqds_executed,
+				(unsigned long long)stats.dqds_missed,
+				(unsigned long long)stats.dqds_dropped,
+				(unsigned long long)stats.dqds_max_lateness / 1000);
+	}
+	dispatch_release(dq);
+	dispatch_release(dsema);
+}
+
+#pragma mark -
+#pragma mark rate limited queues
+
+#define DBENCH_RATE_LIMIT		1000u // items per second
+#define DBENCH_RATE_BURST		10u
+#define DBENCH_RATE_ITEMS		500u
+#define DBENCH_RATE_TOLERANCE	5u // percent
+
+enum {
+	DBENCH_RATE_NONE,
+	DBENCH_RATE_UNREACHED,
+};
+
+// One round: a backlog of items on a queue limited to DBENCH_RATE_LIMIT items
+// per second, after letting its bucket refill. The first DBENCH_RATE_BURST
+// items start right away, the round fails if the others don't start at the
+// limit give or take DBENCH_RATE_TOLERANCE percent. The measured rate is
+// printed on stderr.
+static void
+dbench_rate_accuracy(dbench_t b, uintptr_t kind)
+{
+	dispatch_queue_t dq = dispatch_queue_create("dispatch-bench.rate",
+			kind == DBENCH_QUEUE_SERIAL ? DISPATCH_QUEUE_SERIAL_INACTIVE :
+			DISPATCH_QUEUE_CONCURRENT_INACTIVE);
+	dbench_countdown_s dcd = { .dcd_sema = dispatch_semaphore_create(0) };
+	size_t items = DBENCH_RATE_ITEMS - DBENCH_RATE_BURST;
+	uint64_t expected = items * 1000000000ull / DBENCH_RATE_LIMIT, ns;
+	uint64_t total = 0;
+
+	dispatch_queue_set_rate_limit(dq, DBENCH_RATE_LIMIT, DBENCH_RATE_BURST);
+	dispatch_activate(dq);
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		// let the bucket refill, with some margin
+		usleep(2 * DBENCH_RATE_BURST * 1000000u / DBENCH_RATE_LIMIT);
+		dcd.dcd_remaining = DBENCH_RATE_ITEMS;
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < DBENCH_RATE_ITEMS; j++) {
+			dispatch_async_f(dq, &dcd, _dbench_countdown);
+		}
+		dispatch_semaphore_wait(dcd.dcd_sema, DISPATCH_TIME_FOREVER);
+		ns = dbench_now() - start;
+		if (ns * 100 < expected * (100 - DBENCH_RATE_TOLERANCE) ||
+				ns * 100 > expected * (100 + DBENCH_RATE_TOLERANCE)) {
+			dbench_fail(b, "rate limit off by more than the tolerance");
+		}
+		dbench_record(b, ns, items);
+		total += ns;
+	}
+
+	fprintf(stderr, "rate: %.1f/s, limit: %u/s\n",
+			1e9 * items * dbench_samples(b) / (double)total,
+			DBENCH_RATE_LIMIT);
+	dispatch_release(dcd.dcd_sema);
+	dispatch_release(dq);
+}
+
+// Same rounds as dbench_async on a serial queue, without a rate limit or with
+// one it never reaches: the difference is the cost of taking a token.
+static void
+dbench_rate_overhead(dbench_t b, uintptr_t kind)
+{
+	dispatch_queue_t dq = dispatch_queue_create("dispatch-bench.rate",
+			DISPATCH_QUEUE_SERIAL_INACTIVE);
+	dbench_countdown_s dcd = { .dcd_sema = dispatch_semaphore_create(0) };
+	size_t batch = dbench_batch(b);
+
+	if (kind == DBENCH_RATE_UNREACHED) {
+		dispatch_queue_set_rate_limit(dq, 1000000000u, batch);
+	}
+	dispatch_activate(dq);
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		dcd.dcd_remaining = batch;
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			dispatch_async_f(dq, &dcd, _dbench_countdown);
+		}
+		dispatch_semaphore_wait(dcd.dcd_sema, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	dispatch_release(dcd.dcd_sema);
+	dispatch_release(dq);
+}
+
+#pragma mark -
+#pragma mark trace ring
+
+// Same rounds as dbench_async, run once with LIBDISPATCH_TRACE_RING set and
+// once without: the difference in cost per item divided by the events per
+// item printed on stderr is the cost of recording one event.
+static void
+dbench_trace_async(dbench_t b, uintptr_t kind)
+{
+	dispatch_trace_ring_stats_s before, after;
+	bool enabled = _dispatch_trace_ring_get_stats(&before);
+
+	dbench_async(b, kind);
+	if (!enabled) {
+		fprintf(stderr, "trace ring: disabled\n");
+		return;
+	}
+	// let the drain thread pick up the tail of the last round
+	usleep(200000);
+	_dispatch_trace_ring_get_stats(&after);
+	fprintf(stderr, "trace ring: %.1f events/item, %llu dropped\n",
+			(double)(after.dtrs_events - before.dtrs_events) /
+			(double)(dbench_samples(b) * dbench_batch(b)),
+			(unsigned long long)(after.dtrs_dropped - before.dtrs_dropped));
+}
+
+#pragma mark -
+#pragma mark introspection batch hooks
+
+enum {
+	DBENCH_HOOKS_OFF,
+	DBENCH_HOOKS_IDLE,
+	DBENCH_HOOKS_ACTIVE,
+};
+
+static uint64_t _dbench_hooks_enqueued;
+static uint64_t _dbench_hooks_batches;
+static uint64_t _dbench_hooks_items;
+static uint64_t _dbench_hooks_busy;
+
+static void
+_dbench_hooks_item_enqueued_idle(dispatch_queue_t dq, const void *item)
+{
+	(void)dq; (void)item;
+}
+
+static void
+_dbench_hooks_drain_batch_idle(const dispatch_introspection_drain_batch_s *b)
+{
+	(void)b;
+}
+
+static void
+_dbench_hooks_item_enqueued(dispatch_queue_t dq, const void *item)
+{
+	(void)dq; (void)item;
+	__atomic_add_fetch(&_dbench_hooks_enqueued, 1, __ATOMIC_RELAXED);
+}
+
+static void
+_dbench_hooks_drain_batch(const dispatch_introspection_drain_batch_s *b)
+{
+	uint64_t busy = 0;
+	for (unsigned long i = 0; i < b->count; i++) {
+		busy += b->items[i].end - b->items[i].start;
+	}
+	__atomic_add_fetch(&_dbench_hooks_batches, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&_dbench_hooks_items, b->count, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&_dbench_hooks_busy, busy, __ATOMIC_RELAXED);
+}
+
+// The dispatch_async rounds on a serial queue with no hooks, with hooks that
+// return immediately, and with hooks that account every item
+static void
+dbench_hooks_async(dbench_t b, uintptr_t mode)
+{
+	dispatch_introspection_batch_hooks_s hooks = { };
+
+	if (mode == DBENCH_HOOKS_IDLE) {
+		hooks.item_enqueued = _dbench_hooks_item_enqueued_idle;
+		hooks.drain_batch = _dbench_hooks_drain_batch_idle;
+	} else if (mode == DBENCH_HOOKS_ACTIVE) {
+		hooks.item_enqueued = _dbench_hooks_item_enqueued;
+		hooks.drain_batch = _dbench_hooks_drain_batch;
+	}
+	_dbench_hooks_enqueued = _dbench_hooks_batches = 0;
+	_dbench_hooks_items = _dbench_hooks_busy = 0;
+
+	dispatch_introspection_batch_hooks_install(&hooks);
+	dbench_async(b, DBENCH_QUEUE_SERIAL);
+	hooks = (dispatch_introspection_batch_hooks_s){ };
+	dispatch_introspection_batch_hooks_install(&hooks);
+
+	if (mode == DBENCH_HOOKS_ACTIVE) {
+		fprintf(stderr, "hooks: %llu enqueued, %llu items in %llu batches, "
+				"%.1f ns busy/item\n",
+				(unsigned long long)_dbench_hooks_enqueued,
+				(unsigned long long)_dbench_hooks_items,
+				(unsigned long long)_dbench_hooks_batches,
+				_dbench_hooks_items ? (double)_dbench_hooks_busy /
+				(double)_dbench_hooks_items : 0.0);
+	}
+}
+
+#pragma mark -
+#pragma mark dispatch_sync
+
+typedef struct dbench_sync_ctx_s {
+	dispatch_queue_t dsc_queue;
+	size_t dsc_count;
+	uintptr_t volatile dsc_value;
+} dbench_sync_ctx_s;
+
+static void
+_dbench_sync_increment(void *ctxt)
+{
+	dbench_sync_ctx_s *dsc = ctxt;
+	dsc->dsc_value++;
+}
+
+static void
+_dbench_sync_thread(void *ctxt, size_t idx)
+{
+	dbench_sync_ctx_s *dsc = ctxt;
+	(void)idx;
+	for (size_t i = 0; i < dsc->dsc_count; i++) {
+		dispatch_sync_f(dsc->dsc_queue, dsc, _dbench_sync_increment);
+	}
+}
+
+// One round: `threads` workers each perform a batch of dispatch_sync calls
+// on the same serial queue
+static void
+dbench_sync_contended(dbench_t b, uintptr_t threads)
+{
+	dbench_sync_ctx_s dsc = {
+		.dsc_queue = dispatch_queue_create("dispatch-bench.sync", NULL),
+		.dsc_count = dbench_batch(b),
+	};
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		if (threads == 1) {
+			_dbench_sync_thread(&dsc, 0);
+		} else {
+			dispatch_apply_f(threads, DISPATCH_APPLY_AUTO, &dsc,
+					_dbench_sync_thread);
+		}
+		dbench_record(b, dbench_now() - start, threads * dsc.dsc_count);
+	}
+	dbench_sink = dsc.dsc_value;
+	dispatch_release(dsc.dsc_queue);
+}
+
+#pragma mark -
+#pragma mark request/response
+
+// A client work item on a global queue needs a value computed on a serial
+// "server" queue before it can reply
+
+typedef struct dbench_request_s {
+	dispatch_queue_t drq_server;
+	dispatch_queue_t drq_client;
+	dbench_countdown_s drq_countdown;
+	uintptr_t volatile drq_state;
+} dbench_request_s;
+
+static void
+_dbench_request_compute(void *ctxt)
+{
+	dbench_request_s *drq = ctxt;
+	drq->drq_state++;
+}
+
+static void
+_dbench_request_sync(void *ctxt)
+{
+	dbench_request_s *drq = ctxt;
+	dispatch_sync_f(drq->drq_server, drq, _dbench_request_compute);
+	_dbench_countdown(&drq->drq_countdown);
+}
+
+static void *
+_dbench_request_future_compute(void *ctxt)
+{
+	dbench_request_s *drq = ctxt;
+	return (void *)++drq->drq_state;
+}
+
+static void *
+_dbench_request_future_reply(void *ctxt, void *value)
+{
+	dbench_request_s *drq = ctxt;
+	dbench_sink = (uintptr_t)value;
+	_dbench_countdown(&drq->drq_countdown);
+	return NULL;
+}
+
+static void
+_dbench_request_future(void *ctxt)
+{
+	dbench_request_s *drq = ctxt;
+	dispatch_future_t f, reply;
+
+	f = dispatch_future_async_f(drq->drq_server, drq,
+			_dbench_request_future_compute);
+	reply = dispatch_future_then_f(f, drq->drq_client, drq,
+			_dbench_request_future_reply);
+	dispatch_future_release(f);
+	dispatch_future_release(reply);
+}
+
+// One round: a batch of client items, each getting its value with a
+// dispatch_sync on the server queue, or with a future and a continuation
+// that doesn't hold on to the worker in the meantime
+static void
+dbench_request(dbench_t b, uintptr_t use_futures)
+{
+	dbench_request_s drq = {
+		.drq_server = dispatch_queue_create("dispatch-bench.server", NULL),
+		.drq_client = dispatch_get_global_queue(
+				DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+		.drq_countdown.dcd_sema = dispatch_semaphore_create(0),
+	};
+	dispatch_function_t client = use_futures ? _dbench_request_future :
+			_dbench_request_sync;
+	size_t batch = dbench_batch(b);
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		drq.drq_countdown.dcd_remaining = batch;
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			dispatch_async_f(drq.drq_client, &drq, client);
+		}
+		dispatch_semaphore_wait(drq.drq_countdown.dcd_sema,
+				DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	dispatch_release(drq.drq_countdown.dcd_sema);
+	dispatch_release(drq.drq_server);
+}
+
+#pragma mark -
+#pragma mark dispatch_apply
+
+static void
+_dbench_apply_work(void *ctxt, size_t idx)
+{
+	(void)ctxt;
+	// a few dozen cycles of work so that the scheduling cost dominates
+	uintptr_t v = idx;
+	for (int i = 0; i < 16; i++) {
+		v = v * 2654435761u + 1;
+	}
+	dbench_sink = v;
+}
+
+// One round: a dispatch_apply of `iterations` trivial iterations
+static void
+dbench_apply(dbench_t b, uintptr_t iterations)
+{
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		dispatch_apply_f(iterations, DISPATCH_APPLY_AUTO, NULL,
+				_dbench_apply_work);
+		dbench_record(b, dbench_now() - start, iterations);
+	}
+}
+
+#define DBENCH_APPLY_CPU_SPINS 20000 // a few dozen microseconds
+
+static void
+_dbench_apply_cpu_work(void *ctxt, size_t idx)
+{
+	(void)ctxt;
+	uint64_t x = idx;
+	for (unsigned int i = 0; i < DBENCH_APPLY_CPU_SPINS; i++) {
+		x = x * 6364136223846793005ull + 1442695040888963407ull;
+	}
+	dbench_sink += (uintptr_t)x;
+}
+
+// One round: a dispatch_apply of `iterations` CPU-bound iterations. When the
+// process is confined to fewer CPUs than the machine has (taskset, or a
+// cgroup CPU quota), running more workers than the CPUs granted only adds
+// context switches, which are printed on stderr.
+static void
+dbench_apply_cpu_bound(dbench_t b, uintptr_t iterations)
+{
+	uint64_t csw = _dbench_context_switches();
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		dispatch_apply_f(iterations, DISPATCH_APPLY_AUTO, NULL,
+				_dbench_apply_cpu_work);
+		dbench_record(b, dbench_now() - start, iterations);
+	}
+	csw = _dbench_context_switches() - csw;
+	fprintf(stderr, "context switches: %llu (%.2f per round)\n",
+			(unsigned long long)csw, (double)csw / (double)dbench_samples(b));
+}
+
+const dbench_case_s dbench_queue_cases[] = {
+	DBENCH_CASE("async.serial", dbench_async, DBENCH_QUEUE_SERIAL),
+	DBENCH_CASE("async.concurrent", dbench_async, DBENCH_QUEUE_CONCURRENT),
+	DBENCH_CASE("async.global", dbench_async, DBENCH_QUEUE_GLOBAL),
+	DBENCH_CASE("async.batch.serial", dbench_async_batch, DBENCH_QUEUE_SERIAL),
+	DBENCH_CASE("async.batch.concurrent", dbench_async_batch,
+			DBENCH_QUEUE_CONCURRENT),
+	DBENCH_CASE("async.batch.global", dbench_async_batch, DBENCH_QUEUE_GLOBAL),
+	DBENCH_CASE("async.block.serial", dbench_async_block, DBENCH_QUEUE_SERIAL),
+	DBENCH_CASE("async.block.global", dbench_async_block, DBENCH_QUEUE_GLOBAL),
+	DBENCH_CASE("async.block_large.serial", dbench_async_block_large,
+			DBENCH_QUEUE_SERIAL),
+	DBENCH_CASE("async.block_large.global", dbench_async_block_large,
+			DBENCH_QUEUE_GLOBAL),
+	DBENCH_CASE("async.block.allocs", dbench_async_block_allocs, 0),
+	DBENCH_CASE("async.block_large.allocs", dbench_async_block_allocs, 1),
+	DBENCH_CASE("async.block_byref.serial", dbench_async_block_byref,
+			DBENCH_QUEUE_SERIAL),
+	DBENCH_CASE("async.cross_thread.serial", dbench_async_cross_thread,
+			DBENCH_QUEUE_SERIAL),
+	DBENCH_CASE("async.cross_thread.global", dbench_async_cross_thread,
+			DBENCH_QUEUE_GLOBAL),
+	DBENCH_CASE("async.latency.serial", dbench_async_latency,
+			DBENCH_QUEUE_SERIAL),
+	DBENCH_CASE("async.latency.global", dbench_async_latency,
+			DBENCH_QUEUE_GLOBAL),
+	DBENCH_CASE("cooperative.cpu.global", dbench_cooperative_cpu,
+			DBENCH_QUEUE_GLOBAL),
+	DBENCH_CASE("cooperative.cpu.cooperative", dbench_cooperative_cpu,
+			DBENCH_QUEUE_COOPERATIVE),
+	DBENCH_CASE("actor.ring", dbench_actor_ring, 0),
+	DBENCH_CASE("actor.ring.sticky", dbench_actor_ring, 1),
+	DBENCH_CASE("sticky.idle.off", dbench_sticky_idle, 0),
+	DBENCH_CASE("sticky.idle.on", dbench_sticky_idle, 1),
+	DBENCH_CASE("bounded.none", dbench_bounded_producer, DBENCH_BOUNDED_NONE),
+	DBENCH_CASE("bounded.try", dbench_bounded_producer, DBENCH_BOUNDED_TRY),
+	DBENCH_CASE("bounded.block", dbench_bounded_producer,
+			DBENCH_BOUNDED_BLOCK),
+	DBENCH_CASE("bounded.drop_oldest", dbench_bounded_producer,
+			DBENCH_BOUNDED_DROP_OLDEST),
+	DBENCH_CASE("deadline.overload.fifo", dbench_deadline_overload,
+			DBENCH_DEADLINE_FIFO),
+	DBENCH_CASE("deadline.overload.edf", dbench_deadline_overload,
+			DBENCH_DEADLINE_EDF),
+	DBENCH_CASE("deadline.overload.edf_drop", dbench_deadline_overload,
+			DBENCH_DEADLINE_EDF_DROP_EXPIRED),
+	DBENCH_CASE("rate.accuracy.serial", dbench_rate_accuracy,
+			DBENCH_QUEUE_SERIAL),
+	DBENCH_CASE("rate.accuracy.concurrent", dbench_rate_accuracy,
+			DBENCH_QUEUE_CONCURRENT),
+	DBENCH_CASE("rate.overhead.none", dbench_rate_overhead, DBENCH_RATE_NONE),
+	DBENCH_CASE("rate.overhead.unreached", dbench_rate_overhead,
+			DBENCH_RATE_UNREACHED),
+	DBENCH_CASE("trace.async.serial", dbench_trace_async, DBENCH_QUEUE_SERIAL),
+	DBENCH_CASE("hooks.async.off", dbench_hooks_async, DBENCH_HOOKS_OFF),
+	DBENCH_CASE("hooks.async.idle", dbench_hooks_async, DBENCH_HOOKS_IDLE),
+	DBENCH_CASE("hooks.async.active", dbench_hooks_async, DBENCH_HOOKS_ACTIVE),
+	DBENCH_CASE("sync.contended.1", dbench_sync_contended, 1),
+	DBENCH_CASE("sync.contended.4", dbench_sync_contended, 4),
+	DBENCH_CASE("sync.contended.16", dbench_sync_contended, 16),
+	DBENCH_CASE("request.sync", dbench_request, 0),
+	DBENCH_CASE("request.future", dbench_request, 1),
+	DBENCH_CASE("apply.64", dbench_apply, 64),
+	DBENCH_CASE("apply.1024", dbench_apply, 1024),
+	DBENCH_CASE("apply.65536", dbench_apply, 65536),
+	DBENCH_CASE("apply.cpu_bound", dbench_apply_cpu_bound, 256),
+	{ .dbc_name = NULL },
+};
@@ -0,0 +1,498 @@
+/*
+ * This source file is part of the Swift.org open source project
+ *
+ * Copyright (c) 2026 Apple Inc. and the Swift project authors
+ *
+ * Licensed under Apache License v2.0 with Runtime Library Exception
+ *
+ * See https://swift.org/LICENSE.txt for license information
+ * See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+ *
+ */
+
+#include "dispatch_bench.h"
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#pragma mark -
+#pragma mark clocks
+
+// One round: a batch of dispatch_time(DISPATCH_TIME_NOW, 0), the clock read
+// paid by every timer and dispatch_after. On x86 Linux, compare with a run
+// under LIBDISPATCH_TSC_CLOCK=1, along with after.submit and timer.arm_cancel.
+static void
+dbench_time_now(dbench_t b, uintptr_t arg)
+{
+	size_t batch = dbench_batch(b);
+	(void)arg;
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			dbench_sink += (uintptr_t)dispatch_time(DISPATCH_TIME_NOW, 0);
+		}
+		dbench_record(b, dbench_now() - start, batch);
+	}
+}
+
+#pragma mark -
+#pragma mark timers
+
+static void
+_dbench_timer_fired(void *ctxt)
+{
+	(void)ctxt;
+	dbench_sink++;
+}
+
+// One round: a batch of create/arm/resume/cancel/release cycles for timers
+// far enough in the future that they never fire
+static void
+dbench_timer_arm_cancel(dbench_t b, uintptr_t arg)
+{
+	dispatch_queue_t dq = dispatch_queue_create("dispatch-bench.timer", NULL);
+	size_t batch = dbench_batch(b);
+	(void)arg;
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			dispatch_source_t ds = dispatch_source_create(
+					DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dq);
+			dispatch_source_set_event_handler_f(ds, _dbench_timer_fired);
+			dispatch_source_set_timer(ds,
+					dispatch_time(DISPATCH_TIME_NOW, 3600 * NSEC_PER_SEC),
+					DISPATCH_TIME_FOREVER, NSEC_PER_SEC);
+			dispatch_resume(ds);
+			dispatch_source_cancel(ds);
+			dispatch_release(ds);
+		}
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	// let the cancellations drain before the queue goes away
+	dispatch_sync_f(dq, NULL, _dbench_timer_fired);
+	dispatch_release(dq);
+}
+
+#pragma mark -
+#pragma mark dispatch_after
+
+#define DBENCH_AFTER_DELAY	(5 * NSEC_PER_MSEC)
+
+typedef struct dbench_after_s {
+	dispatch_semaphore_t dba_sema;
+	size_t volatile dba_remaining;
+} dbench_after_s;
+
+static void
+_dbench_after_fired(void *ctxt)
+{
+	dbench_after_s *dba = ctxt;
+	if (__atomic_sub_fetch(&dba->dba_remaining, 1, __ATOMIC_ACQ_REL) == 0) {
+		dispatch_semaphore_signal(dba->dba_sema);
+	}
+}
+
+// Bytes currently allocated by malloc, 0 when the platform can't tell
+static size_t
+_dbench_heap_in_use(void)
+{
+#if defined(__APPLE__)
+	malloc_statistics_t stats;
+	malloc_zone_statistics(NULL, &stats);
+	return stats.size_in_use;
+#elif defined(__GLIBC__) && \
+		(__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	return mallinfo2().uordblks;
+#else
+	return 0;
+#endif
+}
+
+// One round: a batch of dispatch_after_f calls a few milliseconds out, only
+// the submission is timed, the round then waits for all of them to fire.
+// The heap growth per pending item is printed on stderr.
+static void
+dbench_after(dbench_t b, uintptr_t arg)
+{
+	dispatch_queue_t dq = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+	dbench_after_s dba = { .dba_sema = dispatch_semaphore_create(0) };
+	size_t batch = dbench_batch(b);
+	double bytes = 0;
+	(void)arg;
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		dba.dba_remaining = batch;
+		size_t heap = _dbench_heap_in_use();
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			dispatch_after_f(dispatch_time(DISPATCH_TIME_NOW,
+					DBENCH_AFTER_DELAY), dq, &dba, _dbench_after_fired);
+		}
+		dbench_record(b, dbench_now() - start, batch);
+		bytes += (double)(_dbench_heap_in_use() - heap) / (double)batch;
+		dispatch_semaphore_wait(dba.dba_sema, DISPATCH_TIME_FOREVER);
+	}
+	fprintf(stderr, "memory per pending item: %.0f bytes\n",
+			bytes / (double)dbench_samples(b));
+	dispatch_release(dba.dba_sema);
+}
+
+#define DBENCH_AFTER_PARALLEL_WIDTH 4
+
+typedef struct dbench_after_parallel_s {
+	dbench_after_s *dap_after;
+	size_t dap_count;
+} dbench_after_parallel_s;
+
+static void
+_dbench_after_parallel_submit(void *ctxt, size_t idx)
+{
+	dbench_after_parallel_s *dap = ctxt;
+	dispatch_queue_t dq = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+	(void)idx;
+
+	for (size_t j = 0; j < dap->dap_count; j++) {
+		dispatch_after_f(dispatch_time(DISPATCH_TIME_NOW, DBENCH_AFTER_DELAY),
+				dq, dap->dap_after, _dbench_after_fired);
+	}
+}
+
+// One round: a batch of dispatch_after_f calls split across several threads,
+// each of which asks the manager thread to wake up when it finds its list of
+// new items empty. The wakeup requests and the ones that needed a syscall are
+// printed on stderr.
+static void
+dbench_after_parallel(dbench_t b, uintptr_t arg)
+{
+	dbench_after_s dba = { .dba_sema = dispatch_semaphore_create(0) };
+	dbench_after_parallel_s dap = {
+		.dap_after = &dba,
+		.dap_count = dbench_batch(b) / DBENCH_AFTER_PARALLEL_WIDTH ?: 1,
+	};
+	size_t batch = dap.dap_count * DBENCH_AFTER_PARALLEL_WIDTH;
+	dispatch_event_loop_stats_s before, after;
+	(void)arg;
+
+	_dispatch_event_loop_get_stats(&before);
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		dba.dba_remaining = batch;
+		uint64_t start = dbench_now();
+		dispatch_apply_f(DBENCH_AFTER_PARALLEL_WIDTH, DISPATCH_APPLY_AUTO,
+				&dap, _dbench_after_parallel_submit);
+		dbench_record(b, dbench_now() - start, batch);
+		dispatch_semaphore_wait(dba.dba_sema, DISPATCH_TIME_FOREVER);
+	}
+	_dispatch_event_loop_get_stats(&after);
+	fprintf(stderr, "event loop pokes: %llu, eventfd writes: %llu\n",
+			(unsigned long long)(after.dels_pokes - before.dels_pokes),
+			(unsigned long long)(after.dels_writes - before.dels_writes));
+	dispatch_release(dba.dba_sema);
+}
+
+// One round: a batch of dispatch_after_cancellable_f calls an hour out, each
+// canceled right away, the way connection timeouts mostly are.
+// The fired and canceled counters are printed on stderr.
+static void
+dbench_after_cancel(dbench_t b, uintptr_t arg)
+{
+	dispatch_queue_t dq = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+	dispatch_after_stats_s before, after;
+	size_t batch = dbench_batch(b);
+	(void)arg;
+
+	_dispatch_after_get_stats(&before);
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			dispatch_after_handle_t dah = dispatch_after_cancellable_f(
+					dispatch_time(DISPATCH_TIME_NOW, 3600 * NSEC_PER_SEC),
+					dq, NULL, _dbench_timer_fired);
+			if (!dispatch_after_cancel(dah)) {
+				dbench_fail(b, "dispatch_after_cancel() failed");
+			}
+		}
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	_dispatch_after_get_stats(&after);
+	fprintf(stderr, "fired: %llu, canceled: %llu\n",
+			(unsigned long long)(after.das_fired - before.das_fired),
+			(unsigned long long)(after.das_canceled - before.das_canceled));
+}
+
+#pragma mark -
+#pragma mark socketpair read source
+
+typedef struct dbench_socket_s {
+	dispatch_semaphore_t dso_sema;
+	int dso_fd;
+} dbench_socket_s;
+
+static void
+_dbench_socket_readable(void *ctxt)
+{
+	dbench_socket_s *dso = ctxt;
+	char buf[64];
+	ssize_t n;
+
+	do {
+		n = read(dso->dso_fd, buf, sizeof(buf));
+	} while (n < 0 && errno == EINTR);
+	if (n > 0) {
+		dispatch_semaphore_signal(dso->dso_sema);
+	}
+}
+
+// One round: one byte written to a socketpair, and the time until the READ
+// source handler for the other end has run
+static void
+dbench_source_socketpair(dbench_t b, uintptr_t arg)
+{
+	dispatch_queue_t dq = dispatch_queue_create("dispatch-bench.read", NULL);
+	dbench_socket_s dso = { .dso_sema = dispatch_semaphore_create(0) };
+	int fds[2];
+	(void)arg;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+		dbench_fail(b, "socketpair() failed");
+	}
+	dso.dso_fd = fds[0];
+
+	dispatch_source_t ds = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ,
+			(uintptr_t)fds[0], 0, dq);
+	dispatch_set_context(ds, &dso);
+	dispatch_source_set_event_handler_f(ds, _dbench_socket_readable);
+	dispatch_resume(ds);
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		char c = 'x';
+		uint64_t start = dbench_now();
+		if (write(fds[1], &c, 1) != 1) {
+			dbench_fail(b, "write() to socketpair failed");
+		}
+		dispatch_semaphore_wait(dso.dso_sema, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, 1);
+	}
+
+	dispatch_source_cancel(ds);
+	dispatch_release(ds);
+	dispatch_sync_f(dq, NULL, _dbench_timer_fired);
+	dispatch_release(dq);
+	dispatch_release(dso.dso_sema);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+#pragma mark -
+#pragma mark signal sources
+
+typedef struct dbench_sigchld_s {
+	dispatch_semaphore_t dsc_sema;
+	size_t dsc_remaining;
+	size_t dsc_handler_calls;
+} dbench_sigchld_s;
+
+static void
+_dbench_sigchld_reap(void *ctxt)
+{
+	dbench_sigchld_s *dsc = ctxt;
+
+	dsc->dsc_handler_calls++;
+	while (dsc->dsc_remaining && waitpid(-1, NULL, WNOHANG) > 0) {
+		if (--dsc->dsc_remaining == 0) {
+			dispatch_semaphore_signal(dsc->dsc_sema);
+		}
+	}
+}
+
+// One round: `nchildren` processes forked at once which all exit right away,
+// and the time until a SIGCHLD source has reaped them all. The number of
+// handler calls per round is printed on stderr.
+static void
+dbench_source_sigchld_storm(dbench_t b, uintptr_t nchildren)
+{
+	dispatch_queue_t dq = dispatch_queue_create("dispatch-bench.signal", NULL);
+	dbench_sigchld_s dsc = { .dsc_sema = dispatch_semaphore_create(0) };
+	dispatch_source_t ds = dispatch_source_create(DISPATCH_SOURCE_TYPE_SIGNAL,
+			SIGCHLD, 0, dq);
+
+	dispatch_set_context(ds, &dsc);
+	dispatch_source_set_event_handler_f(ds, _dbench_sigchld_reap);
+	dispatch_resume(ds);
+	// make sure the source is armed before the first child exits
+	dispatch_sync_f(dq, NULL, _dbench_timer_fired);
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		dispatch_sync_f(dq, NULL, _dbench_timer_fired);
+		dsc.dsc_remaining = nchildren;
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < nchildren; j++) {
+			pid_t pid = fork();
+			if (pid == 0) {
+				_exit(0);
+			} else if (pid < 0) {
+				dbench_fail(b, "fork() failed");
+			}
+		}
+		dispatch_semaphore_wait(dsc.dsc_sema, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, nchildren);
+	}
+
+	dispatch_source_cancel(ds);
+	dispatch_release(ds);
+	dispatch_sync_f(dq, NULL, _dbench_timer_fired);
+	fprintf(stderr, "handler calls per round: %.1f for %zu children\n",
+			(double)dsc.dsc_handler_calls / (double)dbench_samples(b),
+			(size_t)nchildren);
+	dispatch_release(dq);
+	dispatch_release(dsc.dsc_sema);
+}
+
+#pragma mark -
+#pragma mark data sources
+
+// One round: a batch of dispatch_source_merge_data on a DATA_ADD or DATA_OR
+// source, the handler coalesces them
+static void
+dbench_source_merge_data(dbench_t b, uintptr_t is_or)
+{
+	dispatch_queue_t dq = dispatch_queue_create("dispatch-bench.data", NULL);
+	dispatch_source_t ds = dispatch_source_create(is_or ?
+			DISPATCH_SOURCE_TYPE_DATA_OR : DISPATCH_SOURCE_TYPE_DATA_ADD,
+			0, 0, dq);
+	size_t batch = dbench_batch(b);
+
+	dispatch_source_set_event_handler_f(ds, _dbench_timer_fired);
+	dispatch_resume(ds);
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			dispatch_source_merge_data(ds, 1);
+		}
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	dispatch_source_cancel(ds);
+	dispatch_release(ds);
+	dispatch_sync_f(dq, NULL, _dbench_timer_fired);
+	dispatch_release(dq);
+}
+
+#define DBENCH_MERGE_THREADS_MAX	64
+
+typedef struct dbench_merge_s {
+	dispatch_source_t dbm_source;
+	dispatch_group_t dbm_done;
+	dispatch_semaphore_t dbm_start;
+	size_t dbm_merges; // per thread and per round
+	size_t dbm_rounds;
+} dbench_merge_s;
+
+static void *
+_dbench_merge_thread(void *ctxt)
+{
+	dbench_merge_s *dbm = ctxt;
+
+	for (size_t i = 0; i < dbm->dbm_rounds; i++) {
+		dispatch_semaphore_wait(dbm->dbm_start, DISPATCH_TIME_FOREVER);
+		for (size_t j = 0; j < dbm->dbm_merges; j++) {
+			dispatch_source_merge_data(dbm->dbm_source, 1);
+		}
+		dispatch_group_leave(dbm->dbm_done);
+	}
+	return NULL;
+}
+
+// One round: `nthreads` threads all merge into the same DATA_ADD source,
+// created with DISPATCH_SOURCE_TYPE_DATA_ADD_SHARDED when `sharded` is set
+static void
+dbench_source_merge_contended(dbench_t b, size_t nthreads, bool sharded)
+{
+	dispatch_queue_t dq = dispatch_queue_create("dispatch-bench.data", NULL);
+	dbench_merge_s dbm = {
+		.dbm_source = dispatch_source_create(sharded ?
+				DISPATCH_SOURCE_TYPE_DATA_ADD_SHARDED :
+				DISPATCH_SOURCE_TYPE_DATA_ADD, 0, 0, dq),
+		.dbm_done = dispatch_group_create(),
+		.dbm_start = dispatch_semaphore_create(0),
+		.dbm_merges = (dbench_batch(b) + nthreads - 1) / nthreads,
+		.dbm_rounds = dbench_samples(b),
+	};
+	pthread_t threads[DBENCH_MERGE_THREADS_MAX];
+
+	if (nthreads > DBENCH_MERGE_THREADS_MAX) {
+		dbench_fail(b, "too many threads");
+	}
+	dispatch_source_set_event_handler_f(dbm.dbm_source, _dbench_timer_fired);
+	dispatch_resume(dbm.dbm_source);
+	for (size_t i = 0; i < nthreads; i++) {
+		if (pthread_create(&threads[i], NULL, _dbench_merge_thread, &dbm)) {
+			dbench_fail(b, "pthread_create failed");
+		}
+	}
+	for (size_t i = 0; i < dbm.dbm_rounds; i++) {
+		uint64_t start = dbench_now();
+		dispatch_group_enter_n(dbm.dbm_done, nthreads);
+		for (size_t j = 0; j < nthreads; j++) {
+			dispatch_semaphore_signal(dbm.dbm_start);
+		}
+		dispatch_group_wait(dbm.dbm_done, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, dbm.dbm_merges * nthreads);
+	}
+	for (size_t i = 0; i < nthreads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	dispatch_source_cancel(dbm.dbm_source);
+	dispatch_release(dbm.dbm_source);
+	dispatch_sync_f(dq, NULL, _dbench_timer_fired);
+	dispatch_release(dbm.dbm_start);
+	dispatch_release(dbm.dbm_done);
+	dispatch_release(dq);
+}
+
+static void
+dbench_source_merge_shared(dbench_t b, uintptr_t nthreads)
+{
+	dbench_source_merge_contended(b, nthreads, false);
+}
+
+static void
+dbench_source_merge_sharded(dbench_t b, uintptr_t nthreads)
+{
+	dbench_source_merge_contended(b, nthreads, true);
+}
+
+const dbench_case_s dbench_source_cases[] = {
+	DBENCH_CASE("time.now", dbench_time_now, 0),
+	DBENCH_CASE("timer.arm_cancel", dbench_timer_arm_cancel, 0),
+	DBENCH_CASE("after.submit", dbench_after, 0),
+	DBENCH_CASE("after.cancel", dbench_after_cancel, 0),
+	DBENCH_CASE("after.submit.parallel", dbench_after_parallel, 0),
+	DBENCH_CASE("source.read.socketpair", dbench_source_socketpair, 0),
+	DBENCH_CASE("source.signal.sigchld.64", dbench_source_sigchld_storm, 64),
+	DBENCH_CASE("source.data_add.merge", dbench_source_merge_data, 0),
+	DBENCH_CASE("source.data_or.merge", dbench_source_merge_data, 1),
+	DBENCH_CASE("source.data_add.merge.1", dbench_source_merge_shared, 1),
+	DBENCH_CASE("source.data_add.merge.4", dbench_source_merge_shared, 4),
+	DBENCH_CASE("source.data_add.merge.16", dbench_source_merge_shared, 16),
+	DBENCH_CASE("source.data_add.merge.64", dbench_source_merge_shared, 64),
+	DBENCH_CASE("source.data_add_sharded.merge.1",
+			dbench_source_merge_sharded, 1),
+	DBENCH_CASE("source.data_add_sharded.merge.4",
+			dbench_source_merge_sharded, 4),
+	DBENCH_CASE("source.data_add_sharded.merge.16",
+			dbench_source_merge_sharded, 16),
+	DBENCH_CASE("source.data_add_sharded.merge.64",
+			dbench_source_merge_sharded, 64),
+	{ .dbc_name = NULL },
+};
@@ -0,0 +1,266 @@
+/*
+ * This source file is part of the Swift.org open source project
+ *
+ * Copyright (c) 2026 Apple Inc. and the Swift project authors
+ *
+ * Licensed under Apache License v2.0 with Runtime Library Exception
+ *
+ * See https://swift.org/LICENSE.txt for license information
+ * See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+ *
+ */
+
+#include "dispatch_bench.h"
+
+#include <pthread.h>
+
+#pragma mark -
+#pragma mark dispatch_group
+
+// One round: a batch of uncontended enter/leave pairs
+static void
+dbench_group_enter_leave(dbench_t b, uintptr_t arg)
+{
+	dispatch_group_t dg = dispatch_group_create();
+	size_t batch = dbench_batch(b);
+	(void)arg;
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			dispatch_group_enter(dg);
+			dispatch_group_leave(dg);
+		}
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	dispatch_release(dg);
+}
+
+static void
+_dbench_group_work(void *ctxt)
+{
+	dbench_sink = (uintptr_t)ctxt;
+}
+
+// One round: a batch of dispatch_group_async_f followed by a wait, on a
+// group created with dispatch_group_create_batched() when `batched` is set
+static void
+dbench_group_async_wait(dbench_t b, uintptr_t batched)
+{
+	dispatch_queue_t dq = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+	dispatch_group_t dg = batched ? dispatch_group_create_batched() :
+			dispatch_group_create();
+	size_t batch = dbench_batch(b);
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			dispatch_group_async_f(dg, dq, (void *)j, _dbench_group_work);
+		}
+		dispatch_group_wait(dg, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	dispatch_release(dg);
+}
+
+#define DBENCH_FANIN_BATCH	64
+#define DBENCH_FANIN_THREADS_MAX	128
+
+typedef struct dbench_fanin_s {
+	dispatch_group_t dfi_group;
+	dispatch_semaphore_t dfi_start;
+	size_t dfi_leaves; // per thread and per round
+	size_t dfi_rounds;
+	bool dfi_batched;
+} dbench_fanin_s;
+
+static void *
+_dbench_fanin_thread(void *ctxt)
+{
+	dbench_fanin_s *dfi = ctxt;
+
+	for (size_t i = 0; i < dfi->dfi_rounds; i++) {
+		dispatch_semaphore_wait(dfi->dfi_start, DISPATCH_TIME_FOREVER);
+		if (dfi->dfi_batched) {
+			for (size_t j = 0; j < dfi->dfi_leaves; j += DBENCH_FANIN_BATCH) {
+				size_t n = dfi->dfi_leaves - j;
+				dispatch_group_leave_n(dfi->dfi_group,
+						n < DBENCH_FANIN_BATCH ? n : DBENCH_FANIN_BATCH);
+			}
+		} else {
+			for (size_t j = 0; j < dfi->dfi_leaves; j++) {
+				dispatch_group_leave(dfi->dfi_group);
+			}
+		}
+	}
+	return NULL;
+}
+
+// One round: `nthreads` threads all leave a group entered with a single
+// dispatch_group_enter_n(), one leave at a time or in batches of
+// DBENCH_FANIN_BATCH with dispatch_group_leave_n(), until a wait returns
+static void
+dbench_group_fanin(dbench_t b, size_t nthreads, bool batched)
+{
+	dbench_fanin_s dfi = {
+		.dfi_group = dispatch_group_create(),
+		.dfi_start = dispatch_semaphore_create(0),
+		.dfi_leaves = (dbench_batch(b) + nthreads - 1) / nthreads,
+		.dfi_rounds = dbench_samples(b),
+		.dfi_batched = batched,
+	};
+	pthread_t threads[DBENCH_FANIN_THREADS_MAX];
+
+	if (nthreads > DBENCH_FANIN_THREADS_MAX) {
+		dbench_fail(b, "too many threads");
+	}
+	for (size_t i = 0; i < nthreads; i++) {
+		if (pthread_create(&threads[i], NULL, _dbench_fanin_thread, &dfi)) {
+			dbench_fail(b, "pthread_create failed");
+		}
+	}
+	for (size_t i = 0; i < dfi.dfi_rounds; i++) {
+		uint64_t start = dbench_now();
+		dispatch_group_enter_n(dfi.dfi_group, dfi.dfi_leaves * nthreads);
+		for (size_t j = 0; j < nthreads; j++) {
+			dispatch_semaphore_signal(dfi.dfi_start);
+		}
+		dispatch_group_wait(dfi.dfi_group, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, dfi.dfi_leaves * nthreads);
+	}
+	for (size_t i = 0; i < nthreads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	dispatch_release(dfi.dfi_start);
+	dispatch_release(dfi.dfi_group);
+}
+
+static void
+dbench_group_fanin_single(dbench_t b, uintptr_t nthreads)
+{
+	dbench_group_fanin(b, nthreads, false);
+}
+
+static void
+dbench_group_fanin_batched(dbench_t b, uintptr_t nthreads)
+{
+	dbench_group_fanin(b, nthreads, true);
+}
+
+#pragma mark -
+#pragma mark dispatch_semaphore
+
+typedef struct dbench_pingpong_s {
+	dispatch_semaphore_t dpp_ping;
+	dispatch_semaphore_t dpp_pong;
+	size_t dpp_count;
+} dbench_pingpong_s;
+
+static void
+_dbench_pingpong_worker(void *ctxt)
+{
+	dbench_pingpong_s *dpp = ctxt;
+	for (size_t i = 0; i < dpp->dpp_count; i++) {
+		dispatch_semaphore_wait(dpp->dpp_ping, DISPATCH_TIME_FOREVER);
+		dispatch_semaphore_signal(dpp->dpp_pong);
+	}
+}
+
+// One round: a single signal/wait round trip with a worker thread
+static void
+dbench_semaphore_pingpong(dbench_t b, uintptr_t arg)
+{
+	dbench_pingpong_s dpp = {
+		.dpp_ping = dispatch_semaphore_create(0),
+		.dpp_pong = dispatch_semaphore_create(0),
+		.dpp_count = dbench_samples(b),
+	};
+	(void)arg;
+
+	dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+			&dpp, _dbench_pingpong_worker);
+	for (size_t i = 0; i < dpp.dpp_count; i++) {
+		uint64_t start = dbench_now();
+		dispatch_semaphore_signal(dpp.dpp_ping);
+		dispatch_semaphore_wait(dpp.dpp_pong, DISPATCH_TIME_FOREVER);
+		dbench_record(b, dbench_now() - start, 1);
+	}
+	dispatch_release(dpp.dpp_ping);
+	dispatch_release(dpp.dpp_pong);
+}
+
+// One round: a batch of uncontended signal/wait pairs on the same thread
+static void
+dbench_semaphore_uncontended(dbench_t b, uintptr_t arg)
+{
+	dispatch_semaphore_t dsema = dispatch_semaphore_create(0);
+	size_t batch = dbench_batch(b);
+	(void)arg;
+
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		for (size_t j = 0; j < batch; j++) {
+			dispatch_semaphore_signal(dsema);
+			dispatch_semaphore_wait(dsema, DISPATCH_TIME_FOREVER);
+		}
+		dbench_record(b, dbench_now() - start, batch);
+	}
+	dispatch_release(dsema);
+}
+
+#pragma mark -
+#pragma mark dispatch_once
+
+static void
+_dbench_once_init(void *ctxt)
+{
+	dbench_sink = (uintptr_t)ctxt;
+}
+
+// One round: a batch of dispatch_once_f calls on an initialized predicate,
+// through the inline fast path of <dispatch/once.h> when the platform has
+// one, or always through the library when `out_of_line` is set
+static void
+dbench_once_initialized(dbench_t b, uintptr_t out_of_line)
+{
+	static dispatch_once_t pred;
+	size_t batch = dbench_batch(b);
+
+	// the first calls after the initializer ran may still need to wait for
+	// the predicate to be marked done
+	for (size_t i = 0; i < 2; i++) {
+		(dispatch_once_f)(&pred, NULL, _dbench_once_init);
+	}
+	for (size_t i = 0; i < dbench_samples(b); i++) {
+		uint64_t start = dbench_now();
+		if (out_of_line) {
+			for (size_t j = 0; j < batch; j++) {
+				(dispatch_once_f)(&pred, NULL, _dbench_once_init);
+			}
+		} else {
+			for (size_t j = 0; j < batch; j++) {
+				dispatch_once_f(&pred, NULL, _dbench_once_init);
+				// keep the compiler from hoisting the check out of the loop
+				dispatch_compiler_barrier();
+			}
+		}
+		dbench_record(b, dbench_now() - start, batch);
+	}
+}
+
+const dbench_case_s dbench_sync_cases[] = {
+	DBENCH_CASE("group.enter_leave", dbench_group_enter_leave, 0),
+	DBENCH_CASE("group.async_wait", dbench_group_async_wait, 0),
+	DBENCH_CASE("group.async_wait.batched", dbench_group_async_wait, 1),
+	DBENCH_CASE("group.fanin.8", dbench_group_fanin_single, 8),
+	DBENCH_CASE("group.fanin.32", dbench_group_fanin_single, 32),
+	DBENCH_CASE("group.fanin.128", dbench_group_fanin_single, 128),
+	DBENCH_CASE("group.fanin_batched.8", dbench_group_fanin_batched, 8),
+	DBENCH_CASE("group.fanin_batched.32", dbench_group_fanin_batched, 32),
+	DBENCH_CASE("group.fanin_batched.128", dbench_group_fanin_batched, 128),
+	DBENCH_CASE("semaphore.pingpong", dbench_semaphore_pingpong, 0),
+	DBENCH_CASE("semaphore.uncontended", dbench_semaphore_uncontended, 0),
+	DBENCH_CASE("once.initialized", dbench_once_initialized, 0),
+	DBENCH_CASE("once.initialized.out_of_line", dbench_once_initialized, 1),
+	{ .dbc_name = NULL },
+};
@@ -0,0 +1,407 @@
+/*
+ * This source file is part of the Swift.org open source project
+ *
+ * Copyright (c) 2026 Apple Inc. and the Swift project authors
+ *
+ * Licensed under Apache License v2.0 with Runtime Library Exception
+ *
+ * See https://swift.org/LICENSE.txt for license information
+ * See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+ *
+ */
+
+#include "dispatch_bench.h"
+
+#include <errno.h>
+#include <fnmatch.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DBENCH_DEFAULT_SAMPLES 200
+#define DBENCH_DEFAULT_BATCH 1000
+#define DBENCH_DEFAULT_THRESHOLD 10.0 // percent
+#define DBENCH_NAME_MAX 64
+
+#ifndef countof
+#define countof(x) (sizeof(x) / sizeof(x[0]))
+#endif
+
+volatile uintptr_t dbench_sink;
+
+struct dbench_s {
+	const dbench_case_s *db_case;
+	size_t db_samples;
+	size_t db_batch;
+	size_t db_count;
+	size_t db_ops;
+	uint64_t db_total_ns;
+	double *db_values; // nanoseconds per operation, one per round
+};
+
+typedef struct dbench_result_s {
+	char dbr_name[DBENCH_NAME_MAX];
+	size_t dbr_rounds;
+	size_t dbr_ops;
+	double dbr_min, dbr_p50, dbr_p90, dbr_p99, dbr_p999, dbr_max;
+	double dbr_mean;
+	double dbr_ops_per_sec;
+} dbench_result_s;
+
+static const dbench_case_s *const dbench_case_tables[] = {
+	dbench_queue_cases,
+	dbench_sync_cases,
+	dbench_source_cases,
+	dbench_io_cases,
+};
+
+#pragma mark -
+#pragma mark harness
+
+uint64_t
+dbench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+size_t
+dbench_samples(dbench_t b)
+{
+	return b->db_samples;
+}
+
+size_t
+dbench_batch(dbench_t b)
+{
+	return b->db_batch;
+}
+
+void
+dbench_record(dbench_t b, uint64_t ns, size_t ops)
+{
+	if (b->db_count >= b->db_samples || ops == 0) {
+		return;
+	}
+	b->db_values[b->db_count++] = (double)ns / (double)ops;
+	b->db_ops += ops;
+	b->db_total_ns += ns;
+}
+
+void
+dbench_fail(dbench_t b, const char *msg)
+{
+	fprintf(stderr, "dispatch-bench: %s: %s (errno %d)\n",
+			b->db_case->dbc_name, msg, errno);
+	exit(2);
+}
+
+static int
+_dbench_double_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+static double
+_dbench_percentile(const double *sorted, size_t n, double p)
+{
+	// nearest-rank method
+	size_t rank = (size_t)ceil(p * (double)n);
+	if (rank == 0) rank = 1;
+	if (rank > n) rank = n;
+	return sorted[rank - 1];
+}
+
+static void
+_dbench_summarize(dbench_t b, dbench_result_s *r)
+{
+	size_t n = b->db_count;
+
+	memset(r, 0, sizeof(*r));
+	snprintf(r->dbr_name, sizeof(r->dbr_name), "%s", b->db_case->dbc_name);
+	r->dbr_rounds = n;
+	r->dbr_ops = b->db_ops;
+	if (n == 0) {
+		return;
+	}
+	qsort(b->db_values, n, sizeof(double), _dbench_double_cmp);
+	r->dbr_min = b->db_values[0];
+	r->dbr_p50 = _dbench_percentile(b->db_values, n, 0.50);
+	r->dbr_p90 = _dbench_percentile(b->db_values, n, 0.90);
+	r->dbr_p99 = _dbench_percentile(b->db_values, n, 0.99);
+	r->dbr_p999 = _dbench_percentile(b->db_values, n, 0.999);
+	r->dbr_max = b->db_values[n - 1];
+	r->dbr_mean = (double)b->db_total_ns / (double)b->db_ops;
+	if (b->db_total_ns) {
+		r->dbr_ops_per_sec = (double)b->db_ops * 1e9 / (double)b->db_total_ns;
+	}
+}
+
+static void
+_dbench_run_case(const dbench_case_s *dbc, size_t samples, size_t batch,
+		dbench_result_s *r)
+{
+	struct dbench_s b = {
+		.db_case = dbc,
+		.db_batch = batch,
+	};
+
+	b.db_values = calloc(samples, sizeof(double));
+	if (!b.db_values) dbench_fail(&b, "out of memory");
+
+	// warm-up: populate caches, spin up worker threads, fault in the heap
+	b.db_samples = samples / 10 ?: 1;
+	dbc->dbc_func(&b, dbc->dbc_arg);
+
+	b.db_samples = samples;
+	b.db_count = b.db_ops = 0;
+	b.db_total_ns = 0;
+	dbc->dbc_func(&b, dbc->dbc_arg);
+
+	_dbench_summarize(&b, r);
+	free(b.db_values);
+}
+
+#pragma mark -
+#pragma mark reporting
+
+static void
+_dbench_print_header(FILE *out)
+{
+	fprintf(out, "%-32s %7s %9s %9s %9s %9s %9s %9s %12s\n", "benchmark",
+			"rounds", "min", "p50", "p90", "p99", "p99.9", "max", "ops/s");
+}
+
+static void
+_dbench_print_result(FILE *out, const dbench_result_s *r)
+{
+	fprintf(out, "%-32s %7zu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %12.0f\n",
+			r->dbr_name, r->dbr_rounds, r->dbr_min, r->dbr_p50, r->dbr_p90,
+			r->dbr_p99, r->dbr_p999, r->dbr_max, r->dbr_ops_per_sec);
+}
+
+static void
+_dbench_write_json(FILE *out, const dbench_result_s *results, size_t count)
+{
+	// One result per line, so that _dbench_read_json() can stay trivial
+	fprintf(out, "{\"benchmark\":\"dispatch-bench\",\"version\":1,"
+			"\"unit\":\"ns/op\",\"results\":[\n");
+	for (size_t i = 0; i < count; i++) {
+		const dbench_result_s *r = &results[i];
+		fprintf(out, "{\"name\":\"%s\",\"rounds\":%zu,\"ops\":%zu,"
+				"\"min\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,"
+				"\"p999\":%.3f,\"max\":%.3f,\"mean\":%.3f,"
+				"\"ops_per_sec\":%.1f}%s\n", r->dbr_name, r->dbr_rounds,
+				r->dbr_ops, r->dbr_min, r->dbr_p50, r->dbr_p90, r->dbr_p99,
+				r->dbr_p999, r->dbr_max, r->dbr_mean, r->dbr_ops_per_sec,
+				i + 1 < count ? "," : "");
+	}
+	fprintf(out, "]}\n");
+}
+
+static bool
+_dbench_json_number(const char *line, const char *key, double *out)
+{
+	char pattern[DBENCH_NAME_MAX];
+	const char *p;
+
+	snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+	if (!(p = strstr(line, pattern))) {
+		return false;
+	}
+	*out = strtod(p + strlen(pattern), NULL);
+	return true;
+}
+
+static size_t
+_dbench_read_json(const char *path, dbench_result_s **results_out)
+{
+	dbench_result_s *results = NULL, *r;
+	size_t count = 0, size = 0;
+	char line[1024];
+	FILE *f;
+
+	if (!(f = fopen(path, "r"))) {
+		fprintf(stderr, "dispatch-bench: cannot open %s: %s\n", path,
+				strerror(errno));
+		exit(2);
+	}
+	while (fgets(line, sizeof(line), f)) {
+		const char *name = strstr(line, "{\"name\":\"");
+		const char *end;
+		double v;
+
+		if (!name) continue;
+		name += strlen("{\"name\":\"");
+		if (!(end = strchr(name, '"'))) continue;
+		if (count == size) {
+			size = size ? 2 * size : 32;
+			results = realloc(results, size * sizeof(*results));
+			if (!results) abort();
+		}
+		r = &results[count++];
+		memset(r, 0, sizeof(*r));
+		snprintf(r->dbr_name, sizeof(r->dbr_name), "%.*s",
+				(int)(end - name), name);
+		if (_dbench_json_number(line, "rounds", &v)) r->dbr_rounds = (size_t)v;
+		if (_dbench_json_number(line, "ops", &v)) r->dbr_ops = (size_t)v;
+		_dbench_json_number(line, "min", &r->dbr_min);
+		_dbench_json_number(line, "p50", &r->dbr_p50);
+		_dbench_json_number(line, "p90", &r->dbr_p90);
+		_dbench_json_number(line, "p99", &r->dbr_p99);
+		_dbench_json_number(line, "p999", &r->dbr_p999);
+		_dbench_json_number(line, "max", &r->dbr_max);
+		_dbench_json_number(line, "mean", &r->dbr_mean);
+		_dbench_json_number(line, "ops_per_sec", &r->dbr_ops_per_sec);
+	}
+	fclose(f);
+	*results_out = results;
+	return count;
+}
+
+static double
+_dbench_delta(double base, double cand)
+{
+	return base > 0 ? (cand - base) * 100.0 / base : 0.0;
+}
+
+static int
+_dbench_compare(const char *base_path, const char *cand_path,
+		double threshold)
+{
+	dbench_result_s *base, *cand;
+	size_t nbase = _dbench_read_json(base_path, &base);
+	size_t ncand = _dbench_read_json(cand_path, &cand);
+	int regressions = 0;
+
+	printf("%-32s %10s %10s %8s %10s %10s %8s\n", "benchmark",
+			"base p50", "new p50", "delta", "base p99", "new p99", "delta");
+	for (size_t i = 0; i < ncand; i++) {
+		const dbench_result_s *c = &cand[i], *b = NULL;
+		for (size_t j = 0; j < nbase; j++) {
+			if (strcmp(base[j].dbr_name, c->dbr_name) == 0) {
+				b = &base[j];
+				break;
+			}
+		}
+		if (!b) {
+			printf("%-32s %10s %10.1f\n", c->dbr_name, "-", c->dbr_p50);
+			continue;
+		}
+		double d50 = _dbench_delta(b->dbr_p50, c->dbr_p50);
+		double d99 = _dbench_delta(b->dbr_p99, c->dbr_p99);
+		bool regressed = d50 > threshold;
+		printf("%-32s %10.1f %10.1f %+7.1f%% %10.1f %10.1f %+7.1f%%%s\n",
+				c->dbr_name, b->dbr_p50, c->dbr_p50, d50, b->dbr_p99,
+				c->dbr_p99, d99, regressed ? "  REGRESSION" : "");
+		regressions += regressed;
+	}
+	free(base);
+	free(cand);
+	if (regressions) {
+		printf("%d benchmark(s) regressed by more than %.1f%% at p50\n",
+				regressions, threshold);
+	}
+	return regressions ? 1 : 0;
+}
+
+#pragma mark -
+#pragma mark main
+
+static void
+_dbench_usage(void)
+{
+	fprintf(stderr,
+			"usage: dispatch-bench [-l] [-f pattern] [-n rounds] [-b batch] "
+			"[-j out.json]\n"
+			"       dispatch-bench -c base.json new.json [-t percent]\n"
+			"\n"
+			"  -l          list benchmark names and exit\n"
+			"  -f pattern  only run benchmarks matching the fnmatch(3) "
+			"pattern\n"
+			"  -n rounds   timed rounds per benchmark (default %d)\n"
+			"  -b batch    operations per round for batched benchmarks "
+			"(default %d)\n"
+			"  -j file     also write the results as JSON to file\n"
+			"  -c          compare two JSON result files, exit 1 on "
+			"regression\n"
+			"  -t percent  p50 regression threshold for -c (default %.0f)\n",
+			DBENCH_DEFAULT_SAMPLES, DBENCH_DEFAULT_BATCH,
+			DBENCH_DEFAULT_THRESHOLD);
+	exit(2);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *filter = NULL, *json_path = NULL;
+	size_t samples = DBENCH_DEFAULT_SAMPLES, batch = DBENCH_DEFAULT_BATCH;
+	double threshold = DBENCH_DEFAULT_THRESHOLD;
+	bool list = false, compare = false;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "lf:n:b:j:ct:h")) != -1) {
+		switch (ch) {
+		case 'l': list = true; break;
+		case 'f': filter = optarg; break;
+		case 'n': samples = strtoul(optarg, NULL, 0); break;
+		case 'b': batch = strtoul(optarg, NULL, 0); break;
+		case 'j': json_path = optarg; break;
+		case 'c': compare = true; break;
+		case 't': threshold = strtod(optarg, NULL); break;
+		default: _dbench_usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (compare) {
+		if (argc != 2) _dbench_usage();
+		return _dbench_compare(argv[0], argv[1], threshold);
+	}
+	if (argc != 0 || samples == 0 || batch == 0) _dbench_usage();
+
+	size_t ncases = 0, nresults = 0;
+	for (size_t t = 0; t < countof(dbench_case_tables); t++) {
+		for (const dbench_case_s *c = dbench_case_tables[t]; c->dbc_name; c++) {
+			ncases++;
+		}
+	}
+	dbench_result_s *results = calloc(ncases, sizeof(*results));
+	if (!results) abort();
+
+	if (!list) _dbench_print_header(stdout);
+	for (size_t t = 0; t < countof(dbench_case_tables); t++) {
+		for (const dbench_case_s *c = dbench_case_tables[t]; c->dbc_name; c++) {
+			if (filter && fnmatch(filter, c->dbc_name, 0) != 0) {
+				continue;
+			}
+			if (list) {
+				printf("%s\n", c->dbc_name);
+				continue;
+			}
+			_dbench_run_case(c, samples, batch, &results[nresults]);
+			_dbench_print_result(stdout, &results[nresults]);
+			fflush(stdout);
+			nresults++;
+		}
+	}
+
+	if (json_path) {
+		FILE *f = fopen(json_path, "w");
+		if (!f) {
+			fprintf(stderr, "dispatch-bench: cannot write %s: %s\n",
+					json_path, strerror(errno));
+			return 2;
+		}
+		_dbench_write_json(f, results, nresults);
+		fclose(f);
+	}
+	free(results);
+	return 0;
+}
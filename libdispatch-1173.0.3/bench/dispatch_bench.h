@@ -0,0 +1,72 @@
+/*
+ * This source file is part of the Swift.org open source project
+ *
+ * Copyright (c) 2026 Apple Inc. and the Swift project authors
+ *
+ * Licensed under Apache License v2.0 with Runtime Library Exception
+ *
+ * See https://swift.org/LICENSE.txt for license information
+ * See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+ *
+ */
+
+#ifndef __DISPATCH_BENCH__
+#define __DISPATCH_BENCH__
+
+#include <dispatch/dispatch.h>
+#include <dispatch/private.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+__BEGIN_DECLS
+
+/*
+ * dispatch-bench harness
+ *
+ * A benchmark case is a function that performs `dbench_samples(b)` timed
+ * rounds and reports each of them with dbench_record(). A round may cover
+ * several operations (a batch), in which case the harness reports the
+ * per-operation cost of every round, so that percentiles reflect the
+ * distribution of rounds and not a single averaged figure.
+ */
+
+typedef struct dbench_s *dbench_t;
+
+typedef struct dbench_case_s {
+	const char *dbc_name;
+	void (*dbc_func)(dbench_t b, uintptr_t arg);
+	uintptr_t dbc_arg;
+} dbench_case_s;
+
+#define DBENCH_CASE(name, func, arg) { \
+		.dbc_name = (name), .dbc_func = (func), .dbc_arg = (uintptr_t)(arg) }
+
+// Monotonic nanoseconds, independent from the clock libdispatch uses
+uint64_t dbench_now(void);
+
+// Number of timed rounds the case must record
+size_t dbench_samples(dbench_t b);
+
+// Suggested number of operations per round for batched cases
+size_t dbench_batch(dbench_t b);
+
+// Records one round of `ops` operations that took `ns` nanoseconds
+void dbench_record(dbench_t b, uint64_t ns, size_t ops);
+
+// Aborts the benchmark with a message (setup failures, not regressions)
+void dbench_fail(dbench_t b, const char *msg) __attribute__((__noreturn__));
+
+// Defeats dead-code elimination of benchmark bodies
+extern volatile uintptr_t dbench_sink;
+
+// Case tables, each terminated by an entry with a NULL name
+extern const dbench_case_s dbench_queue_cases[];
+extern const dbench_case_s dbench_sync_cases[];
+extern const dbench_case_s dbench_source_cases[];
+extern const dbench_case_s dbench_io_cases[];
+
+__END_DECLS
+
+#endif /* __DISPATCH_BENCH__ */
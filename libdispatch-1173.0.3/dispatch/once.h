@@ -46,6 +46,15 @@ typedef intptr_t dispatch_once_t;
 #define DISPATCH_ONCE_INLINE_FASTPATH 1
 #elif defined(__APPLE__)
 #define DISPATCH_ONCE_INLINE_FASTPATH 1
+#elif defined(__linux__) && defined(__LP64__) && \
+		defined(DISPATCH_ONCE_QUIESCENT_RUNTIME) && \
+		DISPATCH_ONCE_QUIESCENT_RUNTIME >= 1
+// Opt-in: a plain load is only enough against a libdispatch which marks
+// initialized predicates done once membarrier(2) made every thread run a
+// barrier (DISPATCH_ONCE_QUIESCENT_RUNTIME 1 and later). Older ones mark
+// them done with a release store, which weakly ordered CPUs need to pair
+// with the acquire load of dispatch_once_f().
+#define DISPATCH_ONCE_INLINE_FASTPATH 1
 #else
 #define DISPATCH_ONCE_INLINE_FASTPATH 0
 #endif
@@ -206,11 +206,13 @@ DISPATCH_SOURCE_TYPE_DECL(mach_recv);
  * The handle is unused (pass zero for now).
  * The mask is a mask of desired events from
  * dispatch_source_memorypressure_flags_t.
+ * On Linux, the condition is derived from the memory pressure stall
+ * information (PSI) of the cgroup of the process.
  * 一种调度源（dispatch source），用于监视系统内存压力状况的变化。该句柄（handle）未使用（现在传递零）。mask 是来自 dispatch_source_mach_recv_flags_t 中所需事件的 mask。
  */
 #define DISPATCH_SOURCE_TYPE_MEMORYPRESSURE \
 		(&_dispatch_source_type_memorypressure)
-API_AVAILABLE(macos(10.9), ios(8.0)) DISPATCH_LINUX_UNAVAILABLE()
+API_AVAILABLE(macos(10.9), ios(8.0))
 DISPATCH_SOURCE_TYPE_DECL(memorypressure);
 
 /*!
@@ -82,6 +82,119 @@ uint64_t
 dispatch_benchmark_f(size_t count, void *_Nullable ctxt,
 		dispatch_function_t func);
 
+/*!
+ * @typedef dispatch_benchmark_attr_s
+ *
+ * @abstract
+ * Parameters of a dispatch_benchmark_ex() run.
+ *
+ * @field dba_iterations
+ * The number of timed samples each thread records. Must not be zero.
+ *
+ * @field dba_batch
+ * The number of times the function is called per sample. Samples are reported
+ * as the per-call cost of the batch. Use larger batches for functions whose
+ * cost is close to the resolution of the clock. Zero is treated as one.
+ *
+ * @field dba_warmup
+ * The number of untimed calls each thread performs before recording samples.
+ *
+ * @field dba_threads
+ * The number of threads running the benchmark concurrently, by means of
+ * dispatch_apply(). Zero and one run it on the calling thread only.
+ *
+ * @field dba_flags
+ * A combination of the DISPATCH_BENCHMARK_* flags.
+ */
+typedef struct dispatch_benchmark_attr_s {
+	size_t dba_iterations;
+	size_t dba_batch;
+	size_t dba_warmup;
+	size_t dba_threads;
+	unsigned long dba_flags;
+} dispatch_benchmark_attr_s;
+
+/*!
+ * @const DISPATCH_BENCHMARK_PERF_COUNTERS
+ * Also read hardware performance counters around the timed loop. This is only
+ * supported on Linux through perf_event_open(2), and is silently ignored when
+ * the counters cannot be opened (e.g. due to perf_event_paranoid).
+ */
+#define DISPATCH_BENCHMARK_PERF_COUNTERS 0x1ul
+
+/*!
+ * @typedef dispatch_benchmark_result_s
+ *
+ * @abstract
+ * Results of a dispatch_benchmark_ex() run.
+ *
+ * @discussion
+ * All durations are in nanoseconds per call, with the cost of the timing loop
+ * removed. Percentiles are computed from a log-linear histogram with a
+ * relative precision of about 6%, and are clamped to the observed minimum and
+ * maximum which are exact.
+ *
+ * Counter totals cover every timed call on every thread. They are only
+ * meaningful when dbr_flags contains DISPATCH_BENCHMARK_PERF_COUNTERS, and an
+ * individual counter reads as zero when the hardware does not provide it.
+ */
+typedef struct dispatch_benchmark_result_s {
+	uint64_t dbr_samples;
+	uint64_t dbr_calls;
+	uint64_t dbr_min;
+	uint64_t dbr_p50;
+	uint64_t dbr_p90;
+	uint64_t dbr_p99;
+	uint64_t dbr_p999;
+	uint64_t dbr_max;
+	uint64_t dbr_mean;
+	unsigned long dbr_flags;
+	uint64_t dbr_cycles;
+	uint64_t dbr_instructions;
+	uint64_t dbr_cache_misses;
+	uint64_t dbr_branch_misses;
+} dispatch_benchmark_result_s;
+
+/*!
+ * @function dispatch_benchmark_ex
+ *
+ * @abstract
+ * Measure the distribution of the time a given block takes to execute.
+ *
+ * @param attr
+ * The parameters of the run.
+ *
+ * @param block
+ * The block to execute. When dba_threads is larger than one, the block is
+ * executed concurrently and must be safe to do so.
+ *
+ * @param result
+ * The structure receiving the results.
+ *
+ * @result
+ * Zero on success, EINVAL if dba_iterations is zero.
+ *
+ * @discussion
+ * Unlike dispatch_benchmark() which only returns an average, this function
+ * records every sample so that outliers are visible in the high percentiles.
+ * The same caveats about interpreting concurrent results apply.
+ */
+#ifdef __BLOCKS__
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+int
+dispatch_benchmark_ex(const dispatch_benchmark_attr_s *attr,
+		dispatch_block_t block, dispatch_benchmark_result_s *result);
+#endif
+
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NONNULL3 DISPATCH_NONNULL4
+DISPATCH_NOTHROW
+int
+dispatch_benchmark_ex_f(const dispatch_benchmark_attr_s *attr,
+		void *_Nullable ctxt, dispatch_function_t func,
+		dispatch_benchmark_result_s *result);
+
 __END_DECLS
 
 DISPATCH_ASSUME_NONNULL_END
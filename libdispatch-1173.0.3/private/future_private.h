@@ -0,0 +1,293 @@
+/*
+ * This source file is part of the Swift.org open source project
+ *
+ * Copyright (c) 2026 Apple Inc. and the Swift project authors
+ *
+ * Licensed under Apache License v2.0 with Runtime Library Exception
+ *
+ * See https://swift.org/LICENSE.txt for license information
+ * See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+ *
+ */
+
+/*
+ * IMPORTANT: This header file describes INTERNAL interfaces to libdispatch
+ * which are subject to change in future releases. Any applications relying on
+ * these interfaces WILL break.
+ */
+
+#ifndef __DISPATCH_FUTURE_PRIVATE__
+#define __DISPATCH_FUTURE_PRIVATE__
+
+#ifndef __DISPATCH_INDIRECT__
+#error "Please #include <dispatch/private.h> instead of this file directly."
+#include <dispatch/base.h> // for HeaderDoc
+#endif
+
+DISPATCH_ASSUME_NONNULL_BEGIN
+
+__BEGIN_DECLS
+
+/*!
+ * @typedef dispatch_future_t
+ *
+ * @abstract
+ * A value that becomes available once, at a later time.
+ *
+ * @discussion
+ * Futures let a queue hand a result to another queue without blocking a
+ * thread on dispatch_sync() while it is being computed: the consumer
+ * attaches a function with dispatch_future_then_f(), which is submitted to
+ * its queue once the value is available.
+ *
+ * The value is an opaque pointer that the future never retains nor frees.
+ *
+ * Futures are not dispatch objects, they are retained and released with
+ * dispatch_future_retain() and dispatch_future_release(). They live in the
+ * same memory as work items, and are as cheap to create.
+ */
+typedef struct dispatch_future_s *dispatch_future_t;
+
+/*!
+ * @typedef dispatch_future_function_t
+ * The prototype of functions computing the value of a future.
+ */
+typedef void *_Nullable (*dispatch_future_function_t)(void *_Nullable context);
+
+/*!
+ * @typedef dispatch_future_then_function_t
+ * The prototype of functions computing the value of a future from the value
+ * of another.
+ */
+typedef void *_Nullable (*dispatch_future_then_function_t)(
+		void *_Nullable context, void *_Nullable value);
+
+/*!
+ * @function dispatch_future_create
+ *
+ * @abstract
+ * Creates a future to be completed with dispatch_future_complete().
+ *
+ * @result
+ * The newly created future, with a reference owned by the caller.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_WARN_RESULT DISPATCH_NOTHROW
+dispatch_future_t
+dispatch_future_create(void);
+
+/*!
+ * @function dispatch_future_complete
+ *
+ * @abstract
+ * Makes the value of a future available.
+ *
+ * @discussion
+ * The functions attached with dispatch_future_then_f() are submitted to
+ * their queue, and the threads blocked in dispatch_future_wait() woken up.
+ * Completing a future more than once is invalid and crashes.
+ *
+ * @param future
+ * The future to complete.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param value
+ * The value of the future.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+void
+dispatch_future_complete(dispatch_future_t future, void *_Nullable value);
+
+/*!
+ * @function dispatch_future_async_f
+ *
+ * @abstract
+ * Submits a function for asynchronous execution on a dispatch queue, and
+ * returns a future for its result.
+ *
+ * @param queue
+ * The target dispatch queue to which the function is submitted.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param context
+ * The application-defined context parameter to pass to the function.
+ *
+ * @param work
+ * The application-defined function to invoke on the target queue. The
+ * future is completed with the value it returns.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @result
+ * The future, with a reference owned by the caller.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NONNULL3 DISPATCH_WARN_RESULT
+DISPATCH_NOTHROW
+dispatch_future_t
+dispatch_future_async_f(dispatch_queue_t queue, void *_Nullable context,
+		dispatch_future_function_t work);
+
+/*!
+ * @function dispatch_future_then_f
+ *
+ * @abstract
+ * Schedules a function to be submitted to a queue with the value of a future
+ * once it is available, and returns a future for its result.
+ *
+ * @discussion
+ * No thread waits for the future in the meantime. When the future is already
+ * completed, the function is submitted right away.
+ *
+ * The function runs with the QoS and voucher of the caller of
+ * dispatch_future_then_f(), like with dispatch_async_f().
+ *
+ * @param future
+ * The future whose value is passed to the function.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param queue
+ * The target dispatch queue to which the function is submitted.
+ * The system will hold a reference on the target queue until the function
+ * has been submitted.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param context
+ * The application-defined context parameter to pass to the function.
+ *
+ * @param work
+ * The application-defined function to invoke on the target queue. The first
+ * parameter passed to this function is the context provided to
+ * dispatch_future_then_f(), the second one the value of the future. The
+ * returned future is completed with the value it returns.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @result
+ * A future for the result of the function, with a reference owned by the
+ * caller.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NONNULL2 DISPATCH_NONNULL4
+DISPATCH_WARN_RESULT DISPATCH_NOTHROW
+dispatch_future_t
+dispatch_future_then_f(dispatch_future_t future, dispatch_queue_t queue,
+		void *_Nullable context, dispatch_future_then_function_t work);
+
+/*!
+ * @function dispatch_future_all
+ *
+ * @abstract
+ * Returns a future completed once all of the specified futures are.
+ *
+ * @discussion
+ * The returned future is completed with NULL, the values are obtained from
+ * the futures themselves. It is completed right away when count is zero.
+ *
+ * @param futures
+ * The futures to combine. The array does not need to outlive the call.
+ *
+ * @param count
+ * The number of elements of the futures array.
+ *
+ * @result
+ * The combined future, with a reference owned by the caller.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_WARN_RESULT DISPATCH_NOTHROW
+dispatch_future_t
+dispatch_future_all(const dispatch_future_t _Nonnull *_Nullable futures,
+		size_t count);
+
+/*!
+ * @function dispatch_future_any
+ *
+ * @abstract
+ * Returns a future completed as soon as one of the specified futures is.
+ *
+ * @discussion
+ * The value of the returned future is the first of the futures to complete,
+ * on which the caller keeps its own reference.
+ *
+ * The combination retains every future until it completes, even after the
+ * returned future did.
+ *
+ * @param futures
+ * The futures to combine. The array does not need to outlive the call.
+ *
+ * @param count
+ * The number of elements of the futures array, passing zero is invalid and
+ * crashes.
+ *
+ * @result
+ * The combined future, with a reference owned by the caller.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_WARN_RESULT DISPATCH_NOTHROW
+dispatch_future_t
+dispatch_future_any(const dispatch_future_t _Nonnull *futures, size_t count);
+
+/*!
+ * @function dispatch_future_wait
+ *
+ * @abstract
+ * Waits synchronously until a future is completed, or the specified timeout
+ * has elapsed.
+ *
+ * @discussion
+ * This blocks the calling thread. Work items should prefer
+ * dispatch_future_then_f(), which doesn't occupy a worker thread while the
+ * value is computed. Passing DISPATCH_TIME_NOW polls the future.
+ *
+ * @param future
+ * The future to wait for.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param timeout
+ * When to timeout (see dispatch_time).
+ *
+ * @param value
+ * Where to store the value of the future on success, can be NULL.
+ *
+ * @result
+ * Returns zero on success, or non-zero if the timeout occurred.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+long
+dispatch_future_wait(dispatch_future_t future, dispatch_time_t timeout,
+		void *_Nullable *_Nullable value);
+
+/*!
+ * @function dispatch_future_retain
+ *
+ * @abstract
+ * Adds a reference to a future.
+ *
+ * @result
+ * The future passed in.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+dispatch_future_t
+dispatch_future_retain(dispatch_future_t future);
+
+/*!
+ * @function dispatch_future_release
+ *
+ * @abstract
+ * Drops a reference to a future.
+ *
+ * @discussion
+ * Pending dispatch_future_async_f() and dispatch_future_then_f() work items
+ * hold references of their own, releasing a future doesn't cancel them.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+void
+dispatch_future_release(dispatch_future_t future);
+
+__END_DECLS
+
+DISPATCH_ASSUME_NONNULL_END
+
+#endif // __DISPATCH_FUTURE_PRIVATE__
@@ -72,6 +72,7 @@
 #include <dispatch/io_private.h>
 #include <dispatch/layout_private.h>
 #include <dispatch/time_private.h>
+#include <dispatch/future_private.h>
 
 #undef __DISPATCH_INDIRECT__
 #endif /* !__DISPATCH_BUILDING_DISPATCH__ */
@@ -159,6 +160,225 @@ API_AVAILABLE(macos(10.12), ios(10.0), tvos(10.0), watchos(3.0))
 DISPATCH_EXPORT DISPATCH_NOTHROW
 void _dispatch_prohibit_transition_to_multithreaded(bool prohibit);
 
+/*!
+ * @typedef dispatch_continuation_depot_stats_s
+ *
+ * @abstract
+ * Counters of the process wide continuation depot, where per-thread caches of
+ * work items return their surplus and refill when they run empty.
+ *
+ * @field dcds_hits
+ * Number of empty thread caches refilled from the depot.
+ *
+ * @field dcds_misses
+ * Number of empty thread caches that found the depot empty and had to
+ * allocate from the heap.
+ *
+ * @field dcds_returns
+ * Number of batches returned to the depot by overflowing thread caches.
+ *
+ * @field dcds_overflows
+ * Number of batches freed to the heap because the depot was full.
+ *
+ * @field dcds_batches
+ * Number of batches currently held by the depot.
+ *
+ * @field dcds_batch_size
+ * Number of work items per batch.
+ */
+typedef struct dispatch_continuation_depot_stats_s {
+	uint64_t dcds_hits;
+	uint64_t dcds_misses;
+	uint64_t dcds_returns;
+	uint64_t dcds_overflows;
+	uint64_t dcds_batches;
+	uint64_t dcds_batch_size;
+} dispatch_continuation_depot_stats_s;
+
+/*!
+ * @function _dispatch_continuation_depot_get_stats
+ *
+ * @abstract
+ * Returns a snapshot of the continuation depot counters.
+ *
+ * @discussion
+ * The counters are updated without synchronization with each other and are
+ * only meant for performance analysis. All counters read as zero when the
+ * depot is not compiled in.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+void
+_dispatch_continuation_depot_get_stats(
+		dispatch_continuation_depot_stats_s *stats);
+
+/*!
+ * @function _dispatch_continuation_inline_depot_get_stats
+ *
+ * @abstract
+ * Returns a snapshot of the counters of the depot of the larger work items
+ * that hold a copy of a small block.
+ *
+ * @discussion
+ * Blocks submitted with dispatch_async(), dispatch_barrier_async() or
+ * dispatch_group_async() that are still on the stack and small enough are
+ * copied into the work item instead of being copied to the heap with
+ * Block_copy(). Those work items are recycled separately from the others.
+ * All counters read as zero when this isn't supported on the platform.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+void
+_dispatch_continuation_inline_depot_get_stats(
+		dispatch_continuation_depot_stats_s *stats);
+
+/*!
+ * @typedef dispatch_after_stats_s
+ *
+ * @abstract
+ * Counters of work items scheduled with dispatch_after() and its variants.
+ *
+ * @field das_scheduled
+ * Number of work items scheduled for later execution.
+ *
+ * @field das_fired
+ * Number of work items submitted to their queue when their time came.
+ *
+ * @field das_canceled
+ * Number of work items canceled with dispatch_after_cancel() before they
+ * fired.
+ */
+typedef struct dispatch_after_stats_s {
+	uint64_t das_scheduled;
+	uint64_t das_fired;
+	uint64_t das_canceled;
+} dispatch_after_stats_s;
+
+/*!
+ * @function _dispatch_after_get_stats
+ *
+ * @abstract
+ * Returns a snapshot of the dispatch_after() counters.
+ *
+ * @discussion
+ * The counters are updated without synchronization with each other and are
+ * only meant for performance analysis. Work items submitted right away
+ * because their time had already come are not counted.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+void
+_dispatch_after_get_stats(dispatch_after_stats_s *stats);
+
+/*!
+ * @typedef dispatch_event_loop_stats_s
+ *
+ * @abstract
+ * Counters of the wakeups of the thread running the event loop.
+ *
+ * @field dels_pokes
+ * Number of times the event loop was asked to wake up, to look at new work
+ * on the manager queue, timers or sources.
+ *
+ * @field dels_writes
+ * Number of those requests that had to wake the event loop with a system
+ * call, the others found a wakeup already pending.
+ */
+typedef struct dispatch_event_loop_stats_s {
+	uint64_t dels_pokes;
+	uint64_t dels_writes;
+} dispatch_event_loop_stats_s;
+
+/*!
+ * @function _dispatch_event_loop_get_stats
+ *
+ * @abstract
+ * Returns a snapshot of the event loop wakeup counters.
+ *
+ * @discussion
+ * The counters are updated without synchronization with each other and are
+ * only meant for performance analysis. All counters read as zero with event
+ * loops that don't maintain them, which currently is all but epoll, and
+ * unless libdispatch is a debug build or was built along with dispatch-bench,
+ * as they slow down every wakeup request.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+void
+_dispatch_event_loop_get_stats(dispatch_event_loop_stats_s *stats);
+
+/*!
+ * @function dispatch_group_create_batched
+ *
+ * @abstract
+ * Creates a dispatch group whose dispatch_group_async() items leave it in
+ * batches.
+ *
+ * @discussion
+ * The group behaves like one returned by dispatch_group_create(), but the
+ * worker threads of the global concurrent queues accumulate the completions
+ * of its dispatch_group_async() items and apply them to the group with one
+ * atomic operation per batch, instead of one per item. This cuts down on
+ * the contention on the group when many threads complete small items of the
+ * same group at a high rate.
+ *
+ * A worker thread only holds on to completions while it keeps running items
+ * of the same group, so dispatch_group_wait() and dispatch_group_notify()
+ * observe the group becoming empty as they would otherwise.
+ *
+ * @result
+ * The newly created group, or NULL on failure.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_MALLOC DISPATCH_RETURNS_RETAINED DISPATCH_WARN_RESULT
+DISPATCH_NOTHROW
+dispatch_group_t
+dispatch_group_create_batched(void);
+
+/*!
+ * @function dispatch_group_enter_n
+ *
+ * @abstract
+ * Manually indicate several blocks have entered the group.
+ *
+ * @discussion
+ * Equivalent to calling dispatch_group_enter() n times, with a single atomic
+ * operation. Passing zero is a no-op.
+ *
+ * @param group
+ * The dispatch group to update.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param n
+ * The number of blocks entering the group.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+void
+dispatch_group_enter_n(dispatch_group_t group, size_t n);
+
+/*!
+ * @function dispatch_group_leave_n
+ *
+ * @abstract
+ * Manually indicate several blocks in the group have completed.
+ *
+ * @discussion
+ * Equivalent to calling dispatch_group_leave() n times, with a single atomic
+ * operation. Passing zero is a no-op.
+ *
+ * @param group
+ * The dispatch group to update.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param n
+ * The number of blocks leaving the group.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+void
+dispatch_group_leave_n(dispatch_group_t group, size_t n);
+
 /*
  * dispatch_time convenience macros
  */
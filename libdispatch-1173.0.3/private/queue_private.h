@@ -42,9 +42,16 @@ __BEGIN_DECLS
  * @constant DISPATCH_QUEUE_OVERCOMMIT
  * The queue will create a new thread for invoking blocks, regardless of how
  * busy the computer is.
+ *
+ * @constant DISPATCH_QUEUE_COOPERATIVE
+ * The queue invokes blocks on a pool of at most one thread per active CPU,
+ * which never grows, even when the blocks it runs block. Intended for
+ * CPU-bound work, see dispatch_cooperative_yield().
+ * Cannot be combined with DISPATCH_QUEUE_OVERCOMMIT.
  */
 enum {
 	DISPATCH_QUEUE_OVERCOMMIT = 0x2ull,
+	DISPATCH_QUEUE_COOPERATIVE = 0x4ull,
 };
 
 /*!
@@ -147,7 +154,8 @@ void
 dispatch_set_qos_class_fallback(dispatch_object_t object,
 		dispatch_qos_class_t qos_class);
 
-#define DISPATCH_QUEUE_FLAGS_MASK (DISPATCH_QUEUE_OVERCOMMIT)
+#define DISPATCH_QUEUE_FLAGS_MASK \
+		(DISPATCH_QUEUE_OVERCOMMIT | DISPATCH_QUEUE_COOPERATIVE)
 
 /*!
  * @function dispatch_queue_attr_make_with_overcommit
@@ -425,6 +433,627 @@ void
 dispatch_async_enforce_qos_class_f(dispatch_queue_t queue,
 		void *_Nullable context, dispatch_function_t work);
 
+/*!
+ * @function dispatch_async_batch_f
+ *
+ * @abstract
+ * Submits a function for asynchronous execution on a dispatch queue, once for
+ * each of the specified contexts.
+ *
+ * @discussion
+ * This is equivalent to calling dispatch_async_f() in a loop for each element
+ * of the contexts array, in order, but the work items are allocated in bulk,
+ * published on the target queue with a single atomic operation, and cause at
+ * most one wakeup of the queue.
+ *
+ * When the queue is a global concurrent queue, the number of worker threads
+ * requested is sized to the batch rather than one per item.
+ *
+ * @param queue
+ * The target dispatch queue to which the function is submitted.
+ * The system will hold a reference on the target queue until the last
+ * function has returned.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param count
+ * The number of elements of the contexts array. Passing zero is a no-op.
+ *
+ * @param contexts
+ * The application-defined context parameters to pass to each invocation of
+ * the function.
+ *
+ * @param work
+ * The application-defined function to invoke on the target queue. The first
+ * parameter passed to this function is one of the contexts provided to
+ * dispatch_async_batch_f().
+ * The result of passing NULL in this parameter is undefined.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NONNULL4 DISPATCH_NOTHROW
+void
+dispatch_async_batch_f(dispatch_queue_t queue, size_t count,
+		void *_Nullable const *_Nullable contexts, dispatch_function_t work);
+
+/*!
+ * @typedef dispatch_after_handle_t
+ *
+ * @abstract
+ * A handle on a work item submitted with dispatch_after_cancellable_f().
+ *
+ * @discussion
+ * Handles are not dispatch objects and cannot be retained. Every handle
+ * must be disposed of with exactly one call to dispatch_after_cancel() or to
+ * dispatch_after_handle_release().
+ */
+typedef struct dispatch_after_handle_s *dispatch_after_handle_t;
+
+/*!
+ * @function dispatch_after_cancellable_f
+ *
+ * @abstract
+ * Schedules a function for execution on a given queue at a specified time,
+ * and returns a handle that can cancel it.
+ *
+ * @discussion
+ * Behaves like dispatch_after_f(), with the same leeway. Unlike wrapping the
+ * work in a cancellable block, canceling the handle removes the item from
+ * the timer it was scheduled on, so that it neither wakes up the system nor
+ * reaches the queue.
+ *
+ * @param when
+ * A temporal milestone returned by dispatch_time() or dispatch_walltime().
+ * Passing DISPATCH_TIME_FOREVER schedules nothing and returns NULL.
+ *
+ * @param queue
+ * The queue to which the function will be submitted.
+ * The system will hold a reference on the queue until the function has been
+ * submitted, or the handle has been canceled.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param context
+ * The application-defined context parameter to pass to the function.
+ *
+ * @param work
+ * The application-defined function to invoke on the target queue.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @result
+ * A handle to pass to dispatch_after_cancel() or
+ * dispatch_after_handle_release().
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL2 DISPATCH_NONNULL4 DISPATCH_WARN_RESULT
+DISPATCH_NOTHROW
+dispatch_after_handle_t _Nullable
+dispatch_after_cancellable_f(dispatch_time_t when, dispatch_queue_t queue,
+		void *_Nullable context, dispatch_function_t work);
+
+/*!
+ * @function dispatch_after_cancel
+ *
+ * @abstract
+ * Cancels a work item scheduled with dispatch_after_cancellable_f() if it
+ * hasn't been submitted to its queue yet, and disposes of the handle.
+ *
+ * @discussion
+ * On success, the function will not be called, and the work item is freed
+ * before this function returns. The timer entry of the work item and the
+ * reference it holds on its queue are released asynchronously, once the
+ * timer has been removed by the thread which manages timers. The context is
+ * not touched, and remains owned by the caller.
+ *
+ * @param handle
+ * The handle to cancel, passing NULL is a no-op. The handle is invalid once
+ * this function returns.
+ *
+ * @result
+ * true if the work item was canceled, false if it had already been submitted
+ * to its queue.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NOTHROW
+bool
+dispatch_after_cancel(dispatch_after_handle_t _Nullable handle);
+
+/*!
+ * @function dispatch_after_handle_release
+ *
+ * @abstract
+ * Disposes of a handle returned by dispatch_after_cancellable_f() without
+ * canceling the work item.
+ *
+ * @param handle
+ * The handle to dispose of, passing NULL is a no-op.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NOTHROW
+void
+dispatch_after_handle_release(dispatch_after_handle_t _Nullable handle);
+
+/*!
+ * @function dispatch_cooperative_yield
+ *
+ * @abstract
+ * Returns whether the caller should give up the thread it runs on to let
+ * other work of its cooperative pool run.
+ *
+ * @discussion
+ * Cooperative queues, obtained by passing DISPATCH_QUEUE_COOPERATIVE to
+ * dispatch_get_global_queue(), never run more threads than there are active
+ * CPUs. A long running work item therefore delays every item enqueued behind
+ * it, and should call this function at convenient points.
+ *
+ * When it returns true, the caller is expected to save its progress,
+ * resubmit the remainder of its work to the queue it is running on with
+ * dispatch_async() and return. Work items of serial queues targeting a
+ * cooperative queue only yield to the other items of that serial queue.
+ *
+ * This function returns false when the caller isn't running on behalf of a
+ * cooperative queue, or when no other work is waiting for a thread.
+ *
+ * @result
+ * Whether the current work item should yield.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_WARN_RESULT DISPATCH_NOTHROW
+bool
+dispatch_cooperative_yield(void);
+
+/*!
+ * @function dispatch_queue_set_sticky
+ *
+ * @abstract
+ * Hints that a serial queue should preferably be drained on the CPU that
+ * drained it last.
+ *
+ * @discussion
+ * Serial queues holding state of their own, such as actors, lose their
+ * working set from the CPU caches every time a different worker thread picks
+ * them up. Sticky queues are first offered to the worker running on the CPU
+ * they last ran on, other workers only take them when they have nothing else
+ * to run, or after a short delay.
+ *
+ * This is a hint: it has no effect on queues targeting another queue than a
+ * global root queue, and may be ignored when several sticky queues last ran
+ * on the same CPU.
+ *
+ * @param queue
+ * The serial queue to modify. Passing another kind of object is undefined
+ * and will cause the process to be terminated.
+ *
+ * @param sticky
+ * Whether the queue should be sticky.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+void
+dispatch_queue_set_sticky(dispatch_queue_t queue, bool sticky);
+
+/*!
+ * @typedef dispatch_queue_capacity_policy_t
+ * What happens when work is submitted to a queue which already holds as many
+ * pending work items as its capacity, see dispatch_queue_set_capacity().
+ *
+ * @const DISPATCH_QUEUE_CAPACITY_FAIL
+ * dispatch_async_try() and dispatch_async_try_f() fail. Other submission
+ * functions still enqueue the work item, beyond the capacity.
+ *
+ * @const DISPATCH_QUEUE_CAPACITY_BLOCK
+ * The submitting thread blocks until a work item has been dequeued. Threads
+ * running on the queue (or on a queue targeting it) never block, to avoid
+ * deadlocking it, and enqueue beyond the capacity instead.
+ *
+ * @const DISPATCH_QUEUE_CAPACITY_DROP_OLDEST
+ * The work item is enqueued, and the oldest pending one is discarded without
+ * being invoked, by the submitting thread. Barriers, group members and
+ * blocks made with dispatch_block_create() are never discarded, and don't
+ * count against the capacity. Discarded blocks are released, the context of
+ * discarded functions is passed to the handler set with
+ * dispatch_queue_set_capacity_drop_handler_f(), if any.
+ */
+DISPATCH_ENUM(dispatch_queue_capacity_policy, unsigned long,
+	DISPATCH_QUEUE_CAPACITY_FAIL = 0,
+	DISPATCH_QUEUE_CAPACITY_BLOCK,
+	DISPATCH_QUEUE_CAPACITY_DROP_OLDEST,
+);
+
+/*!
+ * @function dispatch_queue_set_capacity
+ *
+ * @abstract
+ * Bounds the number of work items a queue holds before they are invoked.
+ *
+ * @discussion
+ * Queues accept work items without limit, and a consumer slower than its
+ * producers lets them grow until memory runs out. A bounded queue tracks
+ * how many work items were submitted to it and not dequeued yet, and applies
+ * the specified policy when that number reaches the capacity.
+ *
+ * dispatch_sync(), dispatch_async_and_wait() and queues targeting this one
+ * do not count against the capacity.
+ *
+ * This function must be called before the queue is activated, on a queue
+ * created with an inactive attribute.
+ *
+ * @param queue
+ * The serial or concurrent queue to modify. Passing another kind of object
+ * is undefined and will cause the process to be terminated.
+ *
+ * @param capacity
+ * The maximum number of pending work items, which must not be 0.
+ *
+ * @param policy
+ * What happens when the queue is full.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+void
+dispatch_queue_set_capacity(dispatch_queue_t queue, size_t capacity,
+		dispatch_queue_capacity_policy_t policy);
+
+/*!
+ * @function dispatch_queue_set_capacity_drop_handler_f
+ *
+ * @abstract
+ * Sets the function a DISPATCH_QUEUE_CAPACITY_DROP_OLDEST queue calls for
+ * each function work item it discards.
+ *
+ * @discussion
+ * The handler is called on the thread which submitted the work item that
+ * caused the discard, with the context of the discarded work item, so that
+ * it can be released.
+ *
+ * This function must be called before the queue is activated, on a queue
+ * created with an inactive attribute.
+ *
+ * @param queue
+ * The serial or concurrent queue to modify. Passing another kind of object
+ * is undefined and will cause the process to be terminated.
+ *
+ * @param handler
+ * The function to call, or NULL.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+void
+dispatch_queue_set_capacity_drop_handler_f(dispatch_queue_t queue,
+		dispatch_function_t _Nullable handler);
+
+/*!
+ * @function dispatch_async_try_f
+ *
+ * @abstract
+ * Submits a function for asynchronous execution on a dispatch queue, unless
+ * it is full.
+ *
+ * @discussion
+ * Behaves like dispatch_async_f() on queues without a capacity. On bounded
+ * queues, whatever their policy, this function never blocks and fails
+ * instead. On DISPATCH_QUEUE_CAPACITY_DROP_OLDEST queues, a work item may
+ * still be discarded when other threads submit concurrently.
+ *
+ * @param queue
+ * The target dispatch queue to which the function is submitted.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param context
+ * The application-defined context parameter to pass to the function.
+ *
+ * @param work
+ * The application-defined function to invoke on the target queue.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @result
+ * true if the function was submitted, false if the queue was full.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NONNULL3 DISPATCH_NOTHROW
+bool
+dispatch_async_try_f(dispatch_queue_t queue, void *_Nullable context,
+		dispatch_function_t work);
+
+#ifdef __BLOCKS__
+/*!
+ * @function dispatch_async_try
+ *
+ * @abstract
+ * Submits a block for asynchronous execution on a dispatch queue, unless
+ * it is full.
+ *
+ * @discussion
+ * See dispatch_async_try_f() for details.
+ *
+ * @result
+ * true if the block was submitted, false if the queue was full.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+bool
+dispatch_async_try(dispatch_queue_t queue, dispatch_block_t block);
+#endif
+
+/*!
+ * @typedef dispatch_queue_deadline_flags_t
+ * Options for dispatch_queue_set_deadline_scheduling().
+ *
+ * @const DISPATCH_QUEUE_DEADLINE_DROP_EXPIRED
+ * Work items whose deadline has passed by the time they would start are
+ * discarded without being invoked, unless they are blocks made with
+ * dispatch_block_create(). The context of discarded functions is not
+ * released.
+ */
+DISPATCH_OPTIONS(dispatch_queue_deadline_flags, unsigned long,
+	DISPATCH_QUEUE_DEADLINE_NONE = 0x0,
+	DISPATCH_QUEUE_DEADLINE_DROP_EXPIRED = 0x1,
+);
+
+/*!
+ * @typedef dispatch_queue_deadline_stats_s
+ * Deadline counters of a queue, see dispatch_queue_get_deadline_stats().
+ *
+ * @field dqds_executed
+ * The number of work items with a deadline that were invoked.
+ *
+ * @field dqds_missed
+ * The number of invoked work items that returned after their deadline.
+ *
+ * @field dqds_dropped
+ * The number of work items discarded by DISPATCH_QUEUE_DEADLINE_DROP_EXPIRED.
+ *
+ * @field dqds_max_lateness
+ * The largest delay, in nanoseconds, between the deadline of a work item and
+ * the time it returned.
+ */
+typedef struct dispatch_queue_deadline_stats_s {
+	uint64_t dqds_executed;
+	uint64_t dqds_missed;
+	uint64_t dqds_dropped;
+	uint64_t dqds_max_lateness;
+} dispatch_queue_deadline_stats_s;
+
+/*!
+ * @function dispatch_queue_set_deadline_scheduling
+ *
+ * @abstract
+ * Makes a queue invoke the work items submitted with
+ * dispatch_async_with_deadline_f() in earliest deadline first order.
+ *
+ * @discussion
+ * Queues run work items in submission order, which lets a burst of requests
+ * with distant deadlines delay an urgent one past its own. Deadline queues
+ * keep the pending work items with a deadline in a heap, and every time the
+ * queue dequeues one of them, it invokes the one with the earliest deadline
+ * instead. Work items with equal deadlines run in submission order. Each
+ * work item runs with the priority and voucher it was submitted with.
+ *
+ * Work items submitted with other functions aren't reordered. Work items
+ * with a deadline are never discarded by a
+ * DISPATCH_QUEUE_CAPACITY_DROP_OLDEST capacity, and don't count against it.
+ *
+ * This function must be called before the queue is activated, on a queue
+ * created with an inactive attribute.
+ *
+ * @param queue
+ * The serial or concurrent queue to modify. Passing another kind of object
+ * is undefined and will cause the process to be terminated.
+ *
+ * @param flags
+ * Options for the queue.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+void
+dispatch_queue_set_deadline_scheduling(dispatch_queue_t queue,
+		dispatch_queue_deadline_flags_t flags);
+
+/*!
+ * @function dispatch_async_with_deadline_f
+ *
+ * @abstract
+ * Submits a function for asynchronous execution on a dispatch queue, to be
+ * invoked by the specified deadline.
+ *
+ * @discussion
+ * On queues set up with dispatch_queue_set_deadline_scheduling(), the work
+ * item is ordered by its deadline. On other queues, the deadline is ignored
+ * and this function behaves like dispatch_async_f().
+ *
+ * @param queue
+ * The target dispatch queue to which the function is submitted.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param deadline
+ * The time by which the function should have returned.
+ * DISPATCH_TIME_FOREVER sorts after every other deadline.
+ *
+ * @param context
+ * The application-defined context parameter to pass to the function.
+ *
+ * @param work
+ * The application-defined function to invoke on the target queue.
+ * The result of passing NULL in this parameter is undefined.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NONNULL4 DISPATCH_NOTHROW
+void
+dispatch_async_with_deadline_f(dispatch_queue_t queue,
+		dispatch_time_t deadline, void *_Nullable context,
+		dispatch_function_t work);
+
+#ifdef __BLOCKS__
+/*!
+ * @function dispatch_async_with_deadline
+ *
+ * @abstract
+ * Submits a block for asynchronous execution on a dispatch queue, to be
+ * invoked by the specified deadline.
+ *
+ * @discussion
+ * See dispatch_async_with_deadline_f() for details.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NONNULL3 DISPATCH_NOTHROW
+void
+dispatch_async_with_deadline(dispatch_queue_t queue,
+		dispatch_time_t deadline, dispatch_block_t block);
+#endif
+
+/*!
+ * @function dispatch_queue_get_deadline_stats
+ *
+ * @abstract
+ * Reads the deadline counters of a queue set up with
+ * dispatch_queue_set_deadline_scheduling().
+ *
+ * @discussion
+ * The counters are updated without synchronization with one another, and
+ * may be slightly out of date with respect to each other.
+ *
+ * @param queue
+ * The queue to inspect. Counters of other queues read as 0.
+ *
+ * @param stats
+ * Filled with the counters of the queue.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+void
+dispatch_queue_get_deadline_stats(dispatch_queue_t queue,
+		dispatch_queue_deadline_stats_s *stats);
+
+/*!
+ * @function dispatch_queue_set_rate_limit
+ *
+ * @abstract
+ * Caps the rate at which a queue starts its work items.
+ *
+ * @discussion
+ * Rate limited queues hold a token bucket which refills at the specified
+ * rate, up to the specified burst. Every time the queue dequeues a work item,
+ * it takes a token from the bucket. When the bucket is empty, the queue stops
+ * draining until the next token is available, and is woken up by a timer:
+ * it doesn't occupy any thread while it waits.
+ *
+ * The rate applies to the start of work items: on a concurrent queue, work
+ * items started within the rate may run in parallel.
+ *
+ * dispatch_sync(), dispatch_async_and_wait() and queues targeting this one
+ * do not take tokens.
+ *
+ * This function must be called before the queue is activated, on a queue
+ * created with an inactive attribute.
+ *
+ * @param queue
+ * The serial or concurrent queue to modify. Passing another kind of object
+ * is undefined and will cause the process to be terminated.
+ *
+ * @param rate
+ * The number of work items the queue may start per second, between 1 and
+ * NSEC_PER_SEC. Passing another value will cause the process to be terminated.
+ *
+ * @param burst
+ * The number of work items the queue may start at once after being idle.
+ * Passing 0 will cause the process to be terminated.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+void
+dispatch_queue_set_rate_limit(dispatch_queue_t queue, size_t rate,
+		size_t burst);
+
+/*!
+ * @typedef dispatch_introspection_drain_item_s
+ *
+ * @abstract
+ * A work item run by a worker thread, as reported to the drain_batch hook.
+ *
+ * @field item
+ * Opaque identifier of the item, matching the item passed to the
+ * item_enqueued hook when it was enqueued. It must NOT be dereferenced, the
+ * item may have been freed by the time the hook is called.
+ *
+ * @field queue
+ * The queue the item was dequeued from. Items which are queues span the items
+ * drained from them, which are reported first.
+ *
+ * @field start
+ * @field end
+ * When the item started and finished running, as dispatch_time(
+ * DISPATCH_TIME_NOW, 0) would have returned.
+ */
+typedef struct dispatch_introspection_drain_item_s {
+	const void *item;
+	dispatch_queue_t queue;
+	uint64_t start;
+	uint64_t end;
+} dispatch_introspection_drain_item_s;
+
+/*!
+ * @typedef dispatch_introspection_drain_batch_s
+ *
+ * @field root_queue
+ * The root queue the worker thread was draining.
+ *
+ * @field count
+ * Number of entries in items, in the order the items finished running.
+ */
+typedef struct dispatch_introspection_drain_batch_s {
+	dispatch_queue_t root_queue;
+	unsigned long count;
+	const dispatch_introspection_drain_item_s *items;
+} dispatch_introspection_drain_batch_s;
+
+typedef void (*dispatch_introspection_hook_item_enqueued_t)(
+		dispatch_queue_t queue, const void *item);
+typedef void (*dispatch_introspection_hook_drain_batch_t)(
+		const dispatch_introspection_drain_batch_s *batch);
+
+/*!
+ * @typedef dispatch_introspection_batch_hooks_s
+ *
+ * @field item_enqueued
+ * Called for every item enqueued onto a queue, from the enqueuing thread.
+ *
+ * @field drain_batch
+ * Called on a worker thread with the items it ran since the last call, at
+ * the latest when it is done draining its root queue. Items run by the main
+ * queue or by dispatch_sync() are not reported.
+ */
+typedef struct dispatch_introspection_batch_hooks_s {
+	dispatch_introspection_hook_item_enqueued_t _Nullable item_enqueued;
+	dispatch_introspection_hook_drain_batch_t _Nullable drain_batch;
+	void *_Nullable _reserved[4];
+} dispatch_introspection_batch_hooks_s;
+typedef dispatch_introspection_batch_hooks_s
+		*dispatch_introspection_batch_hooks_t;
+
+/*!
+ * @function dispatch_introspection_batch_hooks_install
+ *
+ * @abstract
+ * Installs lightweight hooks for profilers, available in all builds of
+ * libdispatch.
+ *
+ * @discussion
+ * Unlike the hooks of the introspection flavor of libdispatch, these hooks
+ * cost a single branch per enqueue and per drain when none is installed.
+ * Pass a structure with NULL hooks to uninstall them.
+ *
+ * Hooks may still be called for a short while after they were uninstalled,
+ * and a worker thread already draining its root queue when the drain_batch
+ * hook is installed only reports items after it starts its next drain.
+ *
+ * This function must not be called concurrently with itself.
+ *
+ * @param hooks
+ * Hooks to install, on return the previously installed hooks.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+void
+dispatch_introspection_batch_hooks_install(
+		dispatch_introspection_batch_hooks_t hooks);
+
 #ifdef __ANDROID__
 /*!
  * @function _dispatch_install_thread_detach_callback
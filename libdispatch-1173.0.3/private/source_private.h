@@ -123,6 +123,28 @@ DISPATCH_SOURCE_TYPE_DECL(sock);
 API_AVAILABLE(macos(10.13), ios(11.0), tvos(11.0), watchos(4.0)) DISPATCH_LINUX_UNAVAILABLE()
 DISPATCH_SOURCE_TYPE_DECL(nw_channel);
 
+/*!
+ * @const DISPATCH_SOURCE_TYPE_DATA_ADD_SHARDED
+ * @discussion A variant of DISPATCH_SOURCE_TYPE_DATA_ADD for sources that
+ * many threads call dispatch_source_merge_data() on concurrently.
+ * Merged values are accumulated in one cacheline per CPU, which are summed
+ * when the event handler is called, instead of a single shared word.
+ */
+#define DISPATCH_SOURCE_TYPE_DATA_ADD_SHARDED \
+		(&_dispatch_source_type_data_add_sharded)
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_SOURCE_TYPE_DECL(data_add_sharded);
+
+/*!
+ * @const DISPATCH_SOURCE_TYPE_DATA_OR_SHARDED
+ * @discussion A variant of DISPATCH_SOURCE_TYPE_DATA_OR, with per-CPU
+ * accumulation like DISPATCH_SOURCE_TYPE_DATA_ADD_SHARDED.
+ */
+#define DISPATCH_SOURCE_TYPE_DATA_OR_SHARDED \
+		(&_dispatch_source_type_data_or_sharded)
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_SOURCE_TYPE_DECL(data_or_sharded);
+
 __END_DECLS
 
 /*!
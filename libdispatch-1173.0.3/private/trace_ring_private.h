@@ -0,0 +1,254 @@
+/*
+ * This source file is part of the Swift.org open source project
+ *
+ * Copyright (c) 2026 Apple Inc. and the Swift project authors
+ *
+ * Licensed under Apache License v2.0 with Runtime Library Exception
+ *
+ * See https://swift.org/LICENSE.txt for license information
+ * See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+ *
+ */
+
+/*
+ * IMPORTANT: This header file describes INTERNAL interfaces to libdispatch
+ * which are subject to change in future releases of Mac OS X. Any applications
+ * relying on these interfaces WILL break.
+ */
+
+#ifndef __DISPATCH_TRACE_RING_PRIVATE__
+#define __DISPATCH_TRACE_RING_PRIVATE__
+
+/*!
+ * @header
+ *
+ * @abstract
+ * Binary trace ring SPI for libdispatch.
+ *
+ * @discussion
+ * On platforms without firehose, libdispatch can record its queue, callout
+ * and timer activity into a memory-mapped file, by running a process with the
+ * environment variable LIBDISPATCH_TRACE_RING set to the path of the file.
+ * LIBDISPATCH_TRACE_RING_SIZE optionally sets the size of the file in MiB,
+ * it defaults to 64.
+ *
+ * The file is a ring of fixed size chunks, each holding events recorded by a
+ * single thread. Once the ring is full, the oldest chunks are overwritten.
+ * Threads never block on the file: when the background thread that drains
+ * events to the file falls behind, events are dropped and counted.
+ *
+ * Setting LIBDISPATCH_TRACE_CHROME to a path instead, or as well, converts
+ * the ring to the Chrome trace event JSON format when the process exits, which
+ * chrome://tracing and the Perfetto UI load: callouts are slices on the thread
+ * that ran them, with a flow arrow from the enqueue of their work item, and
+ * worker thread park/unpark and sync contention are instant events. Without
+ * LIBDISPATCH_TRACE_RING the ring then lives in anonymous memory.
+ *
+ * This header describes the layout of the file, which dispatch-trace-decode
+ * turns back into text. It can be included without any other header.
+ */
+
+#include <stdint.h>
+
+#ifndef __BEGIN_DECLS
+#if defined(__cplusplus)
+#define	__BEGIN_DECLS extern "C" {
+#define	__END_DECLS }
+#else
+#define	__BEGIN_DECLS
+#define	__END_DECLS
+#endif
+#endif
+
+__BEGIN_DECLS
+
+#define DISPATCH_TRACE_RING_MAGIC		0x676e697268637464ull // "dtchring"
+#define DISPATCH_TRACE_RING_VERSION		1
+#define DISPATCH_TRACE_RING_CHUNK_SIZE	4096u
+
+/*!
+ * @enum dispatch_trace_ring_event_type_t
+ *
+ * @constant DISPATCH_TRACE_RING_QUEUE_PUSH
+ * An item was pushed onto a queue.
+ * arg1: queue, arg2: item, arg3: queue serial number.
+ *
+ * @constant DISPATCH_TRACE_RING_QUEUE_POP
+ * An item was popped from a queue.
+ * arg1: queue, arg2: item, arg3: queue serial number.
+ *
+ * @constant DISPATCH_TRACE_RING_CALLOUT_ENTRY
+ * A client function is about to be called.
+ * arg1: function, arg2: context, arg3: current queue serial number.
+ *
+ * @constant DISPATCH_TRACE_RING_CALLOUT_RETURN
+ * A client function returned.
+ * arg1: function, arg2: context, arg3: current queue serial number.
+ *
+ * @constant DISPATCH_TRACE_RING_TIMER_PROGRAM
+ * The manager programmed the next wakeup of a timer.
+ * arg1: timer, arg2: delay until the wakeup in nanoseconds, arg3: timer
+ * clock.
+ *
+ * @constant DISPATCH_TRACE_RING_TIMER_FIRE
+ * A timer fired.
+ * arg1: timer, arg2: number of times it fired, arg3: of which were missed.
+ *
+ * @constant DISPATCH_TRACE_RING_RUNTIME_EVENT
+ * An event also delivered to the runtime_event introspection hook.
+ * arg1: ptr, arg2: value, arg3: dispatch_introspection_runtime_event kind.
+ */
+typedef enum dispatch_trace_ring_event_type_e {
+	DISPATCH_TRACE_RING_QUEUE_PUSH = 1,
+	DISPATCH_TRACE_RING_QUEUE_POP = 2,
+	DISPATCH_TRACE_RING_CALLOUT_ENTRY = 3,
+	DISPATCH_TRACE_RING_CALLOUT_RETURN = 4,
+	DISPATCH_TRACE_RING_TIMER_PROGRAM = 5,
+	DISPATCH_TRACE_RING_TIMER_FIRE = 6,
+	DISPATCH_TRACE_RING_RUNTIME_EVENT = 7,
+} dispatch_trace_ring_event_type_t;
+
+/*!
+ * @typedef dispatch_trace_ring_event_s
+ *
+ * @abstract
+ * A single event, in the timebase described by the file header.
+ */
+typedef struct dispatch_trace_ring_event_s {
+	uint64_t dtre_timestamp;
+	uint64_t dtre_arg1;
+	uint64_t dtre_arg2;
+	uint32_t dtre_type;
+	uint32_t dtre_arg3;
+} dispatch_trace_ring_event_s;
+
+/*!
+ * @typedef dispatch_trace_ring_chunk_s
+ *
+ * @abstract
+ * A chunk of events recorded by a single thread, in the order they were
+ * recorded.
+ *
+ * @field dtrc_seq
+ * Position of the chunk in the file, in number of chunks written since the
+ * file was created.
+ */
+typedef struct dispatch_trace_ring_chunk_s {
+	uint64_t dtrc_seq;
+	uint64_t dtrc_thread;
+	uint32_t dtrc_cpu;
+	uint32_t dtrc_count;
+	uint64_t dtrc_reserved;
+	dispatch_trace_ring_event_s dtrc_events[
+			(DISPATCH_TRACE_RING_CHUNK_SIZE - 32) /
+			sizeof(dispatch_trace_ring_event_s)];
+} dispatch_trace_ring_chunk_s;
+
+#define DISPATCH_TRACE_RING_CHUNK_EVENTS \
+		(sizeof(((dispatch_trace_ring_chunk_s *)0)->dtrc_events) / \
+		sizeof(dispatch_trace_ring_event_s))
+
+/*!
+ * @typedef dispatch_trace_ring_header_s
+ *
+ * @abstract
+ * The first chunk of the file, followed by dtrh_chunk_count event chunks.
+ *
+ * @field dtrh_chunk_seq
+ * Number of chunks written since the file was created, the next chunk goes
+ * at index (dtrh_chunk_seq % dtrh_chunk_count).
+ *
+ * @field dtrh_ts_base
+ * @field dtrh_ns_base
+ * @field dtrh_ts_last
+ * @field dtrh_ns_last
+ * Two samples of the event timestamps and of the uptime clock in nanoseconds
+ * (CLOCK_MONOTONIC on Linux), taken when the file was created and when it was
+ * last written to.
+ */
+typedef struct dispatch_trace_ring_header_s {
+	uint64_t dtrh_magic;
+	uint32_t dtrh_version;
+	uint32_t dtrh_chunk_size;
+	uint64_t dtrh_chunk_count;
+	uint64_t dtrh_chunk_seq;
+	uint64_t dtrh_events;
+	uint64_t dtrh_dropped;
+	uint64_t dtrh_pid;
+	uint64_t dtrh_ts_base;
+	uint64_t dtrh_ns_base;
+	uint64_t dtrh_ts_last;
+	uint64_t dtrh_ns_last;
+} dispatch_trace_ring_header_s;
+
+#ifdef __DISPATCH_BASE__
+
+/*!
+ * @typedef dispatch_trace_ring_stats_s
+ *
+ * @field dtrs_events
+ * Number of events written to the file.
+ *
+ * @field dtrs_dropped
+ * Number of events dropped because the file couldn't keep up.
+ *
+ * @field dtrs_chunks
+ * Number of chunks written to the file.
+ */
+typedef struct dispatch_trace_ring_stats_s {
+	uint64_t dtrs_events;
+	uint64_t dtrs_dropped;
+	uint64_t dtrs_chunks;
+} dispatch_trace_ring_stats_s;
+
+/*!
+ * @function _dispatch_trace_ring_get_stats
+ *
+ * @abstract
+ * Returns a snapshot of the trace ring counters.
+ *
+ * @discussion
+ * Events still buffered by threads are not counted until they are written to
+ * the file. The counters are all zero when the trace ring isn't enabled.
+ *
+ * @result
+ * true if the trace ring is enabled in this process.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+bool
+_dispatch_trace_ring_get_stats(dispatch_trace_ring_stats_s *stats);
+
+/*!
+ * @function _dispatch_trace_ring_export_chrome
+ *
+ * @abstract
+ * Converts a trace ring file to the Chrome trace event JSON format.
+ *
+ * @discussion
+ * Functions are not symbolicated, slices are named after their address.
+ * Chunks that were being overwritten when the ring was captured are skipped.
+ *
+ * @param ring
+ * The contents of a trace ring file.
+ *
+ * @param size
+ * The size of the buffer pointed to by ring.
+ *
+ * @param fd
+ * The file descriptor the JSON is written to.
+ *
+ * @result
+ * 0 on success, EINVAL if ring isn't a trace ring, or the errno of the write
+ * that failed.
+ */
+API_AVAILABLE(macos(10.16), ios(14.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+int
+_dispatch_trace_ring_export_chrome(const void *ring, size_t size, int fd);
+
+#endif // __DISPATCH_BASE__
+
+__END_DECLS
+
+#endif
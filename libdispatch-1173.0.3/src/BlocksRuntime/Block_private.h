@@ -241,6 +241,9 @@ BLOCK_EXPORT void *_Block_copy_collectable(const void *aBlock);
 // thread-unsafe diagnostic
 BLOCK_EXPORT const char *_Block_dump(const void *block);
 
+// frees the heap copies cached for reuse by other threads
+BLOCK_EXPORT void _Block_cache_trim(void);
+
 
 // Obsolete
 
@@ -12,6 +12,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
 #if HAVE_OBJC
 #define __USE_GNU
 #include <dlfcn.h>
@@ -144,10 +147,12 @@ GC support stub routines
 
 
 
+static void *_Block_cache_alloc(size_t size);
+
 static void *_Block_alloc_default(size_t size, const bool initialCountIsOne, const bool isObject) {
 	(void)initialCountIsOne;
 	(void)isObject;
-    return malloc(size);
+    return _Block_cache_alloc(size);
 }
 
 static void _Block_assign_default(void *value, void **destptr) {
@@ -215,6 +220,240 @@ static void (*_Block_memmove)(void *dest, void *src, unsigned long size) = _Bloc
 static void (*_Block_destructInstance) (const void *aBlock) = _Block_destructInstance_default;
 
 
+/**************************************************************************
+Block allocation cache
+
+Heap copies of blocks and __block variables are small and short lived, most
+of them are copied by dispatch_async and released once the block ran.  They
+are recycled through per-thread freelists, one per 16 byte size class up to
+256 bytes.  Blocks are often released on another thread than the one that
+copied them, so full freelists are handed over in batches to a global depot
+that threads with an empty freelist take them back from.  The depot is
+emptied by _Block_cache_trim() when the process is under memory pressure.
+***************************************************************************/
+
+#if !defined(_WIN32)
+
+#if __has_include(<os/lock.h>)
+#include <os/lock.h>
+typedef os_unfair_lock Block_cache_lock;
+#define BLOCK_CACHE_LOCK_INIT OS_UNFAIR_LOCK_INIT
+#define _Block_cache_lock_lock(l) os_unfair_lock_lock(l)
+#define _Block_cache_lock_unlock(l) os_unfair_lock_unlock(l)
+#define _Block_cache_lock_reset(l) (*(l) = OS_UNFAIR_LOCK_INIT)
+#else
+// waiters sleep in the kernel instead of spinning against the holder
+typedef pthread_mutex_t Block_cache_lock;
+#if defined(PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP)
+#define BLOCK_CACHE_LOCK_INIT PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP
+#else
+#define BLOCK_CACHE_LOCK_INIT PTHREAD_MUTEX_INITIALIZER
+#endif
+#define _Block_cache_lock_lock(l) pthread_mutex_lock(l)
+#define _Block_cache_lock_unlock(l) pthread_mutex_unlock(l)
+#define _Block_cache_lock_reset(l) \
+        (*(l) = (Block_cache_lock)BLOCK_CACHE_LOCK_INIT)
+#endif
+
+#define BLOCK_CACHE_QUANTUM 16
+#define BLOCK_CACHE_MAX_SIZE 256
+#define BLOCK_CACHE_CLASSES (BLOCK_CACHE_MAX_SIZE / BLOCK_CACHE_QUANTUM)
+#define BLOCK_CACHE_BATCH 32        // entries per thread freelist
+#define BLOCK_CACHE_DEPOT_MAX 64    // batches per size class in the depot
+
+struct Block_cache_entry {
+    struct Block_cache_entry *next;
+    struct Block_cache_entry *next_batch;   // first entry of a batch only
+    unsigned int count;                     // first entry of a batch only
+};
+
+enum {
+    BLOCK_CACHE_UNREGISTERED,
+    BLOCK_CACHE_REGISTERED,
+    BLOCK_CACHE_DEAD,   // the thread is exiting, bypass the cache
+};
+
+static __thread struct Block_cache {
+    struct Block_cache_entry *heads[BLOCK_CACHE_CLASSES];
+    unsigned int counts[BLOCK_CACHE_CLASSES];
+    int state;
+} _Block_cache;
+
+static struct {
+    Block_cache_lock lock;
+    unsigned int count;
+    struct Block_cache_entry *batches;
+} _Block_cache_depot[BLOCK_CACHE_CLASSES] = {
+    [0 ... BLOCK_CACHE_CLASSES - 1] = { .lock = BLOCK_CACHE_LOCK_INIT },
+};
+
+static pthread_key_t _Block_cache_key;
+static pthread_once_t _Block_cache_key_once = PTHREAD_ONCE_INIT;
+static bool _Block_cache_key_valid;
+
+static void _Block_cache_depot_lock(unsigned int idx) {
+    _Block_cache_lock_lock(&_Block_cache_depot[idx].lock);
+}
+
+static void _Block_cache_depot_unlock(unsigned int idx) {
+    _Block_cache_lock_unlock(&_Block_cache_depot[idx].lock);
+}
+
+static void _Block_cache_free_list(struct Block_cache_entry *e) {
+    while (e) {
+        struct Block_cache_entry *next = e->next;
+        free(e);
+        e = next;
+    }
+}
+
+static void _Block_cache_thread_exit(void *ctxt) {
+    struct Block_cache *cache = &_Block_cache;
+    (void)ctxt;
+    cache->state = BLOCK_CACHE_DEAD;
+    for (unsigned int idx = 0; idx < BLOCK_CACHE_CLASSES; idx++) {
+        _Block_cache_free_list(cache->heads[idx]);
+        cache->heads[idx] = NULL;
+        cache->counts[idx] = 0;
+    }
+}
+
+// a thread of the parent may have held a depot lock when it forked
+static void _Block_cache_atfork_child(void) {
+    for (unsigned int idx = 0; idx < BLOCK_CACHE_CLASSES; idx++) {
+        _Block_cache_lock_reset(&_Block_cache_depot[idx].lock);
+    }
+}
+
+static void _Block_cache_key_init(void) {
+    _Block_cache_key_valid =
+            pthread_key_create(&_Block_cache_key, _Block_cache_thread_exit) == 0;
+    if (_Block_cache_key_valid) {
+        pthread_atfork(NULL, NULL, _Block_cache_atfork_child);
+    }
+}
+
+// the freelists need to be emptied when the thread exits
+static bool _Block_cache_register(struct Block_cache *cache) {
+    if (cache->state != BLOCK_CACHE_UNREGISTERED) {
+        return cache->state == BLOCK_CACHE_REGISTERED;
+    }
+    pthread_once(&_Block_cache_key_once, _Block_cache_key_init);
+    if (!_Block_cache_key_valid ||
+            pthread_setspecific(_Block_cache_key, cache) != 0) {
+        cache->state = BLOCK_CACHE_DEAD;
+        return false;
+    }
+    cache->state = BLOCK_CACHE_REGISTERED;
+    return true;
+}
+
+static void *_Block_cache_alloc(size_t size) {
+    struct Block_cache *cache = &_Block_cache;
+    struct Block_cache_entry *e;
+    unsigned int idx;
+
+    if (size < sizeof(struct Block_cache_entry) || size > BLOCK_CACHE_MAX_SIZE) {
+        return malloc(size);
+    }
+    idx = (unsigned int)((size - 1) / BLOCK_CACHE_QUANTUM);
+    e = cache->heads[idx];
+    if (!e && __atomic_load_n(&_Block_cache_depot[idx].count, __ATOMIC_RELAXED) &&
+            _Block_cache_register(cache)) {
+        _Block_cache_depot_lock(idx);
+        e = _Block_cache_depot[idx].batches;
+        if (e) {
+            _Block_cache_depot[idx].batches = e->next_batch;
+            _Block_cache_depot[idx].count--;
+        }
+        _Block_cache_depot_unlock(idx);
+        if (e) cache->counts[idx] = e->count;
+    }
+    if (!e) {
+        // whole size classes so that the memory can be reused by any size
+        return malloc((idx + 1) * BLOCK_CACHE_QUANTUM);
+    }
+    cache->heads[idx] = e->next;
+    cache->counts[idx]--;
+    return e;
+}
+
+static void _Block_cache_free(const void *ptr, size_t size) {
+    struct Block_cache *cache = &_Block_cache;
+    struct Block_cache_entry *e = (struct Block_cache_entry *)ptr;
+    unsigned int idx;
+
+    if (size < sizeof(struct Block_cache_entry) || size > BLOCK_CACHE_MAX_SIZE ||
+            !_Block_cache_register(cache)) {
+        free(e);
+        return;
+    }
+    idx = (unsigned int)((size - 1) / BLOCK_CACHE_QUANTUM);
+    if (cache->counts[idx] == BLOCK_CACHE_BATCH) {
+        struct Block_cache_entry *batch = cache->heads[idx];
+        batch->count = BLOCK_CACHE_BATCH;
+        _Block_cache_depot_lock(idx);
+        if (_Block_cache_depot[idx].count < BLOCK_CACHE_DEPOT_MAX) {
+            batch->next_batch = _Block_cache_depot[idx].batches;
+            _Block_cache_depot[idx].batches = batch;
+            _Block_cache_depot[idx].count++;
+            batch = NULL;
+        }
+        _Block_cache_depot_unlock(idx);
+        _Block_cache_free_list(batch);
+        cache->heads[idx] = NULL;
+        cache->counts[idx] = 0;
+    }
+    e->next = cache->heads[idx];
+    cache->heads[idx] = e;
+    cache->counts[idx]++;
+}
+
+void _Block_cache_trim(void) {
+    for (unsigned int idx = 0; idx < BLOCK_CACHE_CLASSES; idx++) {
+        struct Block_cache_entry *batch, *next;
+
+        if (!__atomic_load_n(&_Block_cache_depot[idx].count, __ATOMIC_RELAXED)) {
+            continue;
+        }
+        _Block_cache_depot_lock(idx);
+        batch = _Block_cache_depot[idx].batches;
+        _Block_cache_depot[idx].batches = NULL;
+        _Block_cache_depot[idx].count = 0;
+        _Block_cache_depot_unlock(idx);
+        for (; batch; batch = next) {
+            next = batch->next_batch;
+            _Block_cache_free_list(batch);
+        }
+    }
+}
+
+#else
+
+void _Block_cache_trim(void) {
+}
+
+static void *_Block_cache_alloc(size_t size) {
+    return malloc(size);
+}
+
+static void _Block_cache_free(const void *ptr, size_t size) {
+    (void)size;
+    free((void *)ptr);
+}
+
+#endif
+
+// Frees the heap copy of a block or __block variable of the given size
+static void _Block_free(const void *ptr, size_t size) {
+    if (_Block_deallocator == (void (*)(const void *))free) {
+        _Block_cache_free(ptr, size);
+    } else {
+        _Block_deallocator(ptr);
+    }
+}
+
+
 #if HAVE_OBJC
 /**************************************************************************
 GC support SPI functions - called from ObjC runtime and CoreFoundation
@@ -368,7 +607,7 @@ static void *_Block_copy_internal(const void *arg, const bool wantsOne) {
 
     // Its a stack block.  Make a copy.
     if (!isGC) {
-        struct Block_layout *result = malloc(aBlock->descriptor->size);
+        struct Block_layout *result = _Block_cache_alloc(aBlock->descriptor->size);
         if (!result) return NULL;
         memmove(result, aBlock, aBlock->descriptor->size); // bitcopy first
         // reset refcount
@@ -481,11 +720,12 @@ static void _Block_byref_release(const void *arg) {
     refcount = byref->flags & BLOCK_REFCOUNT_MASK;
 	os_assert(refcount);
     if (latching_decr_int_should_deallocate(&byref->flags)) {
+        size_t size = byref->size;
         if (byref->flags & BLOCK_BYREF_HAS_COPY_DISPOSE) {
             struct Block_byref_2 *byref2 = (struct Block_byref_2 *)(byref+1);
             (*byref2->byref_destroy)(byref);
         }
-        _Block_deallocator((struct Block_layout *)byref);
+        _Block_free(byref, size);
     }
 }
 
@@ -525,9 +765,10 @@ void _Block_release(const void *arg) {
     }
     else if (aBlock->flags & BLOCK_NEEDS_FREE) {
         if (latching_decr_int_should_deallocate(&aBlock->flags)) {
+            size_t size = aBlock->descriptor->size;
             _Block_call_dispose_helper(aBlock);
             _Block_destructInstance(aBlock);
-            _Block_deallocator(aBlock);
+            _Block_free(aBlock, size);
         }
     }
 }
@@ -20,16 +20,34 @@
 
 #include "internal.h"
 
+#if HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
 struct __dispatch_benchmark_data_s {
 #if HAVE_MACH_ABSOLUTE_TIME
 	mach_timebase_info_data_t tbi;
 #endif
 	uint64_t loop_cost;
+	uint64_t timer_cost;
 	void (*func)(void *);
 	void *ctxt;
 	size_t count;
 };
 
+static void
+_dispatch_benchmark_dummy_function(void *ctxt DISPATCH_UNUSED)
+{
+}
+
+static struct __dispatch_benchmark_data_s _dispatch_benchmark_data = {
+	.func = _dispatch_benchmark_dummy_function,
+	.count = 10000000ul, // ten million
+};
+static dispatch_once_t _dispatch_benchmark_pred;
+
 static void
 _dispatch_benchmark_init(void *context)
 {
@@ -68,6 +86,15 @@ _dispatch_benchmark_init(void *context)
 	lcost /= cnt;
 
 	bdata->loop_cost = lcost > UINT64_MAX ? UINT64_MAX : (uint64_t)lcost;
+
+	// the cheapest observed pair of clock reads is the fixed cost of a sample
+	delta = UINT64_MAX;
+	for (i = 0; i < 1000; i++) {
+		start = _dispatch_uptime();
+		uint64_t d = _dispatch_uptime() - start;
+		if (d < delta) delta = d;
+	}
+	bdata->timer_cost = _dispatch_time_mach2nano(delta);
 }
 
 #ifdef __BLOCKS__
@@ -78,20 +105,11 @@ dispatch_benchmark(size_t count, void (^block)(void))
 }
 #endif
 
-static void
-_dispatch_benchmark_dummy_function(void *ctxt DISPATCH_UNUSED)
-{
-}
-
 uint64_t
 dispatch_benchmark_f(size_t count, register void *ctxt,
 		register void (*func)(void *))
 {
-	static struct __dispatch_benchmark_data_s bdata = {
-		.func = _dispatch_benchmark_dummy_function,
-		.count = 10000000ul, // ten million
-	};
-	static dispatch_once_t pred;
+	struct __dispatch_benchmark_data_s *bdata = &_dispatch_benchmark_data;
 	uint64_t ns, start, delta;
 #if defined(__LP64__)
 	__uint128_t conversion, big_denom;
@@ -100,7 +118,7 @@ dispatch_benchmark_f(size_t count, register void *ctxt,
 #endif
 	size_t i = 0;
 
-	dispatch_once_f(&pred, &bdata, _dispatch_benchmark_init);
+	dispatch_once_f(&_dispatch_benchmark_pred, bdata, _dispatch_benchmark_init);
 
 	if (unlikely(count == 0)) {
 		return 0;
@@ -115,14 +133,303 @@ dispatch_benchmark_f(size_t count, register void *ctxt,
 
 	conversion = delta;
 #if HAVE_MACH_ABSOLUTE_TIME
-	conversion *= bdata.tbi.numer;
-	big_denom = bdata.tbi.denom;
+	conversion *= bdata->tbi.numer;
+	big_denom = bdata->tbi.denom;
 #else
-	big_denom = delta;
+	big_denom = 1;
 #endif
 	big_denom *= count;
 	conversion /= big_denom;
 	ns = conversion > UINT64_MAX ? UINT64_MAX : (uint64_t)conversion;
 
-	return ns - bdata.loop_cost;
+	return ns - bdata->loop_cost;
+}
+
+#pragma mark -
+#pragma mark dispatch_benchmark_ex
+
+// Log-linear histogram: values below 2^SUB_BITS get an exact bucket, and each
+// further power of two is split into 2^SUB_BITS linear sub-buckets, which
+// bounds the relative error to 1/2^SUB_BITS over the whole 64-bit range
+#define DISPATCH_BENCHMARK_HIST_SUB_BITS	4u
+#define DISPATCH_BENCHMARK_HIST_SUB	(1u << DISPATCH_BENCHMARK_HIST_SUB_BITS)
+#define DISPATCH_BENCHMARK_HIST_BUCKETS \
+		((64u - DISPATCH_BENCHMARK_HIST_SUB_BITS + 1) * \
+		DISPATCH_BENCHMARK_HIST_SUB)
+
+enum {
+	DISPATCH_BENCHMARK_COUNTER_CYCLES,
+	DISPATCH_BENCHMARK_COUNTER_INSTRUCTIONS,
+	DISPATCH_BENCHMARK_COUNTER_CACHE_MISSES,
+	DISPATCH_BENCHMARK_COUNTER_BRANCH_MISSES,
+	DISPATCH_BENCHMARK_COUNTER_COUNT,
+};
+
+typedef struct dispatch_benchmark_thread_s {
+	uint64_t dbt_min;
+	uint64_t dbt_max;
+	uint64_t dbt_sum;
+	uint64_t dbt_counters[DISPATCH_BENCHMARK_COUNTER_COUNT];
+	bool dbt_counters_valid;
+	uint64_t dbt_hist[DISPATCH_BENCHMARK_HIST_BUCKETS];
+} DISPATCH_CACHELINE_ALIGN *dispatch_benchmark_thread_t;
+
+typedef struct dispatch_benchmark_ex_s {
+	const dispatch_benchmark_attr_s *dbx_attr;
+	dispatch_function_t dbx_func;
+	void *dbx_ctxt;
+	size_t dbx_batch;
+	dispatch_benchmark_thread_t dbx_threads;
+} *dispatch_benchmark_ex_t;
+
+DISPATCH_ALWAYS_INLINE
+static inline unsigned int
+_dispatch_benchmark_hist_index(uint64_t v)
+{
+	if (v < DISPATCH_BENCHMARK_HIST_SUB) {
+		return (unsigned int)v;
+	}
+	unsigned int e = 63u - (unsigned int)__builtin_clzll(v);
+	unsigned int sub = (unsigned int)(v >> (e - DISPATCH_BENCHMARK_HIST_SUB_BITS));
+	sub &= DISPATCH_BENCHMARK_HIST_SUB - 1;
+	return (e - DISPATCH_BENCHMARK_HIST_SUB_BITS + 1) *
+			DISPATCH_BENCHMARK_HIST_SUB + sub;
+}
+
+// Returns the midpoint of the range of values covered by a bucket
+static uint64_t
+_dispatch_benchmark_hist_value(unsigned int idx)
+{
+	if (idx < DISPATCH_BENCHMARK_HIST_SUB) {
+		return idx;
+	}
+	unsigned int e = idx / DISPATCH_BENCHMARK_HIST_SUB +
+			DISPATCH_BENCHMARK_HIST_SUB_BITS - 1;
+	unsigned int shift = e - DISPATCH_BENCHMARK_HIST_SUB_BITS;
+	uint64_t sub = idx % DISPATCH_BENCHMARK_HIST_SUB;
+	uint64_t lo = (DISPATCH_BENCHMARK_HIST_SUB + sub) << shift;
+	return lo + ((1ull << shift) >> 1);
+}
+
+// `q` is expressed in units of 1/100000 so that p99.9 is exact
+static uint64_t
+_dispatch_benchmark_hist_percentile(const uint64_t *hist, uint64_t count,
+		uint64_t q, uint64_t min, uint64_t max)
+{
+	uint64_t rank = (count * q + 99999) / 100000, seen = 0;
+	if (rank == 0) rank = 1;
+	for (unsigned int i = 0; i < DISPATCH_BENCHMARK_HIST_BUCKETS; i++) {
+		seen += hist[i];
+		if (seen >= rank) {
+			uint64_t v = _dispatch_benchmark_hist_value(i);
+			return v < min ? min : v > max ? max : v;
+		}
+	}
+	return max;
+}
+
+#if HAVE_LINUX_PERF_EVENT_H
+static const struct {
+	uint32_t type;
+	uint64_t config;
+} _dispatch_benchmark_counters[DISPATCH_BENCHMARK_COUNTER_COUNT] = {
+	[DISPATCH_BENCHMARK_COUNTER_CYCLES] = {
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,
+	},
+	[DISPATCH_BENCHMARK_COUNTER_INSTRUCTIONS] = {
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,
+	},
+	[DISPATCH_BENCHMARK_COUNTER_CACHE_MISSES] = {
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,
+	},
+	[DISPATCH_BENCHMARK_COUNTER_BRANCH_MISSES] = {
+		PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,
+	},
+};
+
+static void
+_dispatch_benchmark_counters_open(int fds[DISPATCH_BENCHMARK_COUNTER_COUNT])
+{
+	for (int i = 0; i < DISPATCH_BENCHMARK_COUNTER_COUNT; i++) {
+		struct perf_event_attr pea = {
+			.type = _dispatch_benchmark_counters[i].type,
+			.size = sizeof(pea),
+			.config = _dispatch_benchmark_counters[i].config,
+			.disabled = 1,
+			.exclude_kernel = 1,
+			.exclude_hv = 1,
+		};
+		// counters are per thread: pid 0 on any cpu, no group
+		fds[i] = (int)syscall(__NR_perf_event_open, &pea, 0, -1, -1,
+				PERF_FLAG_FD_CLOEXEC);
+	}
+}
+
+static void
+_dispatch_benchmark_counters_toggle(int fds[DISPATCH_BENCHMARK_COUNTER_COUNT],
+		bool enable)
+{
+	unsigned long req = enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE;
+	for (int i = 0; i < DISPATCH_BENCHMARK_COUNTER_COUNT; i++) {
+		if (fds[i] >= 0) (void)ioctl(fds[i], req, 0);
+	}
+}
+
+static void
+_dispatch_benchmark_counters_close(dispatch_benchmark_thread_t dbt,
+		int fds[DISPATCH_BENCHMARK_COUNTER_COUNT])
+{
+	for (int i = 0; i < DISPATCH_BENCHMARK_COUNTER_COUNT; i++) {
+		uint64_t v;
+		if (fds[i] < 0) continue;
+		if (read(fds[i], &v, sizeof(v)) == (ssize_t)sizeof(v)) {
+			dbt->dbt_counters[i] = v;
+			dbt->dbt_counters_valid = true;
+		}
+		close(fds[i]);
+	}
+}
+#endif // HAVE_LINUX_PERF_EVENT_H
+
+static void
+_dispatch_benchmark_ex_thread(void *ctxt, size_t idx)
+{
+	dispatch_benchmark_ex_t dbx = ctxt;
+	dispatch_benchmark_thread_t dbt = &dbx->dbx_threads[idx];
+	struct __dispatch_benchmark_data_s *bdata = &_dispatch_benchmark_data;
+	register dispatch_function_t f = dbx->dbx_func;
+	register void *c = dbx->dbx_ctxt;
+	register size_t batch = dbx->dbx_batch;
+	size_t iterations = dbx->dbx_attr->dba_iterations;
+	uint64_t start, delta, ns;
+#if HAVE_LINUX_PERF_EVENT_H
+	int fds[DISPATCH_BENCHMARK_COUNTER_COUNT];
+	bool counters = (dbx->dbx_attr->dba_flags &
+			DISPATCH_BENCHMARK_PERF_COUNTERS);
+#endif
+
+	for (size_t i = 0; i < dbx->dbx_attr->dba_warmup; i++) {
+		f(c);
+	}
+
+	dbt->dbt_min = UINT64_MAX;
+#if HAVE_LINUX_PERF_EVENT_H
+	if (counters) {
+		_dispatch_benchmark_counters_open(fds);
+		_dispatch_benchmark_counters_toggle(fds, true);
+	}
+#endif
+	for (size_t i = 0; i < iterations; i++) {
+		size_t j = 0;
+		start = _dispatch_uptime();
+		do {
+			j++;
+			f(c);
+		} while (j < batch);
+		delta = _dispatch_uptime() - start;
+
+		ns = _dispatch_time_mach2nano(delta);
+		ns = ns > bdata->timer_cost ? ns - bdata->timer_cost : 0;
+		ns /= batch;
+		ns = ns > bdata->loop_cost ? ns - bdata->loop_cost : 0;
+
+		if (ns < dbt->dbt_min) dbt->dbt_min = ns;
+		if (ns > dbt->dbt_max) dbt->dbt_max = ns;
+		dbt->dbt_sum += ns;
+		dbt->dbt_hist[_dispatch_benchmark_hist_index(ns)]++;
+	}
+#if HAVE_LINUX_PERF_EVENT_H
+	if (counters) {
+		_dispatch_benchmark_counters_toggle(fds, false);
+		_dispatch_benchmark_counters_close(dbt, fds);
+	}
+#endif
+}
+
+#ifdef __BLOCKS__
+int
+dispatch_benchmark_ex(const dispatch_benchmark_attr_s *attr,
+		dispatch_block_t block, dispatch_benchmark_result_s *result)
+{
+	return dispatch_benchmark_ex_f(attr, block, _dispatch_Block_invoke(block),
+			result);
+}
+#endif
+
+int
+dispatch_benchmark_ex_f(const dispatch_benchmark_attr_s *attr, void *ctxt,
+		dispatch_function_t func, dispatch_benchmark_result_s *result)
+{
+	size_t nthreads = attr->dba_threads > 1 ? attr->dba_threads : 1;
+	struct dispatch_benchmark_ex_s dbx = {
+		.dbx_attr = attr,
+		.dbx_func = func,
+		.dbx_ctxt = ctxt,
+		.dbx_batch = attr->dba_batch ?: 1,
+	};
+	dispatch_benchmark_thread_t merged;
+
+	memset(result, 0, sizeof(*result));
+	if (unlikely(attr->dba_iterations == 0)) {
+		return EINVAL;
+	}
+
+	dispatch_once_f(&_dispatch_benchmark_pred, &_dispatch_benchmark_data,
+			_dispatch_benchmark_init);
+
+	// slot 0 receives the merged results, each thread owns slot idx + 1
+	merged = _dispatch_calloc_aligned(DISPATCH_CACHELINE_SIZE, nthreads + 1,
+			sizeof(*merged));
+	dbx.dbx_threads = merged + 1;
+	if (nthreads == 1) {
+		_dispatch_benchmark_ex_thread(&dbx, 0);
+	} else {
+		dispatch_apply_f(nthreads, DISPATCH_APPLY_AUTO, &dbx,
+				_dispatch_benchmark_ex_thread);
+	}
+
+	merged->dbt_min = UINT64_MAX;
+	for (size_t t = 0; t < nthreads; t++) {
+		dispatch_benchmark_thread_t dbt = &dbx.dbx_threads[t];
+		if (dbt->dbt_min < merged->dbt_min) merged->dbt_min = dbt->dbt_min;
+		if (dbt->dbt_max > merged->dbt_max) merged->dbt_max = dbt->dbt_max;
+		merged->dbt_sum += dbt->dbt_sum;
+		for (unsigned int i = 0; i < DISPATCH_BENCHMARK_HIST_BUCKETS; i++) {
+			merged->dbt_hist[i] += dbt->dbt_hist[i];
+		}
+		if (dbt->dbt_counters_valid) {
+			merged->dbt_counters_valid = true;
+			for (int i = 0; i < DISPATCH_BENCHMARK_COUNTER_COUNT; i++) {
+				merged->dbt_counters[i] += dbt->dbt_counters[i];
+			}
+		}
+	}
+
+	result->dbr_samples = (uint64_t)attr->dba_iterations * nthreads;
+	result->dbr_calls = result->dbr_samples * dbx.dbx_batch;
+	result->dbr_min = merged->dbt_min;
+	result->dbr_max = merged->dbt_max;
+	result->dbr_mean = merged->dbt_sum / result->dbr_samples;
+	result->dbr_p50 = _dispatch_benchmark_hist_percentile(merged->dbt_hist,
+			result->dbr_samples, 50000, merged->dbt_min, merged->dbt_max);
+	result->dbr_p90 = _dispatch_benchmark_hist_percentile(merged->dbt_hist,
+			result->dbr_samples, 90000, merged->dbt_min, merged->dbt_max);
+	result->dbr_p99 = _dispatch_benchmark_hist_percentile(merged->dbt_hist,
+			result->dbr_samples, 99000, merged->dbt_min, merged->dbt_max);
+	result->dbr_p999 = _dispatch_benchmark_hist_percentile(merged->dbt_hist,
+			result->dbr_samples, 99900, merged->dbt_min, merged->dbt_max);
+	if (merged->dbt_counters_valid) {
+		result->dbr_flags |= DISPATCH_BENCHMARK_PERF_COUNTERS;
+		result->dbr_cycles =
+				merged->dbt_counters[DISPATCH_BENCHMARK_COUNTER_CYCLES];
+		result->dbr_instructions =
+				merged->dbt_counters[DISPATCH_BENCHMARK_COUNTER_INSTRUCTIONS];
+		result->dbr_cache_misses =
+				merged->dbt_counters[DISPATCH_BENCHMARK_COUNTER_CACHE_MISSES];
+		result->dbr_branch_misses =
+				merged->dbt_counters[DISPATCH_BENCHMARK_COUNTER_BRANCH_MISSES];
+	}
+
+	_dispatch_free_aligned(merged);
+	return 0;
 }
@@ -117,6 +117,9 @@ _dispatch_unote_dispose(dispatch_unote_t du)
 	} else if (!du._du->du_is_direct) {
 		ptr = _dispatch_unote_get_linkage(du);
 	}
+	if (du._du->du_is_sharded) {
+		free(du._dsd->dsd_shards);
+	}
 	free(ptr);
 }
 
@@ -221,12 +224,28 @@ _dispatch_source_data_create(dispatch_source_type_t dst, uintptr_t handle,
 	return (dispatch_unote_t){ ._du = du };
 }
 
+static dispatch_unote_t
+_dispatch_source_data_sharded_create(dispatch_source_type_t dst,
+		uintptr_t handle, unsigned long mask)
+{
+	dispatch_unote_t du = _dispatch_source_data_create(dst, handle, mask);
+	uint32_t count = dispatch_hw_config(logical_cpus);
+
+	if (du._du && count > 1) {
+		du._dsd->dsd_shard_count = count;
+		du._dsd->dsd_shards = _dispatch_calloc(count,
+				sizeof(struct dispatch_source_data_shard_s));
+		du._du->du_is_sharded = true;
+	}
+	return du;
+}
+
 const dispatch_source_type_s _dispatch_source_type_data_add = {
 	.dst_kind       = "data-add",
 	.dst_filter     = DISPATCH_EVFILT_CUSTOM_ADD,
 	.dst_flags      = EV_UDATA_SPECIFIC|EV_CLEAR,
 	.dst_action     = DISPATCH_UNOTE_ACTION_PASS_DATA,
-	.dst_size       = sizeof(struct dispatch_source_refs_s),
+	.dst_size       = sizeof(struct dispatch_source_data_refs_s),
 	.dst_strict     = false,
 
 	.dst_create     = _dispatch_source_data_create,
@@ -238,7 +257,7 @@ const dispatch_source_type_s _dispatch_source_type_data_or = {
 	.dst_filter     = DISPATCH_EVFILT_CUSTOM_OR,
 	.dst_flags      = EV_UDATA_SPECIFIC|EV_CLEAR,
 	.dst_action     = DISPATCH_UNOTE_ACTION_PASS_DATA,
-	.dst_size       = sizeof(struct dispatch_source_refs_s),
+	.dst_size       = sizeof(struct dispatch_source_data_refs_s),
 	.dst_strict     = false,
 
 	.dst_create     = _dispatch_source_data_create,
@@ -250,13 +269,37 @@ const dispatch_source_type_s _dispatch_source_type_data_replace = {
 	.dst_filter     = DISPATCH_EVFILT_CUSTOM_REPLACE,
 	.dst_flags      = EV_UDATA_SPECIFIC|EV_CLEAR,
 	.dst_action     = DISPATCH_UNOTE_ACTION_PASS_DATA,
-	.dst_size       = sizeof(struct dispatch_source_refs_s),
+	.dst_size       = sizeof(struct dispatch_source_data_refs_s),
 	.dst_strict     = false,
 
 	.dst_create     = _dispatch_source_data_create,
 	.dst_merge_evt  = NULL,
 };
 
+const dispatch_source_type_s _dispatch_source_type_data_add_sharded = {
+	.dst_kind       = "data-add-sharded",
+	.dst_filter     = DISPATCH_EVFILT_CUSTOM_ADD,
+	.dst_flags      = EV_UDATA_SPECIFIC|EV_CLEAR,
+	.dst_action     = DISPATCH_UNOTE_ACTION_PASS_DATA,
+	.dst_size       = sizeof(struct dispatch_source_data_refs_s),
+	.dst_strict     = false,
+
+	.dst_create     = _dispatch_source_data_sharded_create,
+	.dst_merge_evt  = NULL,
+};
+
+const dispatch_source_type_s _dispatch_source_type_data_or_sharded = {
+	.dst_kind       = "data-or-sharded",
+	.dst_filter     = DISPATCH_EVFILT_CUSTOM_OR,
+	.dst_flags      = EV_UDATA_SPECIFIC|EV_CLEAR,
+	.dst_action     = DISPATCH_UNOTE_ACTION_PASS_DATA,
+	.dst_size       = sizeof(struct dispatch_source_data_refs_s),
+	.dst_strict     = false,
+
+	.dst_create     = _dispatch_source_data_sharded_create,
+	.dst_merge_evt  = NULL,
+};
+
 #pragma mark file descriptors
 
 const dispatch_source_type_s _dispatch_source_type_read = {
@@ -325,7 +368,7 @@ const dispatch_source_type_s _dispatch_source_type_signal = {
 DISPATCH_GLOBAL(struct dispatch_timer_heap_s
 _dispatch_timers_heap[DISPATCH_TIMER_COUNT]);
 
-#if DISPATCH_USE_DTRACE
+#if DISPATCH_USE_DTRACE || DISPATCH_USE_TRACE_RING
 DISPATCH_STATIC_GLOBAL(dispatch_timer_source_refs_t
 _dispatch_trace_next_timer[DISPATCH_TIMER_QOS_COUNT]);
 #define _dispatch_trace_next_timer_set(x, q) \
@@ -1036,6 +1079,205 @@ const dispatch_source_type_s _dispatch_source_type_interval = {
 	.dst_merge_evt      = _dispatch_source_merge_evt,
 };
 
+#pragma mark dispatch_after continuations
+/*
+ * dispatch_after() items don't need a dispatch source: they are never
+ * suspended or reconfigured, and fire at most once. They are represented by
+ * bare timer refs that carry the continuation and its target queue, and are
+ * armed directly in the anonymous timer heap.
+ *
+ * Submitters push them on a lock-free list, and only the one finding it empty
+ * pokes the manager, which moves the whole list into the heap the next time
+ * it drains its timers.
+ *
+ * Items handed out by dispatch_after_cancellable_f() have two references: the
+ * client's handle and the timer heap's. Cancellation races with firing on
+ * dar_state. The winning canceller disposes of the continuation right away
+ * and queues the refs on a second list, from which the manager removes them
+ * from the heap and drops the heap's reference.
+ */
+
+typedef struct dispatch_after_refs_s {
+	struct dispatch_timer_source_refs_s dar_refs; // must be first
+	struct dispatch_after_refs_s *volatile dar_next;
+	struct dispatch_after_refs_s *volatile dar_cancel_next;
+	dispatch_queue_t dar_queue;
+	dispatch_qos_t dar_qos;
+	os_atomic(uint32_t) dar_state;
+	os_atomic(uint32_t) dar_refcnt;
+} *dispatch_after_refs_t;
+
+#define DISPATCH_AFTER_PENDING		0u
+#define DISPATCH_AFTER_FIRED		1u
+#define DISPATCH_AFTER_CANCELED		2u
+
+DISPATCH_GLOBAL(struct dispatch_after_refs_s *volatile
+_dispatch_timers_after_pending);
+DISPATCH_GLOBAL(struct dispatch_after_refs_s *volatile
+_dispatch_timers_after_canceled);
+
+DISPATCH_STATIC_GLOBAL(struct {
+	os_atomic(uint64_t) scheduled;
+	os_atomic(uint64_t) fired;
+	os_atomic(uint64_t) canceled;
+} _dispatch_after_stats);
+
+static void
+_dispatch_after_refs_release(dispatch_after_refs_t dar)
+{
+	if (os_atomic_dec(&dar->dar_refcnt, release) == 0) {
+		os_atomic_thread_fence(acquire);
+		dispatch_queue_t dq = dar->dar_queue;
+		free(dar);
+		_dispatch_release_tailcall(dq); // see _dispatch_timers_after_enqueue
+	}
+}
+
+static void
+_dispatch_after_merge_evt(dispatch_unote_t du,
+		uint32_t flags DISPATCH_UNUSED, uintptr_t data DISPATCH_UNUSED,
+		pthread_priority_t pp DISPATCH_UNUSED)
+{
+	dispatch_after_refs_t dar = (dispatch_after_refs_t)du._dt;
+
+	if (unlikely(!os_atomic_cmpxchg(&dar->dar_state, DISPATCH_AFTER_PENDING,
+			DISPATCH_AFTER_FIRED, relaxed))) {
+		// lost the race with a cancellation, the reference of the heap is
+		// dropped when draining _dispatch_timers_after_canceled
+		return;
+	}
+	dispatch_continuation_t dc = dar->dar_refs.ds_handler[DS_EVENT_HANDLER];
+	_dispatch_continuation_async(dar->dar_queue, dc, dar->dar_qos,
+			dc->dc_flags);
+	os_atomic_inc(&_dispatch_after_stats.fired, relaxed);
+	_dispatch_after_refs_release(dar);
+}
+
+static const dispatch_source_type_s _dispatch_after_type = {
+	.dst_kind           = "after",
+	.dst_filter         = DISPATCH_EVFILT_TIMER_WITH_CLOCK,
+	.dst_timer_flags    = DISPATCH_TIMER_AFTER,
+	.dst_size           = sizeof(struct dispatch_after_refs_s),
+
+	.dst_merge_evt      = _dispatch_after_merge_evt,
+};
+
+struct dispatch_after_refs_s *
+_dispatch_timers_after_enqueue(struct dispatch_continuation_s *dc,
+		dispatch_queue_t dq, dispatch_qos_t qos, dispatch_clock_t clock,
+		uint64_t target, uint64_t leeway, bool cancellable)
+{
+	dispatch_after_refs_t dar, head;
+	dispatch_timer_source_refs_t dt;
+
+	dar = _dispatch_calloc(1u, sizeof(struct dispatch_after_refs_s));
+	dt = &dar->dar_refs;
+	dt->du_type = &_dispatch_after_type;
+	dt->du_filter = DISPATCH_EVFILT_TIMER_WITH_CLOCK;
+	dt->du_is_timer = true;
+	dt->du_timer_flags = (uint8_t)(DISPATCH_TIMER_AFTER |
+			_dispatch_timer_flags_from_clock(clock));
+	// same coalescing as _dispatch_timer_unote_register() does for sources
+	if (_dispatch_qos_is_background(qos)) {
+		dt->du_timer_flags |= DISPATCH_TIMER_BACKGROUND;
+	}
+	dt->du_ident = _dispatch_timer_unote_idx(dt);
+	dt->dt_timer.target = target;
+	dt->dt_timer.deadline = target + leeway;
+	dt->dt_timer.interval = UINT64_MAX;
+	dt->dt_heap_entry[DTH_TARGET_ID] = DTH_INVALID_ID;
+	dt->dt_heap_entry[DTH_DEADLINE_ID] = DTH_INVALID_ID;
+	dt->ds_handler[DS_EVENT_HANDLER] = dc;
+	_dispatch_retain(dq); // released in _dispatch_after_refs_release
+	dar->dar_queue = dq;
+	dar->dar_qos = qos;
+	dar->dar_refcnt = cancellable ? 2 : 1;
+
+	os_atomic_inc(&_dispatch_after_stats.scheduled, relaxed);
+	os_atomic_rmw_loop(&_dispatch_timers_after_pending, head, dar, release, {
+		dar->dar_next = head;
+	});
+	if (head == NULL) {
+		_dispatch_event_loop_poke(DISPATCH_WLH_MANAGER, 0, 0);
+	}
+	return cancellable ? dar : NULL;
+}
+
+struct dispatch_continuation_s *
+_dispatch_timers_after_cancel(struct dispatch_after_refs_s *dar)
+{
+	dispatch_continuation_t dc = NULL;
+	dispatch_after_refs_t head;
+
+	if (os_atomic_cmpxchg(&dar->dar_state, DISPATCH_AFTER_PENDING,
+			DISPATCH_AFTER_CANCELED, relaxed)) {
+		dc = dar->dar_refs.ds_handler[DS_EVENT_HANDLER];
+		os_atomic_inc(&_dispatch_after_stats.canceled, relaxed);
+		// the heap's reference now belongs to the canceled list
+		os_atomic_rmw_loop(&_dispatch_timers_after_canceled, head, dar,
+				release, {
+			dar->dar_cancel_next = head;
+		});
+		if (head == NULL) {
+			_dispatch_event_loop_poke(DISPATCH_WLH_MANAGER, 0, 0);
+		}
+	}
+	_dispatch_after_refs_release(dar);
+	return dc;
+}
+
+void
+_dispatch_timers_after_release(struct dispatch_after_refs_s *dar)
+{
+	_dispatch_after_refs_release(dar);
+}
+
+void
+_dispatch_timers_after_update(void)
+{
+	dispatch_after_refs_t dar, next;
+	dispatch_timer_source_refs_t dt;
+
+	dar = os_atomic_xchg(&_dispatch_timers_after_pending, NULL, acquire);
+	for (; dar; dar = next) {
+		next = dar->dar_next;
+		if (os_atomic_load(&dar->dar_state, relaxed) == DISPATCH_AFTER_CANCELED) {
+			continue; // never armed, will be found on the canceled list
+		}
+		dt = &dar->dar_refs;
+		_dispatch_unote_state_set(dt, DISPATCH_WLH_ANON, 0);
+		_dispatch_timer_unote_arm(dt, _dispatch_timers_heap, dt->du_ident);
+	}
+
+	dar = os_atomic_xchg(&_dispatch_timers_after_canceled, NULL, acquire);
+	for (; dar; dar = next) {
+		next = dar->dar_cancel_next;
+		dt = &dar->dar_refs;
+		if (_dispatch_unote_armed(dt)) {
+			_dispatch_timer_unote_disarm(dt, _dispatch_timers_heap);
+		}
+		_dispatch_after_refs_release(dar);
+	}
+}
+
+void
+_dispatch_after_get_stats(dispatch_after_stats_s *stats)
+{
+	stats->das_scheduled = os_atomic_load(&_dispatch_after_stats.scheduled,
+			relaxed);
+	stats->das_fired = os_atomic_load(&_dispatch_after_stats.fired, relaxed);
+	stats->das_canceled = os_atomic_load(&_dispatch_after_stats.canceled,
+			relaxed);
+}
+
+#if !DISPATCH_EVENT_BACKEND_EPOLL
+void
+_dispatch_event_loop_get_stats(dispatch_event_loop_stats_s *stats)
+{
+	*stats = (dispatch_event_loop_stats_s){ };
+}
+#endif
+
 #pragma mark timer draining
 
 static void
@@ -197,6 +197,9 @@
 #define DISPATCH_EVFILT_CUSTOM_OR			(-EVFILT_SYSCOUNT - 4)
 #define DISPATCH_EVFILT_CUSTOM_REPLACE		(-EVFILT_SYSCOUNT - 5)
 #define DISPATCH_EVFILT_MACH_NOTIFICATION	(-EVFILT_SYSCOUNT - 6)
+#if DISPATCH_EVENT_BACKEND_EPOLL
+#define DISPATCH_EVFILT_MEMORYPRESSURE		(-EVFILT_SYSCOUNT - 7)
+#endif
 
 #if HAVE_MACH
 #	if !EV_UDATA_SPECIFIC
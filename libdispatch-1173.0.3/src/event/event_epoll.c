@@ -26,6 +26,9 @@
 #include <sys/eventfd.h>
 #include <sys/signalfd.h>
 #include <sys/timerfd.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 #ifndef EPOLLFREE
 #define EPOLLFREE 0x4000
@@ -36,12 +39,15 @@
 #endif
 
 #define DISPATCH_EPOLL_MAX_EVENT_COUNT 16
+#define DISPATCH_EPOLL_MAX_SIGINFO_COUNT 16
 
 enum {
 	DISPATCH_EPOLL_EVENTFD         = 0x0001,
 	DISPATCH_EPOLL_CLOCK_WALL      = 0x0002,
 	DISPATCH_EPOLL_CLOCK_UPTIME    = 0x0003,
 	DISPATCH_EPOLL_CLOCK_MONOTONIC = 0x0004,
+	DISPATCH_EPOLL_MEMORYPRESSURE  = 0x0005,
+	DISPATCH_EPOLL_SIGNALFD        = 0x0006,
 };
 
 typedef struct dispatch_muxnote_s {
@@ -66,6 +72,26 @@ typedef struct dispatch_epoll_timeout_s {
 
 static int _dispatch_epfd, _dispatch_eventfd;
 
+// Set by the first poke after the manager thread last consumed the eventfd,
+// later pokes find it set and skip the eventfd_write() syscall
+static os_atomic(uint32_t) _dispatch_eventfd_pending;
+
+// A single signalfd serves every signal source, its mask is the set of
+// signals that have a muxnote. Only touched from the manager thread.
+static int _dispatch_signalfd = -1;
+static sigset_t _dispatch_signalfd_mask;
+
+#if DISPATCH_USE_EVENT_LOOP_STATS
+static struct {
+	os_atomic(uint64_t) pokes;
+	os_atomic(uint64_t) writes;
+} _dispatch_event_loop_stats;
+#define _dispatch_event_loop_stats_inc(c) \
+		os_atomic_inc(&_dispatch_event_loop_stats.c, relaxed)
+#else
+#define _dispatch_event_loop_stats_inc(c) ((void)0)
+#endif
+
 static dispatch_once_t epoll_init_pred;
 static void _dispatch_epoll_init(void *);
 
@@ -118,12 +144,27 @@ _dispatch_muxnote_find(struct dispatch_muxnote_bucket_s *dmb,
 #define _dispatch_unote_muxnote_find(dmb, du) \
 		_dispatch_muxnote_find(dmb, du._du->du_ident, du._du->du_filter)
 
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE
+static int _dispatch_memorypressure_open(void);
+static void _dispatch_memorypressure_close(void);
+#endif
+
+static void _dispatch_signalfd_remove(int signo);
+
 static void
 _dispatch_muxnote_dispose(dispatch_muxnote_t dmn)
 {
-	if (dmn->dmn_filter != EVFILT_READ || (uint32_t)dmn->dmn_fd != dmn->dmn_ident) {
+	if (dmn->dmn_filter == EVFILT_SIGNAL) {
+		_dispatch_signalfd_remove((int)dmn->dmn_ident);
+	} else if (dmn->dmn_filter != EVFILT_READ ||
+			(uint32_t)dmn->dmn_fd != dmn->dmn_ident) {
 		close(dmn->dmn_fd);
 	}
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE
+	if (dmn->dmn_filter == DISPATCH_EVFILT_MEMORYPRESSURE) {
+		_dispatch_memorypressure_close();
+	}
+#endif
 	free(dmn);
 }
 
@@ -140,6 +181,44 @@ _dispatch_muxnote_signal_block_and_raise(int signo)
 	pthread_kill(manager_thread, signo);
 }
 
+static int
+_dispatch_signalfd_add(int signo)
+{
+	sigset_t mask = _dispatch_signalfd_mask;
+	int fd;
+
+	dispatch_once_f(&epoll_init_pred, NULL, _dispatch_epoll_init);
+	sigaddset(&mask, signo);
+	// passing an existing signalfd only replaces its mask
+	fd = signalfd(_dispatch_signalfd, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+	if (_dispatch_signalfd < 0) {
+		struct epoll_event ev = {
+			.events = EPOLLIN | EPOLLFREE,
+			.data = { .u32 = DISPATCH_EPOLL_SIGNALFD },
+		};
+		if (epoll_ctl(_dispatch_epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+			close(fd);
+			return -1;
+		}
+		_dispatch_signalfd = fd;
+	}
+	_dispatch_signalfd_mask = mask;
+	return fd;
+}
+
+static void
+_dispatch_signalfd_remove(int signo)
+{
+	sigdelset(&_dispatch_signalfd_mask, signo);
+	// the signalfd stays registered with an empty mask, it is cheaper than
+	// recreating it for the next signal source
+	(void)dispatch_assume(signalfd(_dispatch_signalfd,
+			&_dispatch_signalfd_mask, SFD_NONBLOCK | SFD_CLOEXEC) >= 0);
+}
+
 static dispatch_muxnote_t
 _dispatch_muxnote_create(dispatch_unote_t du, uint32_t events)
 {
@@ -154,7 +233,6 @@ _dispatch_muxnote_create(dispatch_unote_t du, uint32_t events)
 	int fd = (int)du._du->du_ident;
 	int8_t filter = du._du->du_filter;
 	bool skip_outq_ioctl = false, skip_inq_ioctl = false;
-	sigset_t sigmask;
 
 	switch (filter) {
 	case EVFILT_SIGNAL: {
@@ -164,9 +242,7 @@ _dispatch_muxnote_create(dispatch_unote_t du, uint32_t events)
 			sigaddset(&signals_with_unotes, signo);
 			sigaction(signo, &sa, NULL);
 		}
-		sigemptyset(&sigmask);
-		sigaddset(&sigmask, signo);
-		fd = signalfd(-1, &sigmask, SFD_NONBLOCK | SFD_CLOEXEC);
+		fd = _dispatch_signalfd_add(signo);
 		if (fd < 0) {
 			return NULL;
 		}
@@ -197,6 +273,15 @@ _dispatch_muxnote_create(dispatch_unote_t du, uint32_t events)
 		}
 		break;
 
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE
+	case DISPATCH_EVFILT_MEMORYPRESSURE:
+		fd = _dispatch_memorypressure_open();
+		if (fd < 0) {
+			return NULL;
+		}
+		break;
+#endif
+
 	default:
 		DISPATCH_INTERNAL_CRASH(0, "Unexpected filter");
 	}
@@ -219,6 +304,10 @@ static int
 _dispatch_epoll_update(dispatch_muxnote_t dmn, uint32_t events, int op)
 {
 	dispatch_once_f(&epoll_init_pred, NULL, _dispatch_epoll_init);
+	if (dmn->dmn_filter == EVFILT_SIGNAL) {
+		// registered once for all signals by _dispatch_signalfd_add()
+		return 0;
+	}
 	struct epoll_event ev = {
 		.events = events,
 		.data = { .ptr = dmn },
@@ -240,6 +329,12 @@ _dispatch_unote_required_events(dispatch_unote_t du)
 	case EVFILT_WRITE:
 		events |= EPOLLOUT;
 		break;
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE
+	case DISPATCH_EVFILT_MEMORYPRESSURE:
+		// PSI triggers only ever report EPOLLPRI
+		events |= EPOLLPRI;
+		break;
+#endif
 	default:
 		events |= EPOLLIN;
 		break;
@@ -325,7 +420,7 @@ _dispatch_unote_unregister_muxed(dispatch_unote_t du)
 	dul->du_muxnote = NULL;
 
 	if (LIST_EMPTY(&dmn->dmn_readers_head)) {
-		events &= (uint32_t)~EPOLLIN;
+		events &= (uint32_t)~(EPOLLIN | EPOLLPRI);
 		if (dmn->dmn_disarmed_events & EPOLLIN) {
 			dmn->dmn_disarmed_events &= (uint16_t)~EPOLLIN;
 			dmn->dmn_events &= (uint32_t)~EPOLLIN;
@@ -339,14 +434,14 @@ _dispatch_unote_unregister_muxed(dispatch_unote_t du)
 		}
 	}
 
-	if (events & (EPOLLIN | EPOLLOUT)) {
+	if (events & (EPOLLIN | EPOLLPRI | EPOLLOUT)) {
 		if (events != _dispatch_muxnote_armed_events(dmn)) {
 			dmn->dmn_events = events;
 			events = _dispatch_muxnote_armed_events(dmn);
 			_dispatch_epoll_update(dmn, events, EPOLL_CTL_MOD);
 		}
 	} else {
-		epoll_ctl(_dispatch_epfd, EPOLL_CTL_DEL, dmn->dmn_fd, NULL);
+		_dispatch_epoll_update(dmn, 0, EPOLL_CTL_DEL);
 		LIST_REMOVE(dmn, dmn_list);
 		_dispatch_muxnote_dispose(dmn);
 	}
@@ -485,15 +580,48 @@ _dispatch_event_loop_poke(dispatch_wlh_t wlh DISPATCH_UNUSED,
 		uint64_t dq_state DISPATCH_UNUSED, uint32_t flags DISPATCH_UNUSED)
 {
 	dispatch_once_f(&epoll_init_pred, NULL, _dispatch_epoll_init);
-	dispatch_assume_zero(eventfd_write(_dispatch_eventfd, 1));
+	_dispatch_event_loop_stats_inc(pokes);
+	if (os_atomic_xchg(&_dispatch_eventfd_pending, 1, release) == 0) {
+		_dispatch_event_loop_stats_inc(writes);
+		dispatch_assume_zero(eventfd_write(_dispatch_eventfd, 1));
+	}
+}
+
+void
+_dispatch_event_loop_get_stats(dispatch_event_loop_stats_s *stats)
+{
+#if DISPATCH_USE_EVENT_LOOP_STATS
+	stats->dels_pokes = os_atomic_load(&_dispatch_event_loop_stats.pokes,
+			relaxed);
+	stats->dels_writes = os_atomic_load(&_dispatch_event_loop_stats.writes,
+			relaxed);
+#else
+	*stats = (dispatch_event_loop_stats_s){ };
+#endif
 }
 
 static void
 _dispatch_event_merge_signal(dispatch_muxnote_t dmn)
 {
 	dispatch_unote_linkage_t dul, dul_next;
-	struct signalfd_siginfo si;
+
+	LIST_FOREACH_SAFE(dul, &dmn->dmn_readers_head, du_link, dul_next) {
+		dispatch_unote_t du = _dispatch_unote_linkage_get_unote(dul);
+		// consumed by dux_merge_evt()
+		_dispatch_retain_unote_owner(du);
+		dispatch_assert(!dux_needs_rearm(du._du));
+		os_atomic_add2o(du._dr, ds_pending_data, 1, relaxed);
+		dux_merge_evt(du._du, EV_ADD|EV_ENABLE|EV_CLEAR, 1, 0);
+	}
+}
+
+static void
+_dispatch_event_merge_signalfd(void)
+{
+	struct signalfd_siginfo si[DISPATCH_EPOLL_MAX_SIGINFO_COUNT];
+	dispatch_muxnote_t dmn;
 	ssize_t rc;
+	size_t i, n;
 
 	// Linux has the weirdest semantics around signals: if it finds a thread
 	// that has not masked a process wide-signal, it may deliver it to this
@@ -504,18 +632,21 @@ _dispatch_event_merge_signal(dispatch_muxnote_t dmn)
 	// first time around. The _dispatch_muxnote_signal_block_and_raise() hack
 	// will kick in, the thread with the wrong mask will be fixed up, and the
 	// signal delivered to us again properly.
-	if ((rc = read(dmn->dmn_fd, &si, sizeof(si))) == sizeof(si)) {
-		LIST_FOREACH_SAFE(dul, &dmn->dmn_readers_head, du_link, dul_next) {
-			dispatch_unote_t du = _dispatch_unote_linkage_get_unote(dul);
-			// consumed by dux_merge_evt()
-			_dispatch_retain_unote_owner(du);
-			dispatch_assert(!dux_needs_rearm(du._du));
-			os_atomic_store2o(du._dr, ds_pending_data, 1, relaxed)
-			dux_merge_evt(du._du, EV_ADD|EV_ENABLE|EV_CLEAR, 1, 0);
+	do {
+		rc = read(_dispatch_signalfd, si, sizeof(si));
+		if (rc < 0) {
+			dispatch_assume(errno == EAGAIN);
+			return;
 		}
-	} else {
-		dispatch_assume(rc == -1 && errno == EAGAIN);
-	}
+		n = (size_t)rc / sizeof(si[0]);
+		for (i = 0; i < n; i++) {
+			uint32_t signo = si[i].ssi_signo;
+			dmn = _dispatch_muxnote_find(_dispatch_muxnote_bucket(signo),
+					signo, EVFILT_SIGNAL);
+			// the signal may have been read after its last source went away
+			if (dmn) _dispatch_event_merge_signal(dmn);
+		}
+	} while (n == countof(si));
 }
 
 static uintptr_t
@@ -586,6 +717,233 @@ _dispatch_event_merge_fd(dispatch_muxnote_t dmn, uint32_t events)
 	if (events) _dispatch_epoll_update(dmn, events, EPOLL_CTL_MOD);
 }
 
+#pragma mark memory pressure
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE
+
+/*
+ * Memory pressure comes from the PSI files of the kernel: the trigger makes
+ * the file report EPOLLPRI once tasks were stalled on memory for 100ms over
+ * a 2s window, the shortest window unprivileged processes may use.
+ *
+ * The level is derived from the averages over the last 10s, in percent of
+ * the time stalled. PSI doesn't report when the stalls stop, so the level is
+ * polled while it is elevated to notice the return to normal.
+ */
+#define DISPATCH_MEMORYPRESSURE_PSI_TRIGGER		"some 100000 2000000"
+#define DISPATCH_MEMORYPRESSURE_POLL_INTERVAL	2 // seconds
+#define DISPATCH_MEMORYPRESSURE_CRITICAL_FULL	10
+#define DISPATCH_MEMORYPRESSURE_WARN_SOME		5
+#define DISPATCH_MEMORYPRESSURE_NORMAL_SOME		1
+
+#define DISPATCH_MEMORYPRESSURE_SOURCE_MASK ( \
+		DISPATCH_MEMORYPRESSURE_NORMAL | \
+		DISPATCH_MEMORYPRESSURE_WARN | \
+		DISPATCH_MEMORYPRESSURE_CRITICAL)
+
+// only accessed from the manager thread
+static int _dispatch_memorypressure_timerfd = -1;
+static unsigned long _dispatch_memorypressure_level =
+		DISPATCH_MEMORYPRESSURE_NORMAL;
+static bool _dispatch_memorypressure_inited;
+
+static int
+_dispatch_memorypressure_open_psi(const char *path)
+{
+	int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+	// the kernel expects the terminating NUL to be written too
+	if (write(fd, DISPATCH_MEMORYPRESSURE_PSI_TRIGGER,
+			sizeof(DISPATCH_MEMORYPRESSURE_PSI_TRIGGER)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int
+_dispatch_memorypressure_open(void)
+{
+	char line[PATH_MAX], path[PATH_MAX + 32];
+	int fd = -1;
+	FILE *f;
+
+	// the pressure of the cgroup also accounts for the stalls caused by its
+	// own memory limits, the system wide one doesn't
+	if ((f = fopen("/proc/self/cgroup", "re"))) {
+		while (fgets(line, sizeof(line), f)) {
+			if (strncmp(line, "0::/", 4) == 0) {
+				line[strcspn(line, "\n")] = '\0';
+				snprintf(path, sizeof(path), "/sys/fs/cgroup%s/memory.pressure",
+						line + 3);
+				fd = _dispatch_memorypressure_open_psi(path);
+				break;
+			}
+		}
+		fclose(f);
+	}
+	if (fd < 0) {
+		fd = _dispatch_memorypressure_open_psi("/proc/pressure/memory");
+	}
+	return fd;
+}
+
+static void
+_dispatch_memorypressure_close(void)
+{
+	if (_dispatch_memorypressure_timerfd >= 0) {
+		close(_dispatch_memorypressure_timerfd);
+		_dispatch_memorypressure_timerfd = -1;
+	}
+	_dispatch_memorypressure_level = DISPATCH_MEMORYPRESSURE_NORMAL;
+}
+
+static void
+_dispatch_memorypressure_poll(bool enable)
+{
+	struct itimerspec its = { };
+	int fd = _dispatch_memorypressure_timerfd;
+
+	if (fd < 0) {
+		if (!enable) return;
+		fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (fd < 0) {
+			(void)dispatch_assume_zero(errno);
+			return;
+		}
+		struct epoll_event ev = {
+			.events = EPOLLIN,
+			.data = { .u32 = DISPATCH_EPOLL_MEMORYPRESSURE },
+		};
+		if (epoll_ctl(_dispatch_epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+			(void)dispatch_assume_zero(errno);
+			close(fd);
+			return;
+		}
+		_dispatch_memorypressure_timerfd = fd;
+	}
+	if (enable) {
+		its.it_value.tv_sec = DISPATCH_MEMORYPRESSURE_POLL_INTERVAL;
+		its.it_interval.tv_sec = DISPATCH_MEMORYPRESSURE_POLL_INTERVAL;
+	}
+	(void)dispatch_assume_zero(timerfd_settime(fd, 0, &its, NULL));
+}
+
+static unsigned long
+_dispatch_memorypressure_avg10(const char *buf, const char *kind)
+{
+	const char *s = strstr(buf, kind);
+	return s ? strtoul(s + strlen(kind), NULL, 10) : 0;
+}
+
+static void
+_dispatch_event_merge_memorypressure(bool triggered)
+{
+	unsigned long level = _dispatch_memorypressure_level, some = 0, full = 0;
+	dispatch_unote_linkage_t dul, dul_next;
+	dispatch_muxnote_t dmn;
+	uint64_t expirations;
+	char buf[256];
+	ssize_t n;
+
+	if (!triggered) {
+		dispatch_assume(read(_dispatch_memorypressure_timerfd, &expirations,
+				sizeof(expirations)) == sizeof(expirations));
+	}
+	dmn = _dispatch_muxnote_find(_dispatch_muxnote_bucket(0), 0,
+			DISPATCH_EVFILT_MEMORYPRESSURE);
+	if (unlikely(!dmn)) {
+		return _dispatch_memorypressure_poll(false);
+	}
+
+	if ((n = pread(dmn->dmn_fd, buf, sizeof(buf) - 1, 0)) > 0) {
+		buf[n] = '\0';
+		some = _dispatch_memorypressure_avg10(buf, "some avg10=");
+		full = _dispatch_memorypressure_avg10(buf, "full avg10=");
+	}
+	if (full >= DISPATCH_MEMORYPRESSURE_CRITICAL_FULL) {
+		level = DISPATCH_MEMORYPRESSURE_CRITICAL;
+	} else if (triggered || some >= DISPATCH_MEMORYPRESSURE_WARN_SOME) {
+		level = DISPATCH_MEMORYPRESSURE_WARN;
+	} else if (some < DISPATCH_MEMORYPRESSURE_NORMAL_SOME) {
+		level = DISPATCH_MEMORYPRESSURE_NORMAL;
+	} else if (level == DISPATCH_MEMORYPRESSURE_CRITICAL) {
+		level = DISPATCH_MEMORYPRESSURE_WARN;
+	}
+	if (level == _dispatch_memorypressure_level) {
+		return;
+	}
+	_dispatch_memorypressure_level = level;
+	_dispatch_memorypressure_poll(level != DISPATCH_MEMORYPRESSURE_NORMAL);
+
+	LIST_FOREACH_SAFE(dul, &dmn->dmn_readers_head, du_link, dul_next) {
+		dispatch_unote_t du = _dispatch_unote_linkage_get_unote(dul);
+		unsigned long data = level & du._du->du_fflags;
+		if (!data) continue;
+		// consumed by dux_merge_evt()
+		_dispatch_retain_unote_owner(du);
+		dispatch_assert(!dux_needs_rearm(du._du));
+		os_atomic_or2o(du._dr, ds_pending_data, data, relaxed);
+		dux_merge_evt(du._du, EV_ADD|EV_ENABLE|EV_CLEAR, data, 0);
+	}
+}
+
+// Only the BlocksRuntime shipped with libdispatch caches block copies
+DISPATCH_WEAK void _Block_cache_trim(void);
+
+static void
+_dispatch_memorypressure_handler(void *context)
+{
+	dispatch_source_t ds = context;
+	unsigned long memorypressure = dispatch_source_get_data(ds);
+
+	if (memorypressure & DISPATCH_MEMORYPRESSURE_NORMAL) {
+		_dispatch_memory_warn = false;
+		_dispatch_continuation_cache_limit = DISPATCH_CONTINUATION_CACHE_LIMIT;
+	}
+	if (memorypressure & (DISPATCH_MEMORYPRESSURE_WARN |
+			DISPATCH_MEMORYPRESSURE_CRITICAL)) {
+		// idle workers also exit sooner while _dispatch_memory_warn is set
+		_dispatch_memory_warn = true;
+		_dispatch_continuation_cache_limit =
+				DISPATCH_CONTINUATION_CACHE_LIMIT_MEMORYPRESSURE_PRESSURE_WARN;
+		_dispatch_continuation_depot_trim();
+		if (_Block_cache_trim) {
+			_Block_cache_trim();
+		}
+#if defined(__GLIBC__)
+		// what malloc_memory_event_handler() does on Darwin
+		malloc_trim(0);
+#endif
+	}
+}
+
+static void
+_dispatch_memorypressure_init(void)
+{
+	dispatch_source_t ds = dispatch_source_create(
+			DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+			DISPATCH_MEMORYPRESSURE_SOURCE_MASK, _dispatch_mgr_q._as_dq);
+	dispatch_set_context(ds, ds);
+	dispatch_source_set_event_handler_f(ds, _dispatch_memorypressure_handler);
+	dispatch_activate(ds);
+}
+
+const dispatch_source_type_s _dispatch_source_type_memorypressure = {
+	.dst_kind       = "memorystatus",
+	.dst_filter     = DISPATCH_EVFILT_MEMORYPRESSURE,
+	.dst_flags      = EV_CLEAR,
+	.dst_mask       = DISPATCH_MEMORYPRESSURE_SOURCE_MASK,
+	.dst_action     = DISPATCH_UNOTE_ACTION_SOURCE_OR_FFLAGS,
+	.dst_size       = sizeof(struct dispatch_source_refs_s),
+	.dst_strict     = false,
+
+	.dst_create     = _dispatch_unote_create_without_handle,
+	.dst_merge_evt  = _dispatch_source_merge_evt,
+};
+#endif // DISPATCH_USE_MEMORYPRESSURE_SOURCE
+
 DISPATCH_NOINLINE
 void
 _dispatch_event_loop_drain(uint32_t flags)
@@ -594,6 +952,15 @@ _dispatch_event_loop_drain(uint32_t flags)
 	int i, r;
 	int timeout = (flags & KEVENT_FLAG_IMMEDIATE) ? 0 : -1;
 
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE
+	if (unlikely(!_dispatch_memorypressure_inited)) {
+		// can't be done from _dispatch_epoll_init() since registering the
+		// source needs the event loop to be initialized
+		_dispatch_memorypressure_inited = true;
+		_dispatch_memorypressure_init();
+	}
+#endif
+
 retry:
 	r = epoll_wait(_dispatch_epfd, ev, countof(ev), timeout);
 	if (unlikely(r == -1)) {
@@ -622,6 +989,11 @@ retry:
 		switch (ev[i].data.u32) {
 		case DISPATCH_EPOLL_EVENTFD:
 			dispatch_assume_zero(eventfd_read(_dispatch_eventfd, &value));
+			// Cleared after the read: a poke racing with the read would
+			// otherwise leave the flag set with no wakeup pending.
+			// Anything pushed by pokes that found it set is seen by the
+			// drain that follows.
+			os_atomic_xchg(&_dispatch_eventfd_pending, 0, acquire);
 			break;
 
 		case DISPATCH_EPOLL_CLOCK_WALL:
@@ -632,16 +1004,28 @@ retry:
 			_dispatch_event_merge_timer(DISPATCH_CLOCK_UPTIME);
 			break;
 
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE
+		case DISPATCH_EPOLL_MEMORYPRESSURE:
+			_dispatch_event_merge_memorypressure(false);
+			break;
+#endif
+
+		case DISPATCH_EPOLL_SIGNALFD:
+			_dispatch_event_merge_signalfd();
+			break;
+
 		default:
 			dmn = ev[i].data.ptr;
 			switch (dmn->dmn_filter) {
-			case EVFILT_SIGNAL:
-				_dispatch_event_merge_signal(dmn);
-				break;
-
 			case EVFILT_READ:
 				_dispatch_event_merge_fd(dmn, ev[i].events);
 				break;
+
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE
+			case DISPATCH_EVFILT_MEMORYPRESSURE:
+				_dispatch_event_merge_memorypressure(true);
+				break;
+#endif
 			}
 		}
 	}
@@ -136,7 +136,7 @@ _dispatch_timer_flags_from_clock(dispatch_clock_t clock)
 	uint8_t   du_vmpressure_override : 1; \
 	uint8_t   du_can_be_wlh : 1; \
 	uint8_t   dmrr_handler_is_block : 1; \
-	uint8_t   du_unused_flag : 1; \
+	uint8_t   du_is_sharded : 1; \
 	union { \
 		uint8_t   du_timer_flags; \
 		os_atomic(bool) dmsr_notification_armed; \
@@ -187,6 +187,21 @@ typedef struct dispatch_source_refs_s {
 	DISPATCH_SOURCE_REFS_HEADER();
 } *dispatch_source_refs_t;
 
+// One per CPU, padded so that merges on different CPUs don't share a line
+typedef struct dispatch_source_data_shard_s {
+	uint64_t dsds_data DISPATCH_ATOMIC64_ALIGN;
+	uint8_t  dsds_pad[DISPATCH_CACHELINE_SIZE - sizeof(uint64_t)];
+} *dispatch_source_data_shard_t;
+
+typedef struct dispatch_source_data_refs_s {
+	DISPATCH_SOURCE_REFS_HEADER();
+	// set by the merge that woke the source up, until its data is latched
+	uint32_t volatile dsd_wakeup_pending;
+	// merges land in dsd_shards instead of ds_pending_data when du_is_sharded
+	uint32_t dsd_shard_count;
+	dispatch_source_data_shard_t dsd_shards;
+} *dispatch_source_data_refs_t;
+
 typedef struct dispatch_timer_delay_s {
 	uint64_t delay, leeway;
 } dispatch_timer_delay_s;
@@ -307,6 +322,7 @@ typedef union dispatch_unote_u {
 	dispatch_unote_class_t _du;
 	dispatch_source_refs_t _dr;
 	dispatch_timer_source_refs_t _dt;
+	dispatch_source_data_refs_t _dsd;
 #if HAVE_MACH
 	dispatch_mach_recv_refs_t _dmrr;
 	dispatch_mach_send_refs_t _dmsr;
@@ -692,6 +708,17 @@ void _dispatch_event_loop_timer_delete(dispatch_timer_heap_t dth, uint32_t tidx)
 
 void _dispatch_event_loop_drain_timers(dispatch_timer_heap_t dth, uint32_t count);
 
+extern struct dispatch_after_refs_s *volatile _dispatch_timers_after_pending;
+extern struct dispatch_after_refs_s *volatile _dispatch_timers_after_canceled;
+struct dispatch_after_refs_s *_dispatch_timers_after_enqueue(
+		struct dispatch_continuation_s *dc, dispatch_queue_t dq,
+		dispatch_qos_t qos, dispatch_clock_t clock, uint64_t target,
+		uint64_t leeway, bool cancellable);
+struct dispatch_continuation_s *_dispatch_timers_after_cancel(
+		struct dispatch_after_refs_s *dar);
+void _dispatch_timers_after_release(struct dispatch_after_refs_s *dar);
+void _dispatch_timers_after_update(void);
+
 DISPATCH_ALWAYS_INLINE
 static inline void
 _dispatch_timers_heap_dirty(dispatch_timer_heap_t dth, uint32_t tidx)
@@ -704,6 +731,10 @@ DISPATCH_ALWAYS_INLINE
 static inline void
 _dispatch_event_loop_drain_anon_timers(void)
 {
+	if (os_atomic_load(&_dispatch_timers_after_pending, relaxed) ||
+			os_atomic_load(&_dispatch_timers_after_canceled, relaxed)) {
+		_dispatch_timers_after_update();
+	}
 	if (_dispatch_timers_heap[0].dth_dirty_bits) {
 		_dispatch_event_loop_drain_timers(_dispatch_timers_heap,
 				DISPATCH_TIMER_COUNT);
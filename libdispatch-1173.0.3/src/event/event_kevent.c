@@ -2578,6 +2578,7 @@ _dispatch_memorypressure_handler(void *context)
 		_dispatch_memory_warn = true;
 		_dispatch_continuation_cache_limit =
 				DISPATCH_CONTINUATION_CACHE_LIMIT_MEMORYPRESSURE_PRESSURE_WARN;
+		_dispatch_continuation_depot_trim();
 #if VOUCHER_USE_MACH_VOUCHER
 		if (_firehose_task_buffer) {
 			firehose_buffer_set_bank_flags(_firehose_task_buffer,
@@ -190,9 +190,33 @@ _dispatch_workq_count_runnable_workers(dispatch_workq_monitor_t mon)
 		for (name = DISPATCH_QOS_BUCKET(DISPATCH_QOS_MAX); \
 				name >= DISPATCH_QOS_BUCKET(DISPATCH_QOS_MAINTENANCE); name--)
 
+/*
+ * The CPU quota and affinity of a container can change while it runs, the
+ * targets follow active_cpus as it is re-evaluated.
+ */
+static void
+_dispatch_workq_update_active_cpus(void)
+{
+	uint32_t old_cpus = _dispatch_hw_config_refresh_active_cpus();
+	uint32_t new_cpus = dispatch_hw_config(active_cpus);
+	int i;
+
+	if (likely(old_cpus == new_cpus)) {
+		return;
+	}
+	_dispatch_debug("workq: active cpus changed from %u to %u",
+			old_cpus, new_cpus);
+	foreach_qos_bucket_reverse(i) {
+		_dispatch_workq_monitors[i].target_runnable = (int32_t)new_cpus;
+	}
+	_dispatch_root_queues_resize_pools(old_cpus, new_cpus);
+}
+
 static void
 _dispatch_workq_monitor_pools(void *context DISPATCH_UNUSED)
 {
+	_dispatch_workq_update_active_cpus();
+
 	int global_soft_max = WORKQ_OVERSUBSCRIBE_FACTOR * (int)dispatch_hw_config(active_cpus);
 	int global_runnable = 0, i;
 	foreach_qos_bucket_reverse(i) {
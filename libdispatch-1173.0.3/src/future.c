@@ -0,0 +1,312 @@
+/*
+ * This source file is part of the Swift.org open source project
+ *
+ * Copyright (c) 2026 Apple Inc. and the Swift project authors
+ *
+ * Licensed under Apache License v2.0 with Runtime Library Exception
+ *
+ * See https://swift.org/LICENSE.txt for license information
+ * See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+ *
+ */
+
+#include "internal.h"
+
+/*
+ * Futures are carved out of continuations, so that they are recycled by the
+ * same per-thread caches as the work items that complete them.
+ *
+ * dfu_waiters is a LIFO of continuations to run on completion, and becomes
+ * DISPATCH_FUTURE_COMPLETED once the value is published. Continuations
+ * with a dc_data are submitted to that queue, the others are combinator
+ * triggers called inline with themselves as argument.
+ *
+ * dfu_state only exists so that dispatch_future_wait() can block on a
+ * 32bit word, the same way dispatch_group_wait() does.
+ */
+#define DISPATCH_FUTURE_COMPLETED	((dispatch_continuation_t)~0ul)
+
+#define DISPATCH_FUTURE_STATE_PENDING	0u
+#define DISPATCH_FUTURE_STATE_WAITERS	1u
+#define DISPATCH_FUTURE_STATE_DONE		2u
+
+struct dispatch_future_s {
+	struct dispatch_continuation_s *volatile dfu_waiters;
+	void *dfu_value;
+	uint32_t volatile dfu_refcnt;
+	uint32_t volatile dfu_state;
+	uint32_t volatile dfu_pending; // inputs left for dispatch_future_all()
+	dispatch_future_t dfu_source; // dispatch_future_then_f() input
+	void *dfu_ctxt;
+	union {
+		dispatch_future_function_t dfu_async_func;
+		dispatch_future_then_function_t dfu_then_func;
+	};
+};
+
+dispatch_static_assert(sizeof(struct dispatch_future_s) <=
+		sizeof(struct dispatch_continuation_s),
+		"futures must fit in a continuation");
+
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_future_t
+_dispatch_future_alloc(uint32_t refs)
+{
+	dispatch_future_t f = (dispatch_future_t)_dispatch_continuation_alloc();
+	*f = (struct dispatch_future_s){ .dfu_refcnt = refs };
+	return f;
+}
+
+dispatch_future_t
+dispatch_future_create(void)
+{
+	return _dispatch_future_alloc(1);
+}
+
+dispatch_future_t
+dispatch_future_retain(dispatch_future_t f)
+{
+	if (unlikely(os_atomic_inc_orig2o(f, dfu_refcnt, relaxed) == 0)) {
+		DISPATCH_CLIENT_CRASH(f, "Resurrection of a future");
+	}
+	return f;
+}
+
+void
+dispatch_future_release(dispatch_future_t f)
+{
+	uint32_t refs = os_atomic_dec2o(f, dfu_refcnt, release);
+
+	if (likely(refs)) {
+		if (unlikely(refs == UINT32_MAX)) {
+			DISPATCH_CLIENT_CRASH(f, "Over-release of a future");
+		}
+		return;
+	}
+	os_atomic_thread_fence(acquire);
+	// then/any/all hold references on the futures they wait for
+	if (unlikely(f->dfu_waiters != NULL &&
+			f->dfu_waiters != DISPATCH_FUTURE_COMPLETED)) {
+		DISPATCH_INTERNAL_CRASH(f, "Future freed with pending continuations");
+	}
+	_dispatch_continuation_free((dispatch_continuation_t)f);
+}
+
+static void
+_dispatch_future_waiter_fire(dispatch_continuation_t dc)
+{
+	dispatch_queue_t dq = dc->dc_data;
+
+	if (dq) {
+		_dispatch_continuation_async(dq, dc,
+				_dispatch_qos_from_pp(dc->dc_priority), dc->dc_flags);
+		_dispatch_release(dq);
+	} else {
+		dc->dc_func(dc);
+	}
+}
+
+static void
+_dispatch_future_add_waiter(dispatch_future_t f, dispatch_continuation_t dc)
+{
+	dispatch_continuation_t head = os_atomic_load2o(f, dfu_waiters, relaxed);
+
+	do {
+		if (head == DISPATCH_FUTURE_COMPLETED) {
+			os_atomic_thread_fence(acquire);
+			return _dispatch_future_waiter_fire(dc);
+		}
+		dc->do_next = head;
+	} while (unlikely(!os_atomic_cmpxchgv2o(f, dfu_waiters, head, dc,
+			&head, release)));
+}
+
+void
+dispatch_future_complete(dispatch_future_t f, void *value)
+{
+	dispatch_continuation_t dc, next, prev = NULL;
+
+	f->dfu_value = value;
+	dc = os_atomic_xchg2o(f, dfu_waiters, DISPATCH_FUTURE_COMPLETED, acq_rel);
+	if (unlikely(dc == DISPATCH_FUTURE_COMPLETED)) {
+		DISPATCH_CLIENT_CRASH(f, "Future completed more than once");
+	}
+	if (os_atomic_xchg2o(f, dfu_state, DISPATCH_FUTURE_STATE_DONE,
+			release) == DISPATCH_FUTURE_STATE_WAITERS) {
+		_dispatch_wake_by_address(&f->dfu_state);
+	}
+
+	// continuations run in the order they were attached
+	while (dc) {
+		next = dc->do_next;
+		dc->do_next = prev;
+		prev = dc;
+		dc = next;
+	}
+	for (dc = prev; dc; dc = next) {
+		next = dc->do_next;
+		_dispatch_future_waiter_fire(dc);
+	}
+}
+
+long
+dispatch_future_wait(dispatch_future_t f, dispatch_time_t timeout,
+		void **value)
+{
+	uint32_t state = os_atomic_load2o(f, dfu_state, acquire);
+
+	while (state != DISPATCH_FUTURE_STATE_DONE) {
+		if (timeout == DISPATCH_TIME_NOW) {
+			return _DSEMA4_TIMEOUT();
+		}
+		if (state == DISPATCH_FUTURE_STATE_PENDING &&
+				!os_atomic_cmpxchgv2o(f, dfu_state,
+				DISPATCH_FUTURE_STATE_PENDING, DISPATCH_FUTURE_STATE_WAITERS,
+				&state, relaxed)) {
+			continue;
+		}
+		int rc = _dispatch_wait_on_address(&f->dfu_state,
+				DISPATCH_FUTURE_STATE_WAITERS, timeout, 0);
+		state = os_atomic_load2o(f, dfu_state, acquire);
+		if (rc == ETIMEDOUT && state != DISPATCH_FUTURE_STATE_DONE) {
+			return _DSEMA4_TIMEOUT();
+		}
+	}
+	if (value) *value = f->dfu_value;
+	return 0;
+}
+
+#pragma mark -
+#pragma mark async and then
+
+static void
+_dispatch_future_async_invoke(void *ctxt)
+{
+	dispatch_future_t f = ctxt;
+
+	dispatch_future_complete(f, f->dfu_async_func(f->dfu_ctxt));
+	dispatch_future_release(f);
+}
+
+dispatch_future_t
+dispatch_future_async_f(dispatch_queue_t dq, void *ctxt,
+		dispatch_future_function_t func)
+{
+	dispatch_continuation_t dc = _dispatch_continuation_alloc();
+	dispatch_future_t f = _dispatch_future_alloc(2); // caller + work item
+	dispatch_qos_t qos;
+
+	f->dfu_ctxt = ctxt;
+	f->dfu_async_func = func;
+	qos = _dispatch_continuation_init_f(dc, dq, f,
+			_dispatch_future_async_invoke, 0, DC_FLAG_CONSUME);
+	_dispatch_continuation_async(dq, dc, qos, dc->dc_flags);
+	return f;
+}
+
+static void
+_dispatch_future_then_invoke(void *ctxt)
+{
+	dispatch_future_t f = ctxt, source = f->dfu_source;
+	void *value;
+
+	value = f->dfu_then_func(f->dfu_ctxt, source->dfu_value);
+	f->dfu_source = NULL;
+	dispatch_future_release(source);
+	dispatch_future_complete(f, value);
+	dispatch_future_release(f);
+}
+
+dispatch_future_t
+dispatch_future_then_f(dispatch_future_t source, dispatch_queue_t dq,
+		void *ctxt, dispatch_future_then_function_t func)
+{
+	dispatch_continuation_t dc = _dispatch_continuation_alloc();
+	dispatch_future_t f = _dispatch_future_alloc(2); // caller + work item
+
+	f->dfu_source = dispatch_future_retain(source);
+	f->dfu_ctxt = ctxt;
+	f->dfu_then_func = func;
+	_dispatch_continuation_init_f(dc, dq, f, _dispatch_future_then_invoke,
+			0, DC_FLAG_CONSUME);
+	dc->dc_data = dq;
+	_dispatch_retain(dq);
+	_dispatch_future_add_waiter(source, dc);
+	return f;
+}
+
+#pragma mark -
+#pragma mark combinators
+
+// dc_ctxt is the combined future, dc_other the input that just completed,
+// each trigger owns a reference on both
+static void
+_dispatch_future_all_trigger(void *ctxt)
+{
+	dispatch_continuation_t dc = ctxt;
+	dispatch_future_t f = dc->dc_ctxt, input = dc->dc_other;
+
+	_dispatch_continuation_free(dc);
+	if (os_atomic_dec2o(f, dfu_pending, acq_rel) == 0) {
+		dispatch_future_complete(f, NULL);
+	}
+	dispatch_future_release(input);
+	dispatch_future_release(f);
+}
+
+static void
+_dispatch_future_any_trigger(void *ctxt)
+{
+	dispatch_continuation_t dc = ctxt;
+	dispatch_future_t f = dc->dc_ctxt, input = dc->dc_other;
+
+	_dispatch_continuation_free(dc);
+	if (os_atomic_xchg2o(f, dfu_pending, 0, relaxed)) {
+		dispatch_future_complete(f, input);
+	}
+	dispatch_future_release(input);
+	dispatch_future_release(f);
+}
+
+static dispatch_future_t
+_dispatch_future_combine(const dispatch_future_t *futures, size_t count,
+		uint32_t pending, dispatch_function_t trigger)
+{
+	dispatch_future_t f;
+
+	if (unlikely(count >= UINT32_MAX)) {
+		DISPATCH_CLIENT_CRASH(count, "Too many futures to combine");
+	}
+	f = _dispatch_future_alloc(1 + (uint32_t)count);
+	f->dfu_pending = pending;
+	if (pending == 0) {
+		dispatch_future_complete(f, NULL);
+	}
+	for (size_t i = 0; i < count; i++) {
+		dispatch_continuation_t dc = _dispatch_continuation_alloc();
+		dc->dc_flags = DC_FLAG_ALLOCATED;
+		dc->dc_func = trigger;
+		dc->dc_ctxt = f;
+		dc->dc_data = NULL;
+		dc->dc_other = dispatch_future_retain(futures[i]);
+		_dispatch_future_add_waiter(futures[i], dc);
+	}
+	return f;
+}
+
+dispatch_future_t
+dispatch_future_all(const dispatch_future_t *futures, size_t count)
+{
+	return _dispatch_future_combine(futures, count, (uint32_t)count,
+			_dispatch_future_all_trigger);
+}
+
+dispatch_future_t
+dispatch_future_any(const dispatch_future_t *futures, size_t count)
+{
+	if (unlikely(count == 0)) {
+		DISPATCH_CLIENT_CRASH(0, "dispatch_future_any() of no future");
+	}
+	return _dispatch_future_combine(futures, count, 1,
+			_dispatch_future_any_trigger);
+}
@@ -71,6 +71,7 @@ dispatch_atfork_child(void)
 		_dispatch_child_of_unsafe_fork = true;
 	}
 	_dispatch_queue_atfork_child();
+	_dispatch_trace_ring_atfork_child();
 	// clear the _PROHIBIT and _MULTITHREADED bits if set
 	_dispatch_unsafe_fork = 0;
 }
@@ -368,7 +369,12 @@ dispatch_get_global_queue(long priority, unsigned long flags)
 	dispatch_assert(countof(_dispatch_root_queues) ==
 			DISPATCH_ROOT_QUEUE_COUNT);
 
-	if (flags & ~(unsigned long)DISPATCH_QUEUE_OVERCOMMIT) {
+	if (flags & ~(unsigned long)DISPATCH_QUEUE_FLAGS_MASK) {
+		return DISPATCH_BAD_INPUT;
+	}
+	if ((flags & DISPATCH_QUEUE_OVERCOMMIT) &&
+			(flags & DISPATCH_QUEUE_COOPERATIVE)) {
+		// a cooperative pool by definition doesn't overcommit
 		return DISPATCH_BAD_INPUT;
 	}
 	dispatch_qos_t qos = _dispatch_qos_from_queue_priority(priority);
@@ -382,6 +388,9 @@ dispatch_get_global_queue(long priority, unsigned long flags)
 	if (qos == DISPATCH_QOS_UNSPECIFIED) {
 		return DISPATCH_BAD_INPUT;
 	}
+	if (flags & DISPATCH_QUEUE_COOPERATIVE) {
+		return _dispatch_get_cooperative_root_queue(qos);
+	}
 	//封装调用_dispatch_get_root_queue函数
 	return _dispatch_get_root_queue(qos, flags & DISPATCH_QUEUE_OVERCOMMIT);
 }
@@ -1365,6 +1374,38 @@ _dispatch_calloc(size_t num_items, size_t size)
 	return buf;
 }
 
+// calloc() only aligns for the largest scalar type, the result must be freed
+// with _dispatch_free_aligned()
+void *
+_dispatch_calloc_aligned(size_t alignment, size_t num_items, size_t size)
+{
+	void *buf;
+
+	if (unlikely(os_mul_overflow(num_items, size, &size))) {
+		DISPATCH_INTERNAL_CRASH(num_items, "Allocation size overflow");
+	}
+#if defined(_WIN32)
+	while (unlikely(!(buf = _aligned_malloc(size, alignment)))) {
+		_dispatch_temporary_resource_shortage();
+	}
+#else
+	while (unlikely(posix_memalign(&buf, alignment, size))) {
+		_dispatch_temporary_resource_shortage();
+	}
+#endif
+	return memset(buf, 0, size);
+}
+
+void
+_dispatch_free_aligned(void *buf)
+{
+#if defined(_WIN32)
+	_aligned_free(buf);
+#else
+	free(buf);
+#endif
+}
+
 /*
  * If the source string is mutable, allocates memory and copies the contents.
  * Otherwise returns the source string.
@@ -1152,6 +1152,31 @@ _dispatch_queue_setter_assert_inactive(dispatch_queue_class_t dq)
 			"dispatch queue/source property setter called after activation");
 }
 
+// see dispatch_queue_set_capacity(), only set on serial and concurrent lanes
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_lane_is_bounded(dispatch_lane_t dq)
+{
+	return _dispatch_queue_atomic_flags(dq->_as_dq) & DQF_BOUNDED;
+}
+
+// see dispatch_queue_set_rate_limit(), only set on serial and concurrent lanes
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_queue_rate_limit_t
+_dispatch_lane_rate_limit(dispatch_lane_t dq)
+{
+	unsigned long type = dx_type(dq);
+
+	if (type != DISPATCH_QUEUE_SERIAL_TYPE &&
+			type != DISPATCH_QUEUE_CONCURRENT_TYPE) {
+		return NULL;
+	}
+	if (likely(!dq->dq_ext)) {
+		return NULL;
+	}
+	return dq->dq_ext->dle_rate_limit;
+}
+
 // Note to later developers: ensure that any initialization changes are
 // made for statically allocated queues (i.e. _dispatch_main_q).
 static inline dispatch_queue_class_t
@@ -2430,7 +2455,7 @@ _dispatch_continuation_alloc(void)
 	dispatch_continuation_t dc =
 			_dispatch_continuation_alloc_cacheonly();
 	if (unlikely(!dc)) {
-		return _dispatch_continuation_alloc_from_heap();
+		return _dispatch_continuation_alloc_slow();
 	}
 	return dc;
 }
@@ -2467,6 +2492,136 @@ _dispatch_continuation_free(dispatch_continuation_t dc)
 	}
 }
 
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_continuation_t
+_dispatch_continuation_inline_alloc(void)
+{
+	dispatch_continuation_t dc = (dispatch_continuation_t)
+			_dispatch_thread_getspecific(dispatch_inline_cache_key);
+	if (likely(dc)) {
+		_dispatch_thread_setspecific(dispatch_inline_cache_key, dc->do_next);
+		return dc;
+	}
+	return _dispatch_continuation_inline_alloc_slow();
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_continuation_inline_free(dispatch_continuation_t dc)
+{
+	dispatch_continuation_t prev_dc = (dispatch_continuation_t)
+			_dispatch_thread_getspecific(dispatch_inline_cache_key);
+	int cnt = prev_dc ? prev_dc->dc_cache_cnt + 1 : 1;
+	// Cap inline continuation cache, and shrink it with the regular one
+	// under memory pressure
+	if (unlikely(cnt > DISPATCH_CONTINUATION_INLINE_CACHE_LIMIT ||
+			cnt > _dispatch_continuation_cache_limit)) {
+		return _dispatch_continuation_inline_free_slow(dc);
+	}
+	dc->do_next = prev_dc;
+	dc->dc_cache_cnt = cnt;
+	_dispatch_thread_setspecific(dispatch_inline_cache_key, dc);
+}
+
+// Blocks still on the stack are copied into the second half of an inline
+// continuation when they fit, which saves the allocation _Block_copy() would
+// make. Heap and global blocks are only retained by _Block_copy() anyway.
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_block_can_inline(dispatch_block_t work)
+{
+	struct Block_layout *bl = (struct Block_layout *)(void *)work;
+	return likely(bl) && !(bl->flags & (BLOCK_NEEDS_FREE | BLOCK_IS_GLOBAL)) &&
+			bl->descriptor->size <= DISPATCH_CONTINUATION_INLINE_BLOCK_SIZE &&
+			!_dispatch_block_has_private_data(work);
+}
+
+// Same copy as the one _Block_copy() makes on the heap, except that it still
+// looks like a stack block: the copy goes away with the continuation, once
+// _dispatch_continuation_inline_block_dispose() ran the dispose helper, so a
+// Block_copy() of it made by the work item itself must move it to the heap,
+// and a Block_release() of it must do nothing.
+DISPATCH_ALWAYS_INLINE
+static inline void *
+_dispatch_continuation_inline_block_copy(dispatch_continuation_t dc,
+		dispatch_block_t work)
+{
+	struct Block_layout *src = (struct Block_layout *)(void *)work;
+	struct Block_layout *dst = (struct Block_layout *)(void *)
+			((dispatch_continuation_inline_t)dc)->dci_block;
+
+	memcpy(dst, src, src->descriptor->size);
+	if (src->flags & BLOCK_HAS_COPY_DISPOSE) {
+		struct Block_descriptor_2 *desc2 =
+				(struct Block_descriptor_2 *)(src->descriptor + 1);
+		desc2->copy(dst, src);
+	}
+	return dst;
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_continuation_inline_block_dispose(dispatch_continuation_t dc)
+{
+	struct Block_layout *bl = dc->dc_ctxt;
+	if (bl->flags & BLOCK_HAS_COPY_DISPOSE) {
+		struct Block_descriptor_2 *desc2 =
+				(struct Block_descriptor_2 *)(bl->descriptor + 1);
+		desc2->dispose(bl);
+	}
+}
+#endif // DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+
+// Allocates the continuation for a block that _dispatch_continuation_init()
+// will copy, adds DC_FLAG_BLOCK_INLINE to `dc_flags` when the block will be
+// copied into the continuation itself.
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_continuation_t
+_dispatch_continuation_alloc_for_block(dispatch_block_t work,
+		uintptr_t *dc_flags)
+{
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+	// the continuation must only be freed once the block ran
+	if ((*dc_flags & DC_FLAG_CONSUME) && _dispatch_block_can_inline(work)) {
+		*dc_flags |= DC_FLAG_BLOCK_INLINE;
+		return _dispatch_continuation_inline_alloc();
+	}
+#else
+	(void)work; (void)dc_flags;
+#endif
+	return _dispatch_continuation_alloc();
+}
+
+#if DISPATCH_USE_GROUP_LEAVE_BATCHING
+// Only root queue drains flush deferred leaves, see semaphore_internal.h
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_group_leave_can_defer(dispatch_group_t dg)
+{
+	dispatch_queue_t dq = _dispatch_queue_get_current();
+	return dg->dg_batched && dq && dx_type(dq) == DISPATCH_QUEUE_GLOBAL_ROOT_TYPE;
+}
+
+// Called by root queue drains before they run `dou`
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_group_leave_flush_before(dispatch_object_t dou)
+{
+	void *dg = _dispatch_thread_getspecific(dispatch_group_leave_key);
+	if (unlikely(dg)) {
+		if (_dispatch_object_has_vtable(dou) ||
+				!(dou._dc->dc_flags & DC_FLAG_GROUP_ASYNC) ||
+				dou._dc->dc_data != dg) {
+			_dispatch_group_leave_flush();
+		}
+	}
+}
+#else
+#define _dispatch_group_leave_can_defer(dg) ((void)(dg), false)
+#define _dispatch_group_leave_flush_before(dou) ((void)(dou))
+#endif
+
 //dispatch_group_async 提交的异步任务执行时调用的函数
 DISPATCH_ALWAYS_INLINE
 static inline void
@@ -2481,7 +2636,11 @@ _dispatch_continuation_with_group_invoke(dispatch_continuation_t dc)
 		_dispatch_client_callout(dc->dc_ctxt, dc->dc_func);
 		_dispatch_trace_item_complete(dc);
 		//leave
-		dispatch_group_leave((dispatch_group_t)dou);
+		if (_dispatch_group_leave_can_defer((dispatch_group_t)dou)) {
+			_dispatch_group_leave_deferred((dispatch_group_t)dou);
+		} else {
+			dispatch_group_leave((dispatch_group_t)dou);
+		}
 	} else {
 		DISPATCH_INTERNAL_CRASH(dx_type(dou), "Unexpected object type");
 	}
@@ -2506,7 +2665,8 @@ _dispatch_continuation_invoke_inline(dispatch_object_t dou,
 		if (!(dc_flags & DC_FLAG_NO_INTROSPECTION)) {
 			_dispatch_trace_item_pop(dqu, dou);
 		}
-		if (dc_flags & DC_FLAG_CONSUME) {
+		if ((dc_flags & (DC_FLAG_CONSUME | DC_FLAG_BLOCK_INLINE)) ==
+				DC_FLAG_CONSUME) {
 			dc1 = _dispatch_continuation_free_cacheonly(dc);
 		} else {
 			dc1 = NULL;
@@ -2521,6 +2681,13 @@ _dispatch_continuation_invoke_inline(dispatch_object_t dou,
 		if (unlikely(dc1)) {
 			_dispatch_continuation_free_to_cache_limit(dc1);
 		}
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+		// the block lives in the continuation, which can't be reused early
+		if (dc_flags & DC_FLAG_BLOCK_INLINE) {
+			_dispatch_continuation_inline_block_dispose(dc);
+			_dispatch_continuation_inline_free(dc);
+		}
+#endif
 	});
 	_dispatch_perfmon_workitem_inc();
 }
@@ -2533,6 +2700,7 @@ _dispatch_continuation_pop_inline(dispatch_object_t dou,
 {
 	dispatch_pthread_root_queue_observer_hooks_t observer_hooks =
 			_dispatch_get_pthread_root_queue_observer_hooks();
+	uint64_t start = _dispatch_introspection_drain_item_start(dic);
 	if (observer_hooks) observer_hooks->queue_will_execute(dqu._dq);
 	flags &= _DISPATCH_INVOKE_PROPAGATE_MASK;
 	if (_dispatch_object_has_vtable(dou)) {
@@ -2541,6 +2709,7 @@ _dispatch_continuation_pop_inline(dispatch_object_t dou,
 		_dispatch_continuation_invoke_inline(dou, flags, dqu);
 	}
 	if (observer_hooks) observer_hooks->queue_did_execute(dqu._dq);
+	_dispatch_introspection_drain_item_end(dic, dou, dqu, start);
 }
 
 // used to forward the do_invoke of a continuation with a vtable to its real
@@ -2641,8 +2810,19 @@ _dispatch_continuation_init(dispatch_continuation_t dc,
 		dispatch_queue_class_t dqu, dispatch_block_t work,
 		dispatch_block_flags_t flags, uintptr_t dc_flags)
 {
-	void *ctxt = _dispatch_Block_copy(work);
+	void *ctxt;
 
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+	if (dc_flags & DC_FLAG_BLOCK_INLINE) {
+		// invoked directly, _dispatch_continuation_invoke_inline() disposes
+		// of the copy when the continuation is freed
+		ctxt = _dispatch_continuation_inline_block_copy(dc, work);
+		dc_flags |= DC_FLAG_BLOCK | DC_FLAG_ALLOCATED;
+		return _dispatch_continuation_init_f(dc, dqu, ctxt,
+				_dispatch_Block_invoke(work), flags, dc_flags);
+	}
+#endif
+	ctxt = _dispatch_Block_copy(work);
 	dc_flags |= DC_FLAG_BLOCK | DC_FLAG_ALLOCATED;
 	if (unlikely(_dispatch_block_has_private_data(work))) {
 		dc->dc_flags = dc_flags;
@@ -2664,13 +2844,9 @@ static inline void
 _dispatch_continuation_async(dispatch_queue_class_t dqu,
 		dispatch_continuation_t dc, dispatch_qos_t qos, uintptr_t dc_flags)
 {
-#if DISPATCH_INTROSPECTION
 	if (!(dc_flags & DC_FLAG_NO_INTROSPECTION)) {
 		_dispatch_trace_item_push(dqu, dc);
 	}
-#else
-	(void)dc_flags;
-#endif
 	//// 调用队列的 dq_push 函数，并示把任务放入到指定的队列中
 	return dx_push(dqu._dq, dc, qos);
 	// dx_push 是一个宏定义
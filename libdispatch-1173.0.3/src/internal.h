@@ -94,6 +94,11 @@
 #define OS_OBJECT_HAVE_OBJC_SUPPORT 0
 #endif // USE_OBJC
 
+#if defined(__linux__) && !defined(DISPATCH_ONCE_QUIESCENT_RUNTIME)
+// libdispatch always runs its own dispatch_once(), see <dispatch/once.h>
+#define DISPATCH_ONCE_QUIESCENT_RUNTIME 1
+#endif
+
 #include <dispatch/dispatch.h>
 #include <dispatch/base.h>
 
@@ -230,6 +235,7 @@ upcast(dispatch_object_t dou)
 #include "os/voucher_activity_private.h"
 #include "io_private.h"
 #include "layout_private.h"
+#include "future_private.h"
 #include "benchmark.h"
 #include "private.h"
 
@@ -365,6 +371,32 @@ DISPATCH_EXPORT DISPATCH_NOTHROW void dispatch_atfork_child(void);
 #define DISPATCH_USE_DTRACE_INTROSPECTION 1
 #endif
 
+// Portable binary tracing for platforms without firehose, see trace_ring.c
+#if DISPATCH_USE_THREAD_LOCAL_STORAGE && !defined(__APPLE__) && \
+		!defined(_WIN32) && !defined(DISPATCH_USE_TRACE_RING)
+#define DISPATCH_USE_TRACE_RING 1
+#endif
+
+// Counters of _dispatch_event_loop_get_stats(), which cost a write to a shared
+// cacheline on every poke of the event loop: debug and benchmark builds only
+#if DISPATCH_DEBUG && !defined(DISPATCH_USE_EVENT_LOOP_STATS)
+#define DISPATCH_USE_EVENT_LOOP_STATS 1
+#endif
+
+// Small blocks copied into the continuation that runs them, see
+// _dispatch_continuation_alloc_for_block(). Needs a spare TSD slot
+#if DISPATCH_USE_THREAD_LOCAL_STORAGE && defined(__BLOCKS__) && \
+		!defined(DISPATCH_USE_CONTINUATION_INLINE_BLOCK)
+#define DISPATCH_USE_CONTINUATION_INLINE_BLOCK 1
+#endif
+
+// Leaves of dispatch_group_async() items accumulated per worker thread, see
+// _dispatch_group_leave_deferred(). Needs spare TSD slots
+#if DISPATCH_USE_THREAD_LOCAL_STORAGE && \
+		!defined(DISPATCH_USE_GROUP_LEAVE_BATCHING)
+#define DISPATCH_USE_GROUP_LEAVE_BATCHING 1
+#endif
+
 #ifndef DISPATCH_DEBUG_QOS
 #define DISPATCH_DEBUG_QOS DISPATCH_DEBUG
 #endif
@@ -635,6 +667,8 @@ bool _dispatch_parse_bool(const char *v);
 bool _dispatch_getenv_bool(const char *env, bool default_v);
 void _dispatch_temporary_resource_shortage(void);
 void *_dispatch_calloc(size_t num_items, size_t size);
+void *_dispatch_calloc_aligned(size_t alignment, size_t num_items, size_t size);
+void _dispatch_free_aligned(void *buf);
 const char *_dispatch_strdup_if_mutable(const char *str);
 void _dispatch_vtable_init(void);
 char *_dispatch_get_build(void);
@@ -643,6 +677,7 @@ int _dispatch_sigmask(void);
 #endif
 
 uint64_t _dispatch_timeout(dispatch_time_t when);
+uint64_t _dispatch_timeout_approximate(dispatch_time_t when);
 uint64_t _dispatch_time_nanoseconds_since_epoch(dispatch_time_t when);
 
 #define _DISPATCH_UNSAFE_FORK_MULTITHREADED  ((uint8_t)1)
@@ -786,6 +821,15 @@ _dispatch_fork_becomes_unsafe(void)
 #if !defined(DISPATCH_USE_MEMORYPRESSURE_SOURCE) && DISPATCH_USE_MEMORYSTATUS
 #define DISPATCH_USE_MEMORYPRESSURE_SOURCE 1
 #endif
+#if !defined(DISPATCH_USE_MEMORYPRESSURE_SOURCE) && \
+		DISPATCH_EVENT_BACKEND_EPOLL
+// backed by the PSI memory pressure triggers of the kernel
+#define DISPATCH_USE_MEMORYPRESSURE_SOURCE 1
+#endif
+
+#ifndef DISPATCH_USE_CONTINUATION_DEPOT
+#define DISPATCH_USE_CONTINUATION_DEPOT 1
+#endif
 
 #if __has_include(<malloc_private.h>)
 #include <malloc_private.h>
@@ -21,10 +21,11 @@
 // Contains introspection routines that only exist in the version of the
 // library with introspection support
 
+#include "internal.h"
+
 #if DISPATCH_INTROSPECTION
 
 #include <execinfo.h>
-#include "internal.h"
 #include "dispatch/introspection.h"
 #include "introspection_private.h"
 
@@ -1206,3 +1207,60 @@ _dispatch_introspection_target_queue_changed(dispatch_queue_t dq)
 }
 
 #endif // DISPATCH_INTROSPECTION
+
+#pragma mark -
+#pragma mark dispatch_introspection_batch_hooks
+
+uint32_t _dispatch_introspection_batch_hooks_installed;
+static dispatch_introspection_batch_hooks_s _dispatch_introspection_batch_hooks;
+
+void
+dispatch_introspection_batch_hooks_install(
+		dispatch_introspection_batch_hooks_t hooks)
+{
+	dispatch_introspection_batch_hooks_s old_hooks;
+	uint32_t installed = 0;
+
+	old_hooks = _dispatch_introspection_batch_hooks;
+	if (hooks->item_enqueued) installed |= DISPATCH_INTROSPECTION_BATCH_ENQUEUE;
+	if (hooks->drain_batch) installed |= DISPATCH_INTROSPECTION_BATCH_DRAIN;
+
+	// threads that still see the old word find NULL hooks at worst
+	os_atomic_store(&_dispatch_introspection_batch_hooks.item_enqueued,
+			hooks->item_enqueued, relaxed);
+	os_atomic_store(&_dispatch_introspection_batch_hooks.drain_batch,
+			hooks->drain_batch, relaxed);
+	os_atomic_store(&_dispatch_introspection_batch_hooks_installed, installed,
+			release);
+	*hooks = old_hooks;
+}
+
+DISPATCH_NOINLINE
+void
+_dispatch_introspection_batch_item_push_slow(dispatch_queue_class_t dqu,
+		dispatch_object_t dou)
+{
+	dispatch_introspection_hook_item_enqueued_t h;
+
+	h = os_atomic_load(&_dispatch_introspection_batch_hooks.item_enqueued,
+			relaxed);
+	if (h) h(dqu._dq, dou._do);
+}
+
+DISPATCH_NOINLINE
+void
+_dispatch_introspection_drain_buffer_flush(
+		dispatch_introspection_drain_buffer_t didb)
+{
+	dispatch_introspection_hook_drain_batch_t h;
+	dispatch_introspection_drain_batch_s batch = {
+		.root_queue = didb->didb_root_queue->_as_dq,
+		.count = didb->didb_count,
+		.items = didb->didb_items,
+	};
+
+	h = os_atomic_load(&_dispatch_introspection_batch_hooks.drain_batch,
+			relaxed);
+	if (h) h(&batch);
+	didb->didb_count = 0;
+}
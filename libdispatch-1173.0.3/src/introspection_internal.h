@@ -233,4 +233,119 @@ _dispatch_introspection_runtime_event(
 
 #endif // DISPATCH_INTROSPECTION
 
+#pragma mark -
+#pragma mark dispatch_introspection_batch_hooks
+
+#define DISPATCH_INTROSPECTION_BATCH_ENQUEUE	0x1u
+#define DISPATCH_INTROSPECTION_BATCH_DRAIN		0x2u
+
+#define DISPATCH_INTROSPECTION_DRAIN_BATCH_SIZE	16
+
+// lives on the stack of the worker thread draining a root queue
+typedef struct dispatch_introspection_drain_buffer_s {
+	dispatch_queue_global_t didb_root_queue;
+	uint32_t didb_count;
+	dispatch_introspection_drain_item_s
+			didb_items[DISPATCH_INTROSPECTION_DRAIN_BATCH_SIZE];
+} dispatch_introspection_drain_buffer_s, *dispatch_introspection_drain_buffer_t;
+
+extern uint32_t _dispatch_introspection_batch_hooks_installed;
+
+void _dispatch_introspection_batch_item_push_slow(dispatch_queue_class_t dqu,
+		dispatch_object_t dou);
+void _dispatch_introspection_drain_buffer_flush(
+		dispatch_introspection_drain_buffer_t didb);
+
+#if DISPATCH_PURE_C
+
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_introspection_batch_hooks_enabled(uint32_t kind)
+{
+	uint32_t installed = os_atomic_load(
+			&_dispatch_introspection_batch_hooks_installed, relaxed);
+	return unlikely(installed & kind);
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_introspection_batch_item_push(dispatch_queue_class_t dqu,
+		dispatch_object_t dou)
+{
+	if (_dispatch_introspection_batch_hooks_enabled(
+			DISPATCH_INTROSPECTION_BATCH_ENQUEUE)) {
+		_dispatch_introspection_batch_item_push_slow(dqu, dou);
+	}
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_introspection_batch_item_push_list(dispatch_queue_class_t dqu,
+		dispatch_object_t _head, dispatch_object_t _tail)
+{
+	if (_dispatch_introspection_batch_hooks_enabled(
+			DISPATCH_INTROSPECTION_BATCH_ENQUEUE)) {
+		struct dispatch_object_s *dou = _head._do;
+		do {
+			_dispatch_introspection_batch_item_push_slow(dqu, dou);
+		} while (dou != _tail._do && (dou = dou->do_next));
+	}
+}
+
+// The hooks word is only looked at once per drain, items then only test
+// the buffer pointer of the invoke context which is already in cache
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_introspection_drain_begin(dispatch_invoke_context_t dic,
+		dispatch_introspection_drain_buffer_t didb, dispatch_queue_global_t rq)
+{
+	if (_dispatch_introspection_batch_hooks_enabled(
+			DISPATCH_INTROSPECTION_BATCH_DRAIN)) {
+		didb->didb_root_queue = rq;
+		didb->didb_count = 0;
+		dic->dic_drain_buffer = didb;
+	}
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_introspection_drain_end(dispatch_invoke_context_t dic)
+{
+	dispatch_introspection_drain_buffer_t didb = dic->dic_drain_buffer;
+	if (unlikely(didb)) {
+		if (didb->didb_count) _dispatch_introspection_drain_buffer_flush(didb);
+		dic->dic_drain_buffer = NULL;
+	}
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline uint64_t
+_dispatch_introspection_drain_item_start(dispatch_invoke_context_t dic)
+{
+	return unlikely(dic->dic_drain_buffer) ? _dispatch_uptime() : 0;
+}
+
+// items are recorded when they finish, so that the items of a queue drained
+// by a parent item never reuse the slot of their parent
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_introspection_drain_item_end(dispatch_invoke_context_t dic,
+		dispatch_object_t dou, dispatch_queue_class_t dqu, uint64_t start)
+{
+	dispatch_introspection_drain_buffer_t didb = dic->dic_drain_buffer;
+	dispatch_introspection_drain_item_s *item;
+
+	if (likely(!didb)) return;
+	if (unlikely(didb->didb_count == DISPATCH_INTROSPECTION_DRAIN_BATCH_SIZE)) {
+		_dispatch_introspection_drain_buffer_flush(didb);
+	}
+	item = &didb->didb_items[didb->didb_count++];
+	item->item = dou._do;
+	item->queue = dqu._dq;
+	item->start = start;
+	item->end = _dispatch_uptime();
+}
+
+#endif // DISPATCH_PURE_C
+
 #endif // __DISPATCH_INTROSPECTION_INTERNAL__
@@ -273,6 +273,7 @@ typedef struct dispatch_invoke_context_s {
 #endif
 	struct dispatch_object_s *dic_barrier_waiter;
 	dispatch_qos_t dic_barrier_waiter_bucket;
+	struct dispatch_introspection_drain_buffer_s *dic_drain_buffer;
 #if DISPATCH_COCOA_COMPAT
 	void *dic_autorelease_pool;
 #endif
@@ -36,6 +36,15 @@ static inline void _dispatch_queue_wakeup_with_override(
 static void _dispatch_workloop_drain_barrier_waiter(dispatch_workloop_t dwl,
 		struct dispatch_object_s *dc, dispatch_qos_t qos,
 		dispatch_wakeup_flags_t flags, uint64_t owned);
+static void _dispatch_lane_capacity_pop(dispatch_lane_t dq,
+		struct dispatch_object_s *dou);
+static void _dispatch_deadline_invoke(void *ctxt);
+static void _dispatch_lane_push_list(dispatch_lane_t dq,
+		dispatch_object_t head, dispatch_object_t tail, size_t n,
+		dispatch_qos_t qos);
+static void _dispatch_root_queue_push_list(dispatch_queue_global_t rq,
+		dispatch_object_t head, dispatch_object_t tail, int n,
+		dispatch_qos_t qos);
 
 #pragma mark -
 #pragma mark dispatch_assert_queue
@@ -233,12 +242,354 @@ const struct dispatch_continuation_vtable_s _dispatch_continuation_vtables[] = {
 #endif
 };
 
+#if DISPATCH_USE_CONTINUATION_DEPOT
+// The depot is where thread caches exchange continuations, in batches of
+// DISPATCH_CONTINUATION_DEPOT_BATCH linked through do_next with a valid
+// dc_cache_cnt, so that a batch can be installed as a thread cache as is.
+//
+// Slots are swapped whole: a batch is taken with an exchange and returned with
+// a compare-and-swap from NULL, so no pointer is ever read from a batch that
+// may be concurrently recycled, which makes the depot immune to ABA.
+typedef struct dispatch_continuation_depot_slot_s {
+	dispatch_continuation_t volatile dcds_batch;
+} DISPATCH_CACHELINE_ALIGN *dispatch_continuation_depot_slot_t;
+
+typedef struct dispatch_continuation_depot_s {
+	struct dispatch_continuation_depot_slot_s dcd_slots[
+			DISPATCH_CONTINUATION_DEPOT_SLOTS];
+	int volatile dcd_batches DISPATCH_CACHELINE_ALIGN;
+	uint64_t volatile dcd_hits;
+	uint64_t volatile dcd_misses;
+	uint64_t volatile dcd_returns;
+	uint64_t volatile dcd_overflows;
+} *dispatch_continuation_depot_t;
+
+static struct dispatch_continuation_depot_s _dispatch_continuation_depot;
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+// inline continuations have twice the size and can't share the depot
+static struct dispatch_continuation_depot_s _dispatch_continuation_inline_depot;
+#endif
+
+DISPATCH_ALWAYS_INLINE
+static inline uint32_t
+_dispatch_continuation_depot_start_slot(void)
+{
+	// spread threads over the slots so that they don't all hammer slot 0
+	uint32_t h = (uint32_t)(uintptr_t)_dispatch_tid_self() * 0x9e3779b1u;
+	return h % DISPATCH_CONTINUATION_DEPOT_SLOTS;
+}
+
+static dispatch_continuation_t
+_dispatch_continuation_depot_pop(dispatch_continuation_depot_t dcd)
+{
+	dispatch_continuation_depot_slot_t slots;
+	dispatch_continuation_t batch;
+	uint32_t i, idx;
+
+	slots = dcd->dcd_slots;
+	if (os_atomic_load2o(dcd, dcd_batches, relaxed) > 0) {
+		idx = _dispatch_continuation_depot_start_slot();
+		for (i = 0; i < DISPATCH_CONTINUATION_DEPOT_SLOTS; i++) {
+			dispatch_continuation_depot_slot_t slot = &slots[idx];
+			if (os_atomic_load2o(slot, dcds_batch, relaxed) &&
+					(batch = os_atomic_xchg2o(slot, dcds_batch, NULL,
+					acquire))) {
+				os_atomic_dec2o(dcd, dcd_batches, relaxed);
+				os_atomic_inc2o(dcd, dcd_hits, relaxed);
+				return batch;
+			}
+			if (++idx == DISPATCH_CONTINUATION_DEPOT_SLOTS) idx = 0;
+		}
+	}
+	os_atomic_inc2o(dcd, dcd_misses, relaxed);
+	return NULL;
+}
+
+static bool
+_dispatch_continuation_depot_push(dispatch_continuation_depot_t dcd,
+		dispatch_continuation_t batch)
+{
+	dispatch_continuation_depot_slot_t slots;
+	uint32_t i, idx;
+
+	slots = dcd->dcd_slots;
+	if (os_atomic_load2o(dcd, dcd_batches, relaxed) <
+			(int)DISPATCH_CONTINUATION_DEPOT_SLOTS) {
+		idx = _dispatch_continuation_depot_start_slot();
+		for (i = 0; i < DISPATCH_CONTINUATION_DEPOT_SLOTS; i++) {
+			dispatch_continuation_depot_slot_t slot = &slots[idx];
+			if (!os_atomic_load2o(slot, dcds_batch, relaxed) &&
+					os_atomic_cmpxchg2o(slot, dcds_batch, NULL, batch,
+					release)) {
+				os_atomic_inc2o(dcd, dcd_batches, relaxed);
+				os_atomic_inc2o(dcd, dcd_returns, relaxed);
+				return true;
+			}
+			if (++idx == DISPATCH_CONTINUATION_DEPOT_SLOTS) idx = 0;
+		}
+	}
+	os_atomic_inc2o(dcd, dcd_overflows, relaxed);
+	return false;
+}
+
+// Cuts a batch off the front of the list `dc`, and renumbers its
+// dc_cache_cnt from DISPATCH_CONTINUATION_DEPOT_BATCH down to 1.
+// Returns the remainder of the list, or `dc` when it is too short.
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_continuation_t
+_dispatch_continuation_depot_cut_batch(dispatch_continuation_t dc)
+{
+	dispatch_continuation_t it = dc;
+	int cnt = DISPATCH_CONTINUATION_DEPOT_BATCH;
+
+	while (--cnt) {
+		if (!(it = it->do_next)) return dc;
+	}
+	dispatch_continuation_t rest = it->do_next;
+	it->do_next = NULL;
+	for (it = dc, cnt = DISPATCH_CONTINUATION_DEPOT_BATCH; it;
+			it = it->do_next) {
+		it->dc_cache_cnt = cnt--;
+	}
+	return rest;
+}
+
+static void
+_dispatch_continuation_free_batch_to_heap(dispatch_continuation_t dc)
+{
+	dispatch_continuation_t next_dc;
+
+	while (dc) {
+		next_dc = dc->do_next;
+		_dispatch_continuation_free_to_heap(dc);
+		dc = next_dc;
+	}
+}
+
+// Called with `dc` overflowing the thread cache: `dc` and the top of the
+// thread cache are returned to the depot as one batch.
+static bool
+_dispatch_continuation_free_to_depot(dispatch_continuation_t dc)
+{
+	dispatch_continuation_t rest;
+
+	dc->do_next = _dispatch_thread_getspecific(dispatch_cache_key);
+	rest = _dispatch_continuation_depot_cut_batch(dc);
+	if (unlikely(rest == dc)) {
+		return false;
+	}
+	_dispatch_thread_setspecific(dispatch_cache_key, rest);
+	if (unlikely(!_dispatch_continuation_depot_push(
+			&_dispatch_continuation_depot, dc))) {
+		_dispatch_continuation_free_batch_to_heap(dc);
+	}
+	return true;
+}
+
+DISPATCH_NOINLINE
+dispatch_continuation_t
+_dispatch_continuation_alloc_slow(void)
+{
+	dispatch_continuation_t dc = NULL;
+
+	// only refill from the depot when it isn't being drained due to
+	// memory pressure
+	if (likely(_dispatch_continuation_cache_limit ==
+			DISPATCH_CONTINUATION_CACHE_LIMIT)) {
+		dc = _dispatch_continuation_depot_pop(&_dispatch_continuation_depot);
+	}
+	if (likely(dc)) {
+		_dispatch_thread_setspecific(dispatch_cache_key, dc->do_next);
+		return dc;
+	}
+	return _dispatch_continuation_alloc_from_heap();
+}
+
+static void
+_dispatch_continuation_depot_trim_batches(dispatch_continuation_depot_t dcd,
+		void (*free_batch)(dispatch_continuation_t))
+{
+	dispatch_continuation_depot_slot_t slots;
+	dispatch_continuation_t batch;
+
+	slots = dcd->dcd_slots;
+	for (uint32_t i = 0; i < DISPATCH_CONTINUATION_DEPOT_SLOTS; i++) {
+		batch = os_atomic_xchg2o(&slots[i], dcds_batch, NULL, acquire);
+		if (batch) {
+			os_atomic_dec2o(dcd, dcd_batches, relaxed);
+			free_batch(batch);
+		}
+	}
+}
+
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+static void _dispatch_continuation_inline_free_batch(dispatch_continuation_t);
+#endif
+
+void
+_dispatch_continuation_depot_trim(void)
+{
+	_dispatch_continuation_depot_trim_batches(&_dispatch_continuation_depot,
+			_dispatch_continuation_free_batch_to_heap);
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+	_dispatch_continuation_depot_trim_batches(
+			&_dispatch_continuation_inline_depot,
+			_dispatch_continuation_inline_free_batch);
+#endif
+}
+
+static void
+_dispatch_continuation_depot_snapshot(dispatch_continuation_depot_t dcd,
+		dispatch_continuation_depot_stats_s *stats)
+{
+	stats->dcds_hits = os_atomic_load2o(dcd, dcd_hits, relaxed);
+	stats->dcds_misses = os_atomic_load2o(dcd, dcd_misses, relaxed);
+	stats->dcds_returns = os_atomic_load2o(dcd, dcd_returns, relaxed);
+	stats->dcds_overflows = os_atomic_load2o(dcd, dcd_overflows, relaxed);
+	stats->dcds_batches = (uint64_t)os_atomic_load2o(dcd, dcd_batches,
+			relaxed);
+	stats->dcds_batch_size = DISPATCH_CONTINUATION_DEPOT_BATCH;
+}
+
+void
+_dispatch_continuation_depot_get_stats(
+		dispatch_continuation_depot_stats_s *stats)
+{
+	_dispatch_continuation_depot_snapshot(&_dispatch_continuation_depot,
+			stats);
+}
+
+void
+_dispatch_continuation_inline_depot_get_stats(
+		dispatch_continuation_depot_stats_s *stats)
+{
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+	_dispatch_continuation_depot_snapshot(
+			&_dispatch_continuation_inline_depot, stats);
+#else
+	memset(stats, 0, sizeof(*stats));
+#endif
+}
+#else
+void
+_dispatch_continuation_depot_get_stats(
+		dispatch_continuation_depot_stats_s *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
+void
+_dispatch_continuation_inline_depot_get_stats(
+		dispatch_continuation_depot_stats_s *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+#endif // DISPATCH_USE_CONTINUATION_DEPOT
+
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+static void
+_dispatch_continuation_inline_free_batch(dispatch_continuation_t dc)
+{
+	dispatch_continuation_t next_dc;
+
+	while (dc) {
+		next_dc = dc->do_next;
+		free(dc);
+		dc = next_dc;
+	}
+}
+
+DISPATCH_NOINLINE
+dispatch_continuation_t
+_dispatch_continuation_inline_alloc_slow(void)
+{
+	dispatch_continuation_t dc = NULL;
+
+#if DISPATCH_USE_CONTINUATION_DEPOT
+	if (likely(_dispatch_continuation_cache_limit ==
+			DISPATCH_CONTINUATION_CACHE_LIMIT)) {
+		dc = _dispatch_continuation_depot_pop(
+				&_dispatch_continuation_inline_depot);
+	}
+	if (likely(dc)) {
+		_dispatch_thread_setspecific(dispatch_inline_cache_key, dc->do_next);
+		return dc;
+	}
+#endif
+	while (unlikely(!(dc = malloc(DISPATCH_CONTINUATION_INLINE_SIZE)))) {
+		_dispatch_temporary_resource_shortage();
+	}
+	return dc;
+}
+
+// Called with `dc` overflowing the thread cache, same as
+// _dispatch_continuation_free_to_depot() for inline continuations.
+DISPATCH_NOINLINE
+void
+_dispatch_continuation_inline_free_slow(dispatch_continuation_t dc)
+{
+#if DISPATCH_USE_CONTINUATION_DEPOT
+	dispatch_continuation_t rest;
+
+	if (likely(_dispatch_continuation_cache_limit ==
+			DISPATCH_CONTINUATION_CACHE_LIMIT)) {
+		dc->do_next = _dispatch_thread_getspecific(dispatch_inline_cache_key);
+		rest = _dispatch_continuation_depot_cut_batch(dc);
+		if (likely(rest != dc)) {
+			_dispatch_thread_setspecific(dispatch_inline_cache_key, rest);
+			if (unlikely(!_dispatch_continuation_depot_push(
+					&_dispatch_continuation_inline_depot, dc))) {
+				_dispatch_continuation_inline_free_batch(dc);
+			}
+			return;
+		}
+	}
+#endif
+	free(dc);
+}
+
+static void DISPATCH_TSD_DTOR_CC
+_dispatch_inline_cache_cleanup(void *value)
+{
+	dispatch_continuation_t dc, next_dc = value;
+
+#if DISPATCH_USE_CONTINUATION_DEPOT
+	if (likely(_dispatch_continuation_cache_limit ==
+			DISPATCH_CONTINUATION_CACHE_LIMIT)) {
+		while ((dc = next_dc) &&
+				(next_dc = _dispatch_continuation_depot_cut_batch(dc)) != dc) {
+			if (unlikely(!_dispatch_continuation_depot_push(
+					&_dispatch_continuation_inline_depot, dc))) {
+				_dispatch_continuation_inline_free_batch(dc);
+			}
+		}
+		next_dc = dc;
+	}
+#endif
+	_dispatch_continuation_inline_free_batch(next_dc);
+}
+#endif // DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+
 DISPATCH_NOINLINE
 static void DISPATCH_TSD_DTOR_CC
 _dispatch_cache_cleanup(void *value)
 {
 	dispatch_continuation_t dc, next_dc = value;
 
+#if DISPATCH_USE_CONTINUATION_DEPOT
+	// hand full batches over to the threads that are still around
+	if (likely(_dispatch_continuation_cache_limit ==
+			DISPATCH_CONTINUATION_CACHE_LIMIT)) {
+		while ((dc = next_dc) &&
+				(next_dc = _dispatch_continuation_depot_cut_batch(dc)) != dc) {
+			if (unlikely(!_dispatch_continuation_depot_push(
+					&_dispatch_continuation_depot, dc))) {
+				_dispatch_continuation_free_batch_to_heap(dc);
+			}
+		}
+		next_dc = dc;
+	}
+#endif
 	while ((dc = next_dc)) {
 		next_dc = dc->do_next;
 		_dispatch_continuation_free_to_heap(dc);
@@ -254,14 +605,29 @@ _dispatch_force_cache_cleanup(void)
 		_dispatch_thread_setspecific(dispatch_cache_key, NULL);
 		_dispatch_cache_cleanup(dc);
 	}
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+	dc = _dispatch_thread_getspecific(dispatch_inline_cache_key);
+	if (dc) {
+		_dispatch_thread_setspecific(dispatch_inline_cache_key, NULL);
+		_dispatch_inline_cache_cleanup(dc);
+	}
+#endif
 }
 
-#if DISPATCH_USE_MEMORYPRESSURE_SOURCE
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE || DISPATCH_USE_CONTINUATION_DEPOT
 DISPATCH_NOINLINE
 void
 _dispatch_continuation_free_to_cache_limit(dispatch_continuation_t dc)
 {
+#if DISPATCH_USE_CONTINUATION_DEPOT
+	if (likely(_dispatch_continuation_cache_limit ==
+			DISPATCH_CONTINUATION_CACHE_LIMIT) &&
+			_dispatch_continuation_free_to_depot(dc)) {
+		return;
+	}
+#endif
 	_dispatch_continuation_free_to_heap(dc);
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE
 	dispatch_continuation_t next_dc;
 	dc = _dispatch_thread_getspecific(dispatch_cache_key);
 	int cnt;
@@ -274,6 +640,7 @@ _dispatch_continuation_free_to_cache_limit(dispatch_continuation_t dc)
 		_dispatch_continuation_free_to_heap(dc);
 	} while (--cnt && (dc = next_dc));
 	_dispatch_thread_setspecific(dispatch_cache_key, next_dc);
+#endif
 }
 #endif
 
@@ -710,7 +1077,7 @@ _dispatch_async_f_slow(dispatch_queue_t dq, void *ctxt,
 		dispatch_function_t func, dispatch_block_flags_t flags,
 		uintptr_t dc_flags)
 {
-	dispatch_continuation_t dc = _dispatch_continuation_alloc_from_heap();
+	dispatch_continuation_t dc = _dispatch_continuation_alloc_slow();
 	dispatch_qos_t qos;
 
 	qos = _dispatch_continuation_init_f(dc, dq, ctxt, func, flags, dc_flags);
@@ -753,10 +1120,12 @@ _dispatch_barrier_async_detached_f(dispatch_queue_class_t dq, void *ctxt,
 void
 dispatch_barrier_async(dispatch_queue_t dq, dispatch_block_t work)
 {
-	dispatch_continuation_t dc = _dispatch_continuation_alloc();
 	uintptr_t dc_flags = DC_FLAG_CONSUME | DC_FLAG_BARRIER;
+	dispatch_continuation_t dc;
 	dispatch_qos_t qos;
 
+	dc = _dispatch_continuation_alloc_for_block(work, &dc_flags);
+
 	qos = _dispatch_continuation_init(dc, dq, work, 0, dc_flags);
 	_dispatch_continuation_async(dq, dc, qos, dc_flags);
 }
@@ -884,15 +1253,100 @@ dispatch_async_enforce_qos_class_f(dispatch_queue_t dq, void *ctxt,
 void
 dispatch_async(dispatch_queue_t dq, dispatch_block_t work)
 {
-	dispatch_continuation_t dc = _dispatch_continuation_alloc();
 	uintptr_t dc_flags = DC_FLAG_CONSUME;
+	dispatch_continuation_t dc;
 	dispatch_qos_t qos;
 
+	dc = _dispatch_continuation_alloc_for_block(work, &dc_flags);
+
 	qos = _dispatch_continuation_init(dc, dq, work, 0, dc_flags);
 	_dispatch_continuation_async(dq, dc, qos, dc->dc_flags);
 }
 #endif
 
+#pragma mark -
+#pragma mark dispatch_async_batch
+
+// Takes `count` continuations from the thread cache with a single TSD
+// round-trip, and tops up from the depot or the heap when the cache runs dry.
+// The returned list is linked through do_next and NULL terminated.
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_continuation_t
+_dispatch_continuation_alloc_batch(size_t count, dispatch_continuation_t *tail)
+{
+	dispatch_continuation_t head, dc, prev = NULL;
+	size_t n = 0;
+
+	head = dc = _dispatch_thread_getspecific(dispatch_cache_key);
+	while (dc && n < count) {
+		prev = dc;
+		dc = dc->do_next;
+		n++;
+	}
+	_dispatch_thread_setspecific(dispatch_cache_key, dc);
+	if (prev) {
+		// dc_cache_cnt counts the elements below each entry, so the new
+		// cache head keeps an accurate count
+		prev->do_next = NULL;
+	} else {
+		head = NULL;
+	}
+
+	for (; n < count; n++) {
+		// the thread cache is empty, this may refill it from the depot
+		dc = _dispatch_continuation_alloc();
+		dc->do_next = NULL;
+		if (prev) {
+			prev->do_next = dc;
+		} else {
+			head = dc;
+		}
+		prev = dc;
+	}
+	*tail = prev;
+	return head;
+}
+
+DISPATCH_NOINLINE
+void
+dispatch_async_batch_f(dispatch_queue_t dq, size_t count,
+		void *const *contexts, dispatch_function_t func)
+{
+	dispatch_continuation_t head, tail, dc;
+	uintptr_t dc_flags = DC_FLAG_CONSUME;
+	dispatch_qos_t qos = DISPATCH_QOS_UNSPECIFIED;
+	unsigned long type = dx_type(dq);
+	size_t i = 0;
+
+	if (unlikely(count <= 1 || (type != DISPATCH_QUEUE_SERIAL_TYPE &&
+			type != DISPATCH_QUEUE_CONCURRENT_TYPE &&
+			type != DISPATCH_QUEUE_GLOBAL_ROOT_TYPE &&
+			type != DISPATCH_QUEUE_PTHREAD_ROOT_TYPE))) {
+		// the main queue, workloops, ... have push functions with side
+		// effects of their own, let them see every item
+		for (; i < count; i++) {
+			_dispatch_async_f(dq, contexts[i], func, 0);
+		}
+		return;
+	}
+
+	head = _dispatch_continuation_alloc_batch(count, &tail);
+	for (dc = head; dc; dc = dc->do_next, i++) {
+		// all items are submitted from the same thread, with the same flags,
+		// so they all resolve to the same QoS
+		qos = _dispatch_continuation_init_f(dc, dq, contexts[i], func, 0,
+				dc_flags);
+		_dispatch_trace_item_push(dq, dc);
+	}
+
+	if (type & _DISPATCH_QUEUE_ROOT_TYPEFLAG) {
+		int n = count > INT_MAX ? INT_MAX : (int)count;
+		return _dispatch_root_queue_push_list(upcast(dq)._dgq, head, tail,
+				n, qos);
+	}
+	return _dispatch_lane_push_list(upcast(dq)._dl, head, tail, count, qos);
+}
+
 #pragma mark -
 #pragma mark _dispatch_sync_invoke / _dispatch_sync_complete
 
@@ -1444,6 +1898,9 @@ _dispatch_lane_drain_non_barriers(dispatch_lane_t dq,
 		if (_dispatch_object_is_waiter(dc)) {
 			_dispatch_non_barrier_waiter_redirect_or_wake(dq, dc);
 		} else {
+			if (unlikely(_dispatch_lane_is_bounded(dq))) {
+				_dispatch_lane_capacity_pop(dq, dc);
+			}
 			_dispatch_continuation_redirect_push(dq, dc,
 					_dispatch_queue_max_qos(dq));
 		}
@@ -1498,7 +1955,9 @@ _dispatch_lane_barrier_complete(dispatch_lane_class_t dqu, dispatch_qos_t qos,
 			if (_dispatch_object_is_waiter(dc)) {
 				return _dispatch_lane_drain_barrier_waiter(dq, dc, flags, 0);
 			}
-		} else if (dq->dq_width > 1 && !_dispatch_object_is_barrier(dc)) {
+		} else if (dq->dq_width > 1 && !_dispatch_object_is_barrier(dc) &&
+				likely(!_dispatch_lane_rate_limit(dq))) {
+			// rate limited lanes only start work items from a drain
 			return _dispatch_lane_drain_non_barriers(dq, dc, flags);
 		}
 
@@ -2328,33 +2787,857 @@ _dispatch_queue_get_specific_inline(dispatch_queue_t dq, const void *key)
 		if (dqs) ctxt = dqs->dqs_ctxt;
 		_dispatch_unfair_lock_unlock(&dqsh->dqsh_lock);
 	}
-	return ctxt;
+	return ctxt;
+}
+
+DISPATCH_NOINLINE
+void *
+dispatch_queue_get_specific(dispatch_queue_t dq, const void *key)
+{
+	if (unlikely(!key)) {
+		return NULL;
+	}
+	return _dispatch_queue_get_specific_inline(dq, key);
+}
+
+DISPATCH_NOINLINE
+void *
+dispatch_get_specific(const void *key)
+{
+	dispatch_queue_t dq = _dispatch_queue_get_current();
+	void *ctxt = NULL;
+
+	if (likely(key && dq)) {
+		do {
+			ctxt = _dispatch_queue_get_specific_inline(dq, key);
+			dq = dq->do_targetq;
+		} while (unlikely(ctxt == NULL && dq));
+	}
+	return ctxt;
+}
+
+#pragma mark -
+#pragma mark dispatch_lane_ext_t
+
+// Setters may race with one another on an active queue, the side data is
+// never freed before the lane is
+DISPATCH_NOINLINE
+static dispatch_lane_ext_t
+_dispatch_lane_ext_create(dispatch_lane_t dq)
+{
+	dispatch_lane_ext_t dle = os_atomic_load2o(dq, dq_ext, acquire), cur;
+
+	if (dle) {
+		return dle;
+	}
+	dle = _dispatch_calloc(1, sizeof(struct dispatch_lane_ext_s));
+	if (!os_atomic_cmpxchgv2o(dq, dq_ext, NULL, dle, &cur, release)) {
+		free(dle);
+		return cur;
+	}
+	return dle;
+}
+
+#pragma mark -
+#pragma mark dispatch_queue_set_sticky
+
+/*
+ * Serial queues marked with dispatch_queue_set_sticky() are not pushed to the
+ * list of their root queue when woken up, but to a slot of the root queue
+ * for the CPU that last drained them. Workers look at the slot of the CPU
+ * they run on before the list, so that the queue keeps finding its state in
+ * the caches of that CPU.
+ *
+ * Queues are taken from the slots of other CPUs only once they waited for
+ * DISPATCH_STICKY_STEAL_DELAY. The push pokes whichever worker comes, which
+ * is rarely the one of the CPU the queue waits for, so a worker without
+ * anything else to run sleeps until the delay expires instead of taking the
+ * queue right away, to give that CPU a chance to pick it up.
+ */
+#define DISPATCH_STICKY_STEAL_DELAY  (50 * NSEC_PER_USEC)
+
+typedef struct dispatch_sticky_slot_s {
+	struct dispatch_lane_s *volatile dss_lane;
+	uint64_t volatile dss_stamp;
+	uint8_t dss_pad[DISPATCH_CACHELINE_SIZE - sizeof(void *) -
+			sizeof(uint64_t)];
+} *dispatch_sticky_slot_t;
+
+DISPATCH_STATIC_GLOBAL(dispatch_once_t _dispatch_sticky_pred);
+// DISPATCH_ROOT_QUEUE_COUNT rows of _dispatch_sticky_ncpus slots
+static dispatch_sticky_slot_t _dispatch_sticky_slots;
+static uint32_t _dispatch_sticky_ncpus;
+static os_atomic(uint32_t) _dispatch_sticky_pending[DISPATCH_ROOT_QUEUE_COUNT];
+
+static void
+_dispatch_sticky_init(void *ctxt DISPATCH_UNUSED)
+{
+	uint32_t ncpus = dispatch_hw_config(logical_cpus);
+
+	_dispatch_sticky_ncpus = ncpus;
+	os_atomic_store(&_dispatch_sticky_slots, _dispatch_calloc(
+			DISPATCH_ROOT_QUEUE_COUNT * ncpus,
+			sizeof(struct dispatch_sticky_slot_s)), release);
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline uint32_t
+_dispatch_sticky_cpu(void)
+{
+#if defined(__linux__)
+	int cpu = sched_getcpu();
+	return cpu < 0 ? 0 : (uint32_t)cpu;
+#else
+	return (uint32_t)_dispatch_cpu_number();
+#endif
+}
+
+// Returns the row of slots of a root queue, or NULL for the root queues
+// which don't support sticky queues (pthread root queues, cooperative pools)
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_sticky_slot_t
+_dispatch_root_queue_sticky_slots(dispatch_queue_global_t rq, uint32_t *idx)
+{
+	dispatch_sticky_slot_t slots = os_atomic_load(&_dispatch_sticky_slots,
+			relaxed);
+	uint32_t i;
+
+	if (likely(!slots) || !_dispatch_is_in_root_queues_array(rq)) {
+		return NULL;
+	}
+	os_atomic_thread_fence(dependency);
+	i = (uint32_t)(rq - _dispatch_root_queues);
+	*idx = i;
+	return &slots[i * _dispatch_sticky_ncpus];
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_root_queue_sticky_probe(dispatch_queue_global_t rq)
+{
+	uint32_t idx;
+	return _dispatch_root_queue_sticky_slots(rq, &idx) &&
+			os_atomic_load(&_dispatch_sticky_pending[idx], relaxed);
+}
+
+static bool
+_dispatch_root_queue_push_sticky(dispatch_queue_global_t rq,
+		dispatch_object_t dou)
+{
+	dispatch_sticky_slot_t slots;
+	dispatch_lane_t dq = dou._dl;
+	dispatch_lane_ext_t dle;
+	uint32_t idx, cpu;
+
+	if (!_dispatch_object_has_vtable(dou) ||
+			dx_type(dq) != DISPATCH_QUEUE_SERIAL_TYPE ||
+			!(_dispatch_queue_atomic_flags(dq) & DQF_STICKY)) {
+		return false;
+	}
+	dle = os_atomic_load2o(dq, dq_ext, relaxed);
+	cpu = dle ? os_atomic_load2o(dle, dle_sticky_cpu, relaxed) : 0;
+	if (!cpu || !(slots = _dispatch_root_queue_sticky_slots(rq, &idx))) {
+		return false;
+	}
+	slots += (cpu - 1) % _dispatch_sticky_ncpus;
+	if (!os_atomic_cmpxchg2o(slots, dss_lane, NULL, dq, release)) {
+		// another sticky queue is waiting for that CPU already
+		return false;
+	}
+	os_atomic_store2o(slots, dss_stamp, _dispatch_uptime(), relaxed);
+	os_atomic_inc(&_dispatch_sticky_pending[idx], relaxed);
+	_dispatch_root_queue_poke(rq, 1, 0);
+	return true;
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline struct dispatch_object_s *
+_dispatch_root_queue_sticky_take(dispatch_sticky_slot_t dss, uint32_t idx)
+{
+	dispatch_lane_t dq = os_atomic_xchg2o(dss, dss_lane, NULL, acquire);
+	if (dq) {
+		os_atomic_dec(&_dispatch_sticky_pending[idx], relaxed);
+	}
+	return (struct dispatch_object_s *)dq;
+}
+
+// Takes the queue waiting in the slot of another CPU for the longest time,
+// if it waited long enough. Otherwise `wait_ns` is set to the time it has
+// left to wait, or 0 when no queue is waiting.
+DISPATCH_NOINLINE
+static struct dispatch_object_s *
+_dispatch_root_queue_sticky_steal(dispatch_sticky_slot_t slots, uint32_t idx,
+		uint64_t *wait_ns)
+{
+	uint64_t delay = _dispatch_time_nano2mach(DISPATCH_STICKY_STEAL_DELAY);
+	uint64_t oldest = UINT64_MAX, now;
+	dispatch_sticky_slot_t victim = NULL;
+
+	for (uint32_t i = 0; i < _dispatch_sticky_ncpus; i++) {
+		if (!os_atomic_load2o(&slots[i], dss_lane, relaxed)) continue;
+		uint64_t stamp = os_atomic_load2o(&slots[i], dss_stamp, relaxed);
+		if (stamp < oldest) {
+			oldest = stamp;
+			victim = &slots[i];
+		}
+	}
+	*wait_ns = 0;
+	if (!victim) {
+		return NULL;
+	}
+	now = _dispatch_uptime();
+	if (oldest < now && now - oldest >= delay) {
+		return _dispatch_root_queue_sticky_take(victim, idx);
+	}
+	*wait_ns = _dispatch_time_mach2nano(oldest < now ?
+			delay - (now - oldest) : delay);
+	return NULL;
+}
+
+void
+dispatch_queue_set_sticky(dispatch_queue_t dq, bool sticky)
+{
+	if (unlikely(_dispatch_object_is_global(dq) ||
+			dx_type(dq) != DISPATCH_QUEUE_SERIAL_TYPE)) {
+		DISPATCH_CLIENT_CRASH(dq, "dispatch_queue_set_sticky() called on "
+				"an object that isn't a serial queue");
+	}
+	if (sticky) {
+		dispatch_once_f(&_dispatch_sticky_pred, NULL, _dispatch_sticky_init);
+		_dispatch_lane_ext_create(upcast(dq)._dl);
+		_dispatch_queue_atomic_flags_set(dq, DQF_STICKY);
+	} else {
+		_dispatch_queue_atomic_flags_clear(dq, DQF_STICKY);
+	}
+}
+
+#pragma mark -
+#pragma mark dispatch_queue_set_capacity
+
+// Sync waiters and queues woken up onto a bounded lane don't count against
+// its capacity, and are never held back nor dropped
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_lane_capacity_counts(dispatch_object_t dou)
+{
+	if (_dispatch_object_has_vtable(dou)) {
+		return false;
+	}
+	return !_dispatch_object_is_waiter(dou);
+}
+
+// Only for bounded lanes, which then evict items rather than hold them back
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_lane_capacity_drops(dispatch_lane_t dq)
+{
+	return dq->dq_ext->dle_capacity->dqc_policy ==
+			DISPATCH_QUEUE_CAPACITY_DROP_OLDEST;
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_lane_capacity_full(dispatch_queue_capacity_t dqc)
+{
+	return os_atomic_load2o(dqc, dqc_depth, relaxed) >= dqc->dqc_limit;
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_lane_capacity_try_reserve(dispatch_queue_capacity_t dqc, size_t n)
+{
+	size_t depth = os_atomic_load2o(dqc, dqc_depth, relaxed);
+
+	do {
+		if (depth >= dqc->dqc_limit) {
+			return false;
+		}
+	} while (unlikely(!os_atomic_cmpxchgv2o(dqc, dqc_depth, depth, depth + n,
+			&depth, relaxed)));
+	return true;
+}
+
+static void
+_dispatch_lane_capacity_wait(dispatch_queue_capacity_t dqc)
+{
+	uint32_t seq = os_atomic_load2o(dqc, dqc_seq, acquire);
+
+	// pairs with the seq_cst decrement of dqc_depth in
+	// _dispatch_lane_capacity_pop(), either it sees us waiting, or we see
+	// the room it made
+	os_atomic_inc2o(dqc, dqc_waiters, seq_cst);
+	if (os_atomic_load2o(dqc, dqc_depth, seq_cst) >= dqc->dqc_limit) {
+		_dispatch_wait_on_address(&dqc->dqc_seq, seq, DISPATCH_TIME_FOREVER, 0);
+	}
+	os_atomic_dec2o(dqc, dqc_waiters, relaxed);
+}
+
+// Accounts for `n` continuations about to be pushed onto `dq`, unless its
+// policy is DISPATCH_QUEUE_CAPACITY_DROP_OLDEST. A list is admitted as a whole
+// as soon as the lane isn't full, so that a list longer than the capacity
+// can't wait forever.
+DISPATCH_NOINLINE
+static void
+_dispatch_lane_capacity_push(dispatch_lane_t dq, size_t n)
+{
+	dispatch_queue_capacity_t dqc = dq->dq_ext->dle_capacity;
+
+	if (dqc->dqc_policy == DISPATCH_QUEUE_CAPACITY_BLOCK &&
+			!_dispatch_thread_frame_find_queue(dq->_as_dq)) {
+		while (!_dispatch_lane_capacity_try_reserve(dqc, n)) {
+			_dispatch_lane_capacity_wait(dqc);
+		}
+		return;
+	}
+	// never block a thread the lane (or a queue targeting it) runs on,
+	// it would never drain
+	os_atomic_add2o(dqc, dqc_depth, n, relaxed);
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_continuation_is_droppable(dispatch_continuation_t dc)
+{
+	if (unlikely(dc->dc_func == _dispatch_deadline_invoke)) {
+		// owns an item of the dqd_heap, see _dispatch_deadline_push()
+		return false;
+	}
+	return (dc->dc_flags & (DC_FLAG_CONSUME | DC_FLAG_BARRIER |
+			DC_FLAG_GROUP_ASYNC | DC_FLAG_BLOCK_WITH_PRIVATE_DATA |
+			DC_FLAG_CHANNEL_ITEM)) == DC_FLAG_CONSUME;
+}
+
+static void
+_dispatch_continuation_drop(dispatch_lane_t dq, dispatch_function_t handler,
+		dispatch_continuation_t dc)
+{
+	uintptr_t dc_flags = dc->dc_flags;
+	void *ctxt = dc->dc_ctxt;
+
+	if (!(dc_flags & DC_FLAG_NO_INTROSPECTION)) {
+		_dispatch_trace_item_pop(dq, dc);
+		_dispatch_trace_item_complete(dc);
+	}
+	if (dc->dc_voucher && dc->dc_voucher != DISPATCH_NO_VOUCHER) {
+		_voucher_release(dc->dc_voucher);
+		dc->dc_voucher = VOUCHER_INVALID;
+	}
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+	if (dc_flags & DC_FLAG_BLOCK_INLINE) {
+		_dispatch_continuation_inline_block_dispose(dc);
+		return _dispatch_continuation_inline_free(dc);
+	}
+#endif
+	_dispatch_continuation_free(dc);
+#ifdef __BLOCKS__
+	if (dc_flags & DC_FLAG_BLOCK) {
+		return Block_release(ctxt);
+	}
+#endif /* __BLOCKS__ */
+	if (handler) {
+		_dispatch_client_callout(ctxt, handler);
+	}
+}
+
+// Placeholder pushed onto a DISPATCH_QUEUE_CAPACITY_DROP_OLDEST lane for each
+// item of its dqc_head list, see _dispatch_lane_push_drop_oldest()
+static void
+_dispatch_lane_capacity_pump(void *ctxt)
+{
+	dispatch_lane_t dq = ctxt;
+	dispatch_queue_capacity_t dqc = dq->dq_ext->dle_capacity;
+	struct dispatch_object_s *dc;
+
+	_dispatch_unfair_lock_lock(&dqc->dqc_lock);
+	dc = dqc->dqc_head;
+	dqc->dqc_head = dc->do_next;
+	if (!dqc->dqc_head) {
+		dqc->dqc_tail = NULL;
+	}
+	os_atomic_dec2o(dqc, dqc_depth, relaxed);
+	_dispatch_unfair_lock_unlock(&dqc->dqc_lock);
+
+	// adopts the priority and voucher of the item, not the placeholder's
+	_dispatch_continuation_invoke_inline(dc, 0, dq);
+}
+
+// Called by the drainer of a bounded lane for each item it dequeues
+DISPATCH_NOINLINE
+static void
+_dispatch_lane_capacity_pop(dispatch_lane_t dq, struct dispatch_object_s *dou)
+{
+	dispatch_queue_capacity_t dqc = dq->dq_ext->dle_capacity;
+
+	if (dqc->dqc_policy == DISPATCH_QUEUE_CAPACITY_DROP_OLDEST ||
+			!_dispatch_lane_capacity_counts(dou)) {
+		return;
+	}
+	os_atomic_dec2o(dqc, dqc_depth, seq_cst);
+	if (unlikely(os_atomic_load2o(dqc, dqc_waiters, seq_cst))) {
+		os_atomic_inc2o(dqc, dqc_seq, release);
+		_dispatch_wake_by_address(&dqc->dqc_seq);
+	}
+}
+
+static dispatch_queue_capacity_t
+_dispatch_queue_capacity_create(dispatch_queue_t dq)
+{
+	dispatch_lane_ext_t dle = _dispatch_lane_ext_create(upcast(dq)._dl);
+
+	if (!dle->dle_capacity) {
+		dle->dle_capacity = _dispatch_calloc(1,
+				sizeof(struct dispatch_queue_capacity_s));
+	}
+	return dle->dle_capacity;
+}
+
+void
+dispatch_queue_set_capacity(dispatch_queue_t dq, size_t capacity,
+		dispatch_queue_capacity_policy_t policy)
+{
+	unsigned long type = dx_type(dq);
+	dispatch_queue_capacity_t dqc;
+	dispatch_lane_t dl;
+
+	if (unlikely(_dispatch_object_is_global(dq) ||
+			(type != DISPATCH_QUEUE_SERIAL_TYPE &&
+			type != DISPATCH_QUEUE_CONCURRENT_TYPE))) {
+		DISPATCH_CLIENT_CRASH(type, "dispatch_queue_set_capacity() called on "
+				"an object that isn't a serial or concurrent queue");
+	}
+	if (unlikely(capacity == 0 ||
+			policy > DISPATCH_QUEUE_CAPACITY_DROP_OLDEST)) {
+		DISPATCH_CLIENT_CRASH(policy, "Invalid queue capacity or policy");
+	}
+	_dispatch_queue_setter_assert_inactive(dq);
+
+	dl = upcast(dq)._dl;
+	if (unlikely(dl->dq_items_tail)) {
+		// items pushed before now were not accounted for
+		DISPATCH_CLIENT_CRASH(dl->dq_items_tail,
+				"dispatch_queue_set_capacity() called on a non empty queue");
+	}
+	dqc = _dispatch_queue_capacity_create(dq);
+	dqc->dqc_limit = capacity;
+	dqc->dqc_policy = policy;
+	_dispatch_queue_atomic_flags_set(dq, DQF_BOUNDED);
+}
+
+void
+dispatch_queue_set_capacity_drop_handler_f(dispatch_queue_t dq,
+		dispatch_function_t handler)
+{
+	unsigned long type = dx_type(dq);
+
+	if (unlikely(_dispatch_object_is_global(dq) ||
+			(type != DISPATCH_QUEUE_SERIAL_TYPE &&
+			type != DISPATCH_QUEUE_CONCURRENT_TYPE))) {
+		DISPATCH_CLIENT_CRASH(type, "dispatch_queue_set_capacity_drop_"
+				"handler_f() called on an object that isn't a serial or "
+				"concurrent queue");
+	}
+	_dispatch_queue_setter_assert_inactive(dq);
+	_dispatch_queue_capacity_create(dq)->dqc_drop_handler = handler;
+}
+
+#pragma mark -
+#pragma mark dispatch_async_with_deadline
+
+/*
+ * Deadline queues don't reorder dq_items: work items with a deadline go in
+ * the dqd_heap, and a plain continuation is pushed onto the lane in their
+ * stead. Whenever the lane invokes one of these, it runs the work item with
+ * the earliest deadline at that time instead, so that the lane keeps its usual
+ * ordering, width and wakeup logic.
+ *
+ * Work items are regular continuations, which carry the priority, voucher
+ * and introspection identity of their submitter, and are invoked with them
+ * rather than with those of the placeholder which picked them. Placeholders
+ * carry none, and are never discarded by a DISPATCH_QUEUE_CAPACITY_DROP_OLDEST
+ * capacity, so that no item is ever left behind in the heap.
+ */
+#define DISPATCH_DEADLINE_HEAP_INIT_CAPACITY 16u
+
+typedef struct dispatch_deadline_item_s {
+	uint64_t ddi_deadline;
+	uint64_t ddi_seq;
+	dispatch_continuation_t ddi_dc;
+} *dispatch_deadline_item_t;
+
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_queue_deadline_t
+_dispatch_queue_deadline(dispatch_queue_t dq)
+{
+	unsigned long type = dx_type(dq);
+
+	if (type != DISPATCH_QUEUE_SERIAL_TYPE &&
+			type != DISPATCH_QUEUE_CONCURRENT_TYPE) {
+		return NULL;
+	}
+	dispatch_lane_ext_t dle = upcast(dq)._dl->dq_ext;
+
+	return likely(!dle) ? NULL : dle->dle_deadline;
+}
+
+// Same key as the uptime clock timer heaps use
+static uint64_t
+_dispatch_deadline_uptime(dispatch_time_t when)
+{
+	dispatch_clock_t clock;
+	uint64_t value;
+
+	if (when == DISPATCH_TIME_FOREVER) {
+		return UINT64_MAX;
+	}
+	_dispatch_time_to_clock_and_value(when, &clock, &value);
+	if (clock == DISPATCH_CLOCK_UPTIME) {
+		return value;
+	}
+	value = _dispatch_time_nano2mach(_dispatch_timeout(when));
+	return _dispatch_uptime() + value;
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_deadline_item_before(dispatch_deadline_item_t a,
+		dispatch_deadline_item_t b)
+{
+	if (a->ddi_deadline != b->ddi_deadline) {
+		return a->ddi_deadline < b->ddi_deadline;
+	}
+	return a->ddi_seq < b->ddi_seq;
+}
+
+// The heap array stays at its high-water mark until the queue is disposed
+static void
+_dispatch_deadline_heap_insert(dispatch_queue_deadline_t dqd,
+		struct dispatch_deadline_item_s ddi)
+{
+	uint32_t idx = dqd->dqd_count++;
+
+	if (unlikely(idx == dqd->dqd_capacity)) {
+		dispatch_deadline_item_t heap;
+		uint32_t capacity = dqd->dqd_capacity ? 2 * dqd->dqd_capacity :
+				DISPATCH_DEADLINE_HEAP_INIT_CAPACITY;
+
+		heap = _dispatch_calloc(capacity,
+				sizeof(struct dispatch_deadline_item_s));
+		if (dqd->dqd_heap) {
+			memcpy(heap, dqd->dqd_heap,
+					idx * sizeof(struct dispatch_deadline_item_s));
+			free(dqd->dqd_heap);
+		}
+		dqd->dqd_heap = heap;
+		dqd->dqd_capacity = capacity;
+	}
+
+	while (idx > 0) {
+		uint32_t pidx = (idx - 1) / 2;
+		if (!_dispatch_deadline_item_before(&ddi, &dqd->dqd_heap[pidx])) {
+			break;
+		}
+		dqd->dqd_heap[idx] = dqd->dqd_heap[pidx];
+		idx = pidx;
+	}
+	dqd->dqd_heap[idx] = ddi;
+}
+
+static bool
+_dispatch_deadline_heap_pop(dispatch_queue_deadline_t dqd,
+		dispatch_deadline_item_t min)
+{
+	dispatch_deadline_item_t last, heap = dqd->dqd_heap;
+	uint32_t idx = 0, cidx, count;
+
+	if (dqd->dqd_count == 0) {
+		return false;
+	}
+	*min = heap[0];
+	count = --dqd->dqd_count;
+	last = &heap[count];
+	while ((cidx = 2 * idx + 1) < count) {
+		if (cidx + 1 < count &&
+				_dispatch_deadline_item_before(&heap[cidx + 1], &heap[cidx])) {
+			cidx++;
+		}
+		if (!_dispatch_deadline_item_before(&heap[cidx], last)) {
+			break;
+		}
+		heap[idx] = heap[cidx];
+		idx = cidx;
+	}
+	heap[idx] = *last;
+	return true;
+}
+
+static void
+_dispatch_deadline_complete(dispatch_queue_deadline_t dqd, uint64_t deadline)
+{
+	uint64_t now = _dispatch_uptime(), lateness, max;
+
+	os_atomic_inc2o(dqd, dqd_executed, relaxed);
+	if (likely(now <= deadline)) {
+		return;
+	}
+	os_atomic_inc2o(dqd, dqd_missed, relaxed);
+	lateness = _dispatch_time_mach2nano(now - deadline);
+	os_atomic_rmw_loop2o(dqd, dqd_max_lateness, max, lateness, relaxed, {
+		if (max >= lateness) {
+			os_atomic_rmw_loop_give_up(return);
+		}
+	});
+}
+
+// Placeholder pushed onto a deadline lane for each item of its dqd_heap,
+// see _dispatch_deadline_push()
+static void
+_dispatch_deadline_invoke(void *ctxt)
+{
+	dispatch_lane_t dq = ctxt;
+	dispatch_queue_deadline_t dqd = dq->dq_ext->dle_deadline;
+	struct dispatch_deadline_item_s ddi;
+	bool found;
+
+	for (;;) {
+		_dispatch_unfair_lock_lock(&dqd->dqd_lock);
+		found = _dispatch_deadline_heap_pop(dqd, &ddi);
+		_dispatch_unfair_lock_unlock(&dqd->dqd_lock);
+		if (unlikely(!found)) {
+			// earlier invocations dropped expired items, ours included
+			return;
+		}
+		if (!(dqd->dqd_flags & DISPATCH_QUEUE_DEADLINE_DROP_EXPIRED) ||
+				ddi.ddi_deadline >= _dispatch_uptime() ||
+				!_dispatch_continuation_is_droppable(ddi.ddi_dc)) {
+			break;
+		}
+		os_atomic_inc2o(dqd, dqd_dropped, relaxed);
+		_dispatch_continuation_drop(dq, NULL, ddi.ddi_dc);
+	}
+
+	// adopts the priority and voucher of the item, not the placeholder's
+	_dispatch_continuation_invoke_inline(ddi.ddi_dc, 0, dq);
+	_dispatch_deadline_complete(dqd, ddi.ddi_deadline);
+}
+
+static void
+_dispatch_deadline_push(dispatch_lane_t dq, dispatch_queue_deadline_t dqd,
+		dispatch_time_t deadline, dispatch_continuation_t dc,
+		dispatch_qos_t qos)
+{
+	struct dispatch_deadline_item_s ddi = {
+		.ddi_deadline = _dispatch_deadline_uptime(deadline),
+		.ddi_dc = dc,
+	};
+	dispatch_continuation_t pump;
+
+	_dispatch_trace_item_push(dq, dc);
+	_dispatch_unfair_lock_lock(&dqd->dqd_lock);
+	ddi.ddi_seq = dqd->dqd_next_seq++;
+	_dispatch_deadline_heap_insert(dqd, ddi);
+	_dispatch_unfair_lock_unlock(&dqd->dqd_lock);
+
+	pump = _dispatch_continuation_alloc();
+	(void)_dispatch_continuation_init_f(pump, dq, dq,
+			_dispatch_deadline_invoke, DISPATCH_BLOCK_NO_VOUCHER,
+			DC_FLAG_CONSUME | DC_FLAG_NO_INTROSPECTION);
+	_dispatch_continuation_async(dq, pump, qos, pump->dc_flags);
+}
+
+// Every item has a placeholder on the lane, and lanes are only disposed of
+// once they are empty
+static void
+_dispatch_queue_deadline_dispose(dispatch_queue_deadline_t dqd)
+{
+	dispatch_assert(dqd->dqd_count == 0);
+	free(dqd->dqd_heap);
+	free(dqd);
+}
+
+void
+dispatch_queue_set_deadline_scheduling(dispatch_queue_t dq,
+		dispatch_queue_deadline_flags_t flags)
+{
+	unsigned long type = dx_type(dq);
+	dispatch_lane_ext_t dle;
+
+	if (unlikely(_dispatch_object_is_global(dq) ||
+			(type != DISPATCH_QUEUE_SERIAL_TYPE &&
+			type != DISPATCH_QUEUE_CONCURRENT_TYPE))) {
+		DISPATCH_CLIENT_CRASH(type, "dispatch_queue_set_deadline_scheduling() "
+				"called on an object that isn't a serial or concurrent queue");
+	}
+	_dispatch_queue_setter_assert_inactive(dq);
+
+	dle = _dispatch_lane_ext_create(upcast(dq)._dl);
+	if (!dle->dle_deadline) {
+		dle->dle_deadline = _dispatch_calloc(1,
+				sizeof(struct dispatch_queue_deadline_s));
+	}
+	dle->dle_deadline->dqd_flags = flags;
+}
+
+DISPATCH_NOINLINE
+void
+dispatch_async_with_deadline_f(dispatch_queue_t dq, dispatch_time_t deadline,
+		void *ctxt, dispatch_function_t func)
+{
+	dispatch_queue_deadline_t dqd = _dispatch_queue_deadline(dq);
+	dispatch_continuation_t dc;
+	dispatch_qos_t qos;
+
+	if (likely(!dqd)) {
+		return _dispatch_async_f(dq, ctxt, func, 0);
+	}
+	dc = _dispatch_continuation_alloc();
+	qos = _dispatch_continuation_init_f(dc, dq, ctxt, func, 0,
+			DC_FLAG_CONSUME);
+	_dispatch_deadline_push(upcast(dq)._dl, dqd, deadline, dc, qos);
+}
+
+#ifdef __BLOCKS__
+void
+dispatch_async_with_deadline(dispatch_queue_t dq, dispatch_time_t deadline,
+		dispatch_block_t work)
+{
+	dispatch_queue_deadline_t dqd = _dispatch_queue_deadline(dq);
+	uintptr_t dc_flags = DC_FLAG_CONSUME;
+	dispatch_continuation_t dc;
+	dispatch_qos_t qos;
+
+	if (likely(!dqd)) {
+		return dispatch_async(dq, work);
+	}
+	dc = _dispatch_continuation_alloc_for_block(work, &dc_flags);
+	qos = _dispatch_continuation_init(dc, dq, work, 0, dc_flags);
+	_dispatch_deadline_push(upcast(dq)._dl, dqd, deadline, dc, qos);
+}
+#endif
+
+void
+dispatch_queue_get_deadline_stats(dispatch_queue_t dq,
+		dispatch_queue_deadline_stats_s *stats)
+{
+	dispatch_queue_deadline_t dqd = _dispatch_queue_deadline(dq);
+
+	if (!dqd) {
+		*stats = (dispatch_queue_deadline_stats_s){ };
+		return;
+	}
+	stats->dqds_executed = os_atomic_load2o(dqd, dqd_executed, relaxed);
+	stats->dqds_missed = os_atomic_load2o(dqd, dqd_missed, relaxed);
+	stats->dqds_dropped = os_atomic_load2o(dqd, dqd_dropped, relaxed);
+	stats->dqds_max_lateness = os_atomic_load2o(dqd, dqd_max_lateness,
+			relaxed);
+}
+
+#pragma mark -
+#pragma mark dispatch_queue_set_rate_limit
+
+/*
+ * The drainer of a rate limited lane takes a token before it pops each work
+ * item counted against a capacity (see _dispatch_lane_capacity_counts()).
+ *
+ * When the bucket is empty, it arms the dqrl_timer source for the time the
+ * next token is available and gives the lane up with
+ * DISPATCH_QUEUE_WAKEUP_WAIT_FOR_EVENT, so that no thread is held while the
+ * lane waits. The lane keeps a +2 reference while parked, which the timer
+ * handler consumes when it wakes the lane up.
+ */
+static void
+_dispatch_lane_rate_limit_fire(void *ctxt)
+{
+	dispatch_lane_t dq = ctxt;
+
+	if (os_atomic_xchg2o(dq->dq_ext->dle_rate_limit, dqrl_parked, 0,
+			relaxed)) {
+		dx_wakeup(dq, 0, DISPATCH_WAKEUP_MAKE_DIRTY |
+				DISPATCH_WAKEUP_CONSUME_2);
+	}
+}
+
+DISPATCH_NOINLINE
+static void
+_dispatch_lane_rate_limit_park(dispatch_lane_t dq,
+		dispatch_queue_rate_limit_t dqrl, uint64_t when)
+{
+	if (os_atomic_xchg2o(dqrl, dqrl_parked, 1, relaxed)) {
+		// the drain lock was renewed, or the lane was woken up by an override
+		// while parked: the timer is already armed
+		return;
+	}
+	_dispatch_retain_2(dq);
+	dispatch_source_set_timer(dqrl->dqrl_timer,
+			_dispatch_clock_and_value_to_time(DISPATCH_CLOCK_UPTIME, when),
+			DISPATCH_TIME_FOREVER, 0);
 }
 
-DISPATCH_NOINLINE
-void *
-dispatch_queue_get_specific(dispatch_queue_t dq, const void *key)
+// Returns whether `dc` may be popped, and parks the lane otherwise
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_lane_rate_limit_take(dispatch_lane_t dq,
+		dispatch_queue_rate_limit_t dqrl, struct dispatch_object_s *dc)
 {
-	if (unlikely(!key)) {
-		return NULL;
+	uint64_t now, tat;
+
+	if (!_dispatch_lane_capacity_counts(dc)) {
+		return true;
 	}
-	return _dispatch_queue_get_specific_inline(dq, key);
+	now = _dispatch_uptime();
+	tat = MAX(dqrl->dqrl_tat, now);
+	if (unlikely(tat - now > dqrl->dqrl_tolerance)) {
+		_dispatch_lane_rate_limit_park(dq, dqrl, tat - dqrl->dqrl_tolerance);
+		return false;
+	}
+	dqrl->dqrl_tat = tat + dqrl->dqrl_interval;
+	return true;
 }
 
-DISPATCH_NOINLINE
-void *
-dispatch_get_specific(const void *key)
+// Parked lanes hold a reference, so the timer can't be armed anymore
+static void
+_dispatch_queue_rate_limit_dispose(dispatch_queue_rate_limit_t dqrl)
 {
-	dispatch_queue_t dq = _dispatch_queue_get_current();
-	void *ctxt = NULL;
+	dispatch_source_cancel(dqrl->dqrl_timer);
+	dispatch_release(dqrl->dqrl_timer);
+	free(dqrl);
+}
 
-	if (likely(key && dq)) {
-		do {
-			ctxt = _dispatch_queue_get_specific_inline(dq, key);
-			dq = dq->do_targetq;
-		} while (unlikely(ctxt == NULL && dq));
-	}
-	return ctxt;
+void
+dispatch_queue_set_rate_limit(dispatch_queue_t dq, size_t rate, size_t burst)
+{
+	unsigned long type = dx_type(dq);
+	dispatch_queue_rate_limit_t dqrl;
+	dispatch_lane_ext_t dle;
+	dispatch_source_t ds;
+	dispatch_lane_t dl;
+
+	if (unlikely(_dispatch_object_is_global(dq) ||
+			(type != DISPATCH_QUEUE_SERIAL_TYPE &&
+			type != DISPATCH_QUEUE_CONCURRENT_TYPE))) {
+		DISPATCH_CLIENT_CRASH(type, "dispatch_queue_set_rate_limit() called "
+				"on an object that isn't a serial or concurrent queue");
+	}
+	if (unlikely(rate == 0 || rate > NSEC_PER_SEC || burst == 0)) {
+		DISPATCH_CLIENT_CRASH(rate, "Invalid queue rate limit or burst");
+	}
+	_dispatch_queue_setter_assert_inactive(dq);
+
+	dl = upcast(dq)._dl;
+	dle = _dispatch_lane_ext_create(dl);
+	dqrl = dle->dle_rate_limit;
+	if (!dqrl) {
+		ds = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0,
+				_dispatch_get_default_queue(true));
+		dispatch_set_context(ds, dl);
+		dispatch_source_set_event_handler_f(ds,
+				_dispatch_lane_rate_limit_fire);
+		dispatch_activate(ds);
+		dqrl = _dispatch_calloc(1, sizeof(struct dispatch_queue_rate_limit_s));
+		dqrl->dqrl_timer = ds;
+		dle->dle_rate_limit = dqrl;
+	}
+	dqrl->dqrl_interval = _dispatch_time_nano2mach(NSEC_PER_SEC / rate);
+	dqrl->dqrl_tolerance = (burst - 1) * dqrl->dqrl_interval;
 }
 
 #pragma mark -
@@ -2676,7 +3959,8 @@ _dispatch_lane_create_with_target(const char *label, dispatch_queue_attr_t dqa,
 		}
 	}
 
-	if (tq && dx_type(tq) == DISPATCH_QUEUE_GLOBAL_ROOT_TYPE) {
+	if (tq && dx_type(tq) == DISPATCH_QUEUE_GLOBAL_ROOT_TYPE &&
+			!(tq->dq_priority & DISPATCH_PRIORITY_FLAG_COOPERATIVE)) {
 		// Handle discrepancies between attr and target queue, attributes win
 		// 处理 attr 和目标队列之间的差异，以 attr 为主
 		
@@ -2912,6 +4196,18 @@ _dispatch_lane_dispose(dispatch_lane_t dq, bool *allow_free)
 {
 	_dispatch_object_debug(dq, "%s", __func__);
 	_dispatch_trace_queue_dispose(dq);
+	if (unlikely(dq->dq_ext)) {
+		dispatch_lane_ext_t dle = dq->dq_ext;
+		free(dle->dle_capacity);
+		if (dle->dle_deadline) {
+			_dispatch_queue_deadline_dispose(dle->dle_deadline);
+		}
+		if (dle->dle_rate_limit) {
+			_dispatch_queue_rate_limit_dispose(dle->dle_rate_limit);
+		}
+		free(dle);
+		dq->dq_ext = NULL;
+	}
 	_dispatch_lane_class_dispose(dq, allow_free);
 }
 
@@ -3636,6 +4932,8 @@ _dispatch_lane_drain(dispatch_lane_t dq, dispatch_invoke_context_t dic,
 	dispatch_thread_frame_s dtf;
 	struct dispatch_object_s *dc = NULL, *next_dc;
 	uint64_t dq_state, owned = *owned_ptr;
+	dispatch_queue_rate_limit_t dqrl = _dispatch_lane_rate_limit(dq);
+	bool parked = false;
 
 	if (unlikely(!dq->dq_items_tail)) return NULL;
 
@@ -3698,7 +4996,15 @@ first_iteration:
 				dic->dic_barrier_waiter = dc;
 				goto out_with_barrier_waiter;
 			}
+			if (unlikely(dqrl) &&
+					!_dispatch_lane_rate_limit_take(dq, dqrl, dc)) {
+				parked = true;
+				break;
+			}
 			next_dc = _dispatch_queue_pop_head(dq, dc);
+			if (unlikely(_dispatch_lane_is_bounded(dq))) {
+				_dispatch_lane_capacity_pop(dq, dc);
+			}
 		} else {
 			if (owned == DISPATCH_QUEUE_IN_BARRIER) {
 				// we just ran barrier work items, we have to make their
@@ -3716,6 +5022,13 @@ first_iteration:
 				}
 				owned = DISPATCH_QUEUE_WIDTH_INTERVAL;
 			}
+			// only once the item is sure to be popped, so that no token is
+			// lost when the lane runs out of width
+			if (unlikely(dqrl) &&
+					!_dispatch_lane_rate_limit_take(dq, dqrl, dc)) {
+				parked = true;
+				break;
+			}
 
 			next_dc = _dispatch_queue_pop_head(dq, dc);
 			if (_dispatch_object_is_waiter(dc)) {
@@ -3723,6 +5036,9 @@ first_iteration:
 				_dispatch_non_barrier_waiter_redirect_or_wake(dq, dc);
 				continue;
 			}
+			if (unlikely(_dispatch_lane_is_bounded(dq))) {
+				_dispatch_lane_capacity_pop(dq, dc);
+			}
 
 			if (flags & DISPATCH_INVOKE_REDIRECTING_DRAIN) {
 				owned -= DISPATCH_QUEUE_WIDTH_INTERVAL;
@@ -3750,6 +5066,10 @@ first_iteration:
 	*owned_ptr &= DISPATCH_QUEUE_ENQUEUED | DISPATCH_QUEUE_ENQUEUED_ON_MGR;
 	*owned_ptr |= owned;
 	_dispatch_thread_frame_pop(&dtf);
+	if (unlikely(parked)) {
+		// the rate limit timer will wake the lane up
+		return DISPATCH_QUEUE_WAKEUP_WAIT_FOR_EVENT;
+	}
 	return dc ? dq->do_targetq : NULL;
 
 out_with_no_width:
@@ -3864,6 +5184,12 @@ _dispatch_lane_invoke2(dispatch_lane_t dq, dispatch_invoke_context_t dic,
 		return otq;
 	}
 	if (dq->dq_width == 1) {
+		dispatch_lane_ext_t dle = dq->dq_ext;
+		if (unlikely(dle) &&
+				(_dispatch_queue_atomic_flags(dq) & DQF_STICKY)) {
+			os_atomic_store2o(dle, dle_sticky_cpu, _dispatch_sticky_cpu() + 1,
+					relaxed);
+		}
 		return _dispatch_lane_serial_drain(dq, dic, flags, owned);
 	}
 	return _dispatch_lane_concurrent_drain(dq, dic, flags, owned);
@@ -4706,6 +6032,12 @@ static inline bool
 _dispatch_root_queue_push_needs_override(dispatch_queue_global_t rq,
 		dispatch_qos_t qos)
 {
+	if (rq->dq_priority & DISPATCH_PRIORITY_FLAG_COOPERATIVE) {
+		// cooperative pools are closed: overriding would move work onto
+		// the regular root queues
+		return false;
+	}
+
 	dispatch_qos_t fallback = _dispatch_priority_fallback_qos(rq->dq_priority);
 	if (fallback) {
 		return qos && qos != fallback;
@@ -5101,18 +6433,14 @@ _dispatch_lane_push_waiter(dispatch_lane_t dq, dispatch_sync_context_t dsc,
 	}
 }
 
-DISPATCH_NOINLINE
-void
-_dispatch_lane_push(dispatch_lane_t dq, dispatch_object_t dou,
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_lane_push_inline(dispatch_lane_t dq, dispatch_object_t dou,
 		dispatch_qos_t qos)
 {
 	dispatch_wakeup_flags_t flags = 0;
 	struct dispatch_object_s *prev;
 
-	if (unlikely(_dispatch_object_is_waiter(dou))) {
-		return _dispatch_lane_push_waiter(dq, dou._dsc, qos);
-	}
-
 	dispatch_assert(!_dispatch_object_is_global(dq));
 	qos = _dispatch_queue_push_qos(dq, qos);
 
@@ -5147,6 +6475,72 @@ _dispatch_lane_push(dispatch_lane_t dq, dispatch_object_t dou,
 	}
 }
 
+// DISPATCH_QUEUE_CAPACITY_DROP_OLDEST lanes keep the work items they may
+// discard out of dq_items, which only the drainer can dequeue from, so that
+// producers can evict the oldest one themselves and the memory held by the
+// lane stays bounded. A placeholder is pushed onto dq_items for each item,
+// which invokes the oldest item left when the lane dequeues it. Producers
+// which evict an item push no placeholder, so that there is always exactly
+// one per item in the dqc_head list.
+DISPATCH_NOINLINE
+static void
+_dispatch_lane_push_drop_oldest(dispatch_lane_t dq,
+		dispatch_queue_capacity_t dqc, dispatch_continuation_t dc,
+		dispatch_qos_t qos)
+{
+	struct dispatch_object_s *evicted = NULL;
+	dispatch_continuation_t pump;
+
+	if (!_dispatch_continuation_is_droppable(dc)) {
+		return _dispatch_lane_push_inline(dq, dc, qos);
+	}
+
+	dc->do_next = NULL;
+	_dispatch_unfair_lock_lock(&dqc->dqc_lock);
+	if (dqc->dqc_tail) {
+		dqc->dqc_tail->do_next = (struct dispatch_object_s *)dc;
+	} else {
+		dqc->dqc_head = (struct dispatch_object_s *)dc;
+	}
+	dqc->dqc_tail = (struct dispatch_object_s *)dc;
+	if (_dispatch_lane_capacity_full(dqc)) {
+		evicted = dqc->dqc_head;
+		dqc->dqc_head = evicted->do_next;
+	} else {
+		os_atomic_inc2o(dqc, dqc_depth, relaxed);
+	}
+	_dispatch_unfair_lock_unlock(&dqc->dqc_lock);
+
+	if (evicted) {
+		return _dispatch_continuation_drop(dq, dqc->dqc_drop_handler,
+				(dispatch_continuation_t)evicted);
+	}
+	pump = _dispatch_continuation_alloc();
+	(void)_dispatch_continuation_init_f(pump, dq, dq,
+			_dispatch_lane_capacity_pump, DISPATCH_BLOCK_NO_VOUCHER,
+			DC_FLAG_CONSUME | DC_FLAG_NO_INTROSPECTION);
+	_dispatch_lane_push_inline(dq, pump, qos);
+}
+
+DISPATCH_NOINLINE
+void
+_dispatch_lane_push(dispatch_lane_t dq, dispatch_object_t dou,
+		dispatch_qos_t qos)
+{
+	if (unlikely(_dispatch_object_is_waiter(dou))) {
+		return _dispatch_lane_push_waiter(dq, dou._dsc, qos);
+	}
+	if (unlikely(_dispatch_lane_is_bounded(dq)) &&
+			_dispatch_lane_capacity_counts(dou)) {
+		dispatch_queue_capacity_t dqc = dq->dq_ext->dle_capacity;
+		if (dqc->dqc_policy == DISPATCH_QUEUE_CAPACITY_DROP_OLDEST) {
+			return _dispatch_lane_push_drop_oldest(dq, dqc, dou._dc, qos);
+		}
+		_dispatch_lane_capacity_push(dq, 1);
+	}
+	_dispatch_lane_push_inline(dq, dou, qos);
+}
+
 DISPATCH_NOINLINE
 void
 _dispatch_lane_concurrent_push(dispatch_lane_t dq, dispatch_object_t dou,
@@ -5156,9 +6550,13 @@ _dispatch_lane_concurrent_push(dispatch_lane_t dq, dispatch_object_t dou,
 	// doesn't fail if only the ENQUEUED bit is set (unlike its barrier
 	// width equivalent), so we have to check that this thread hasn't
 	// enqueued anything ahead of this call or we can break ordering
+	//
+	// rate limited lanes only start work items from a drain, which takes
+	// their tokens
 	if (dq->dq_items_tail == NULL &&
 			!_dispatch_object_is_waiter(dou) &&
 			!_dispatch_object_is_barrier(dou) &&
+			likely(!_dispatch_lane_rate_limit(dq)) &&
 			_dispatch_queue_try_acquire_async(dq)) {
 		return _dispatch_continuation_redirect_push(dq, dou, qos);
 	}
@@ -5166,6 +6564,115 @@ _dispatch_lane_concurrent_push(dispatch_lane_t dq, dispatch_object_t dou,
 	_dispatch_lane_push(dq, dou, qos);
 }
 
+// Publishes a list of continuations linked through do_next, with the same
+// ordering and retain rules as _dispatch_lane_push(), but a single tail
+// exchange and at most one wakeup for the whole list of `n` items.
+DISPATCH_NOINLINE
+static void
+_dispatch_lane_push_list(dispatch_lane_t dq, dispatch_object_t _head,
+		dispatch_object_t _tail, size_t n, dispatch_qos_t qos)
+{
+	struct dispatch_object_s *head = _head._do, *tail = _tail._do, *prev;
+	dispatch_wakeup_flags_t flags = 0;
+
+	dispatch_assert(!_dispatch_object_is_global(dq));
+	if (unlikely(_dispatch_lane_is_bounded(dq))) {
+		if (_dispatch_lane_capacity_drops(dq)) {
+			// each item may evict an older one
+			for (; head; head = prev) {
+				prev = head->do_next;
+				_dispatch_lane_push(dq, head, qos);
+			}
+			return;
+		}
+		_dispatch_lane_capacity_push(dq, n);
+	}
+	qos = _dispatch_queue_push_qos(dq, qos);
+
+	prev = os_mpsc_push_update_tail(os_mpsc(dq, dq_items), tail, do_next);
+	if (unlikely(os_mpsc_push_was_empty(prev))) {
+		_dispatch_retain_2_unsafe(dq);
+		flags = DISPATCH_WAKEUP_CONSUME_2 | DISPATCH_WAKEUP_MAKE_DIRTY;
+	} else if (unlikely(_dispatch_queue_need_override(dq, qos))) {
+		_dispatch_retain_2_unsafe(dq);
+		flags = DISPATCH_WAKEUP_CONSUME_2;
+	}
+	os_mpsc_push_update_prev(os_mpsc(dq, dq_items), prev, head, do_next);
+	if (flags) {
+		return dx_wakeup(dq, qos, flags);
+	}
+}
+
+// The item was accounted for already, push it past the capacity check
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_lane_push_reserved(dispatch_lane_t dq, dispatch_continuation_t dc,
+		dispatch_qos_t qos)
+{
+	if (!(dc->dc_flags & DC_FLAG_NO_INTROSPECTION)) {
+		_dispatch_trace_item_push(dq, dc);
+	}
+	_dispatch_lane_push_inline(dq, dc, qos);
+}
+
+DISPATCH_NOINLINE
+bool
+dispatch_async_try_f(dispatch_queue_t dq, void *ctxt, dispatch_function_t func)
+{
+	dispatch_lane_t dl = upcast(dq)._dl;
+	dispatch_continuation_t dc;
+	dispatch_qos_t qos;
+
+	if (likely(!_dispatch_lane_is_bounded(dl))) {
+		dispatch_async_f(dq, ctxt, func);
+		return true;
+	}
+	if (_dispatch_lane_capacity_drops(dl)) {
+		if (_dispatch_lane_capacity_full(dl->dq_ext->dle_capacity)) {
+			return false;
+		}
+		dispatch_async_f(dq, ctxt, func);
+		return true;
+	}
+	if (!_dispatch_lane_capacity_try_reserve(dl->dq_ext->dle_capacity, 1)) {
+		return false;
+	}
+	dc = _dispatch_continuation_alloc();
+	qos = _dispatch_continuation_init_f(dc, dq, ctxt, func, 0, DC_FLAG_CONSUME);
+	_dispatch_lane_push_reserved(dl, dc, qos);
+	return true;
+}
+
+#ifdef __BLOCKS__
+bool
+dispatch_async_try(dispatch_queue_t dq, dispatch_block_t work)
+{
+	dispatch_lane_t dl = upcast(dq)._dl;
+	uintptr_t dc_flags = DC_FLAG_CONSUME;
+	dispatch_continuation_t dc;
+	dispatch_qos_t qos;
+
+	if (likely(!_dispatch_lane_is_bounded(dl))) {
+		dispatch_async(dq, work);
+		return true;
+	}
+	if (_dispatch_lane_capacity_drops(dl)) {
+		if (_dispatch_lane_capacity_full(dl->dq_ext->dle_capacity)) {
+			return false;
+		}
+		dispatch_async(dq, work);
+		return true;
+	}
+	if (!_dispatch_lane_capacity_try_reserve(dl->dq_ext->dle_capacity, 1)) {
+		return false;
+	}
+	dc = _dispatch_continuation_alloc_for_block(work, &dc_flags);
+	qos = _dispatch_continuation_init(dc, dq, work, 0, dc_flags);
+	_dispatch_lane_push_reserved(dl, dc, qos);
+	return true;
+}
+#endif
+
 #pragma mark -
 #pragma mark dispatch_channel_t
 
@@ -5500,7 +7007,7 @@ static void
 _dispatch_channel_enqueue_slow(dispatch_channel_t dch, void *ctxt)
 {
 	uintptr_t dc_flags = DC_FLAG_CONSUME | DC_FLAG_CHANNEL_ITEM;
-	dispatch_continuation_t dc = _dispatch_continuation_alloc_from_heap();
+	dispatch_continuation_t dc = _dispatch_continuation_alloc_slow();
 	dispatch_qos_t qos;
 
 	qos = _dispatch_continuation_init_f(dc, dch, ctxt, NULL, 0, dc_flags);
@@ -6148,7 +7655,8 @@ _dispatch_root_queue_poke_slow(dispatch_queue_global_t dq, int n, int floor)
 
 #if !DISPATCH_USE_INTERNAL_WORKQUEUE
 #if DISPATCH_USE_PTHREAD_ROOT_QUEUES
-	if (dx_type(dq) == DISPATCH_QUEUE_GLOBAL_ROOT_TYPE)
+	if (dx_type(dq) == DISPATCH_QUEUE_GLOBAL_ROOT_TYPE &&
+			!(dq->dq_priority & DISPATCH_PRIORITY_FLAG_COOPERATIVE))
 #endif
 	{
 		_dispatch_root_queue_debug("requesting new worker thread for global "
@@ -6253,12 +7761,14 @@ DISPATCH_NOINLINE
 void
 _dispatch_root_queue_poke(dispatch_queue_global_t dq, int n, int floor)
 {
-	if (!_dispatch_queue_class_probe(dq)) {
+	if (!_dispatch_queue_class_probe(dq) &&
+			likely(!_dispatch_root_queue_sticky_probe(dq))) {
 		return;
 	}
 #if !DISPATCH_USE_INTERNAL_WORKQUEUE
 #if DISPATCH_USE_PTHREAD_POOL
-	if (likely(dx_type(dq) == DISPATCH_QUEUE_GLOBAL_ROOT_TYPE))
+	if (likely(dx_type(dq) == DISPATCH_QUEUE_GLOBAL_ROOT_TYPE &&
+			!(dq->dq_priority & DISPATCH_PRIORITY_FLAG_COOPERATIVE)))
 #endif
 	{
 		if (unlikely(!os_atomic_cmpxchg2o(dq, dgq_pending, 0, n, relaxed))) {
@@ -6404,6 +7914,38 @@ out:
 	return head;
 }
 
+// Sticky queues waiting for the current CPU go first, then the sticky queues
+// of other CPUs which waited for too long, then the list. A worker left with
+// only sticky queues which didn't wait long enough sleeps until they did.
+DISPATCH_ALWAYS_INLINE_NDEBUG
+static inline struct dispatch_object_s *
+_dispatch_root_queue_drain_next(dispatch_queue_global_t dq)
+{
+	struct dispatch_object_s *item;
+	dispatch_sticky_slot_t slots;
+	uint64_t wait_ns;
+	uint32_t idx;
+
+	if (likely(!_dispatch_root_queue_sticky_probe(dq))) {
+		return _dispatch_root_queue_drain_one(dq);
+	}
+	slots = _dispatch_root_queue_sticky_slots(dq, &idx);
+	for (;;) {
+		item = _dispatch_root_queue_sticky_take(
+				&slots[_dispatch_sticky_cpu() % _dispatch_sticky_ncpus], idx);
+		if (!item) {
+			item = _dispatch_root_queue_sticky_steal(slots, idx, &wait_ns);
+		}
+		if (!item) {
+			item = _dispatch_root_queue_drain_one(dq);
+		}
+		if (item || !wait_ns) {
+			return item;
+		}
+		_dispatch_contention_usleep(wait_ns / NSEC_PER_USEC + 1);
+	}
+}
+
 #if DISPATCH_USE_KEVENT_WORKQUEUE
 static void
 _dispatch_root_queue_drain_deferred_wlh(dispatch_deferred_items_t ddi
@@ -6522,6 +8064,7 @@ _dispatch_root_queue_drain_deferred_item(dispatch_deferred_items_t ddi
 	_dispatch_queue_set_current(rq);
 	_dispatch_trace_runtime_event(worker_unpark, NULL, 0);
 
+	dispatch_introspection_drain_buffer_s didb;
 	dispatch_invoke_context_s dic = { };
 	dispatch_invoke_flags_t flags = DISPATCH_INVOKE_WORKER_DRAIN |
 			DISPATCH_INVOKE_REDIRECTING_DRAIN;
@@ -6531,7 +8074,10 @@ _dispatch_root_queue_drain_deferred_item(dispatch_deferred_items_t ddi
 	_dispatch_queue_drain_init_narrowing_check_deadline(&dic, rq->dq_priority);
 	_dispatch_init_basepri(rq->dq_priority);
 
+	_dispatch_introspection_drain_begin(&dic, &didb, rq);
 	_dispatch_continuation_pop_inline(ddi->ddi_stashed_dou, &dic, flags, rq);
+	_dispatch_group_leave_flush();
+	_dispatch_introspection_drain_end(&dic);
 
 	// event thread that could steal
 	_dispatch_perfmon_end(perfmon_thread_event_steal);
@@ -6563,20 +8109,25 @@ _dispatch_root_queue_drain(dispatch_queue_global_t dq,
 
 	struct dispatch_object_s *item;
 	bool reset = false;
+	dispatch_introspection_drain_buffer_s didb;
 	dispatch_invoke_context_s dic = { };
 #if DISPATCH_COCOA_COMPAT
 	_dispatch_last_resort_autorelease_pool_push(&dic);
 #endif // DISPATCH_COCOA_COMPAT
 	_dispatch_queue_drain_init_narrowing_check_deadline(&dic, pri);
+	_dispatch_introspection_drain_begin(&dic, &didb, dq);
 	_dispatch_perfmon_start();
-	while (likely(item = _dispatch_root_queue_drain_one(dq))) {
+	while (likely(item = _dispatch_root_queue_drain_next(dq))) {
 		if (reset) _dispatch_wqthread_override_reset();
+		_dispatch_group_leave_flush_before(item);
 		_dispatch_continuation_pop_inline(item, &dic, flags, dq);
 		reset = _dispatch_reset_basepri_override();
 		if (unlikely(_dispatch_queue_drain_should_narrow(&dic))) {
 			break;
 		}
 	}
+	_dispatch_group_leave_flush();
+	_dispatch_introspection_drain_end(&dic);
 
 	// overcommit or not. worker thread
 	if (pri & DISPATCH_PRIORITY_FLAG_OVERCOMMIT) {
@@ -6650,6 +8201,56 @@ _dispatch_root_queue_init_pthread_pool(dispatch_queue_global_t dq,
 	_dispatch_sema4_create(sema, _DSEMA4_POLICY_LIFO);
 }
 
+#if DISPATCH_USE_INTERNAL_WORKQUEUE
+static void _dispatch_cooperative_root_queues_resize_pools(int delta);
+
+// The pools of the global queues are sized after active_cpus, which changes
+// when the affinity or the CPU quota of the process is updated.
+//
+// The pool size counts the threads that can still be created, it may go
+// negative when the pool shrinks below its running threads, which then
+// won't be replaced as they exit.
+void
+_dispatch_root_queues_resize_pools(uint32_t old_cpus, uint32_t new_cpus)
+{
+	int delta = (int)new_cpus - (int)old_cpus;
+	size_t i;
+
+	for (i = 0; i < DISPATCH_ROOT_QUEUE_COUNT; i++) {
+		dispatch_queue_global_t dq = &_dispatch_root_queues[i];
+		if (dq->dq_priority & DISPATCH_PRIORITY_FLAG_OVERCOMMIT) continue;
+		os_atomic_add2o(dq, dgq_thread_pool_size, delta, relaxed);
+	}
+	if (delta > 0) {
+		// let queues that were capped pick up the new threads
+		for (i = 0; i < DISPATCH_ROOT_QUEUE_COUNT; i++) {
+			dispatch_queue_global_t dq = &_dispatch_root_queues[i];
+			if (_dispatch_queue_class_probe(dq)) {
+				_dispatch_root_queue_poke(dq, 1, 0);
+			}
+		}
+	}
+	_dispatch_cooperative_root_queues_resize_pools(delta);
+}
+#endif // DISPATCH_USE_INTERNAL_WORKQUEUE
+
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE
+#define DISPATCH_WORKER_IDLE_TIMEOUT_MEMORY_WARN (100ull * NSEC_PER_MSEC)
+#endif
+
+DISPATCH_ALWAYS_INLINE
+static inline int64_t
+_dispatch_worker_idle_timeout(int64_t timeout)
+{
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE
+	// give the stacks of idle workers back sooner under memory pressure
+	if (unlikely(_dispatch_memory_warn)) {
+		return DISPATCH_WORKER_IDLE_TIMEOUT_MEMORY_WARN;
+	}
+#endif
+	return timeout;
+}
+
 // 6618342 Contact the team that owns the Instrument DTrace probe before
 //         renaming this symbol
 static void *
@@ -6699,8 +8300,10 @@ _dispatch_worker_thread(void *context)
 	}
 
 #if DISPATCH_USE_INTERNAL_WORKQUEUE
+	// cooperative pools must not grow when their workers block
 	bool monitored = ((pri & (DISPATCH_PRIORITY_FLAG_OVERCOMMIT |
-			DISPATCH_PRIORITY_FLAG_MANAGER)) == 0);
+			DISPATCH_PRIORITY_FLAG_MANAGER |
+			DISPATCH_PRIORITY_FLAG_COOPERATIVE)) == 0);
 	if (monitored) _dispatch_workq_worker_register(dq);
 #endif
 
@@ -6710,7 +8313,7 @@ _dispatch_worker_thread(void *context)
 		_dispatch_reset_priority_and_voucher(pp, NULL);
 		_dispatch_trace_runtime_event(worker_park, NULL, 0);
 	} while (dispatch_semaphore_wait(&pqc->dpq_thread_mediator,
-			dispatch_time(0, timeout)) == 0);
+			dispatch_time(0, _dispatch_worker_idle_timeout(timeout))) == 0);
 
 #if DISPATCH_USE_INTERNAL_WORKQUEUE
 	if (monitored) _dispatch_workq_worker_unregister(dq);
@@ -6784,9 +8387,40 @@ _dispatch_root_queue_push(dispatch_queue_global_t rq, dispatch_object_t dou,
 #else
 	(void)qos;
 #endif
+	if (unlikely(os_atomic_load(&_dispatch_sticky_slots, relaxed)) &&
+			_dispatch_root_queue_push_sticky(rq, dou)) {
+		return;
+	}
 	_dispatch_root_queue_push_inline(rq, dou, dou, 1);
 }
 
+// Counterpart of _dispatch_root_queue_push() for a list of continuations
+// linked through do_next: the list is published with one tail exchange and
+// the poke asks for as many threads as there are items, up to the number of
+// CPUs, instead of one at a time.
+DISPATCH_NOINLINE
+static void
+_dispatch_root_queue_push_list(dispatch_queue_global_t rq,
+		dispatch_object_t head, dispatch_object_t tail, int n,
+		dispatch_qos_t qos)
+{
+#if HAVE_PTHREAD_WORKQUEUE_QOS
+	if (unlikely(_dispatch_root_queue_push_needs_override(rq, qos))) {
+		struct dispatch_object_s *dou = head._do, *next;
+		// overrides wrap every item individually
+		do {
+			next = dou->do_next;
+			_dispatch_root_queue_push_override(rq, dou, qos);
+		} while ((dou = next));
+		return;
+	}
+#else
+	(void)qos;
+#endif
+	int ncpus = (int)dispatch_hw_config(active_cpus);
+	_dispatch_root_queue_push_inline(rq, head, tail, n < ncpus ? n : ncpus);
+}
+
 #pragma mark -
 #pragma mark dispatch_pthread_root_queue
 #if DISPATCH_USE_PTHREAD_ROOT_QUEUES
@@ -6914,6 +8548,129 @@ _dispatch_pthread_root_queue_dispose(dispatch_queue_global_t dq,
 
 #endif // DISPATCH_USE_PTHREAD_ROOT_QUEUES
 #pragma mark -
+#pragma mark dispatch_cooperative_root_queue
+#if DISPATCH_USE_PTHREAD_POOL
+
+// Cooperative root queues are immortal pthread pools, one per QoS, sized to
+// the number of active CPUs like the global queues are: their workers are not
+// registered with the workqueue monitor and they never get overridden to
+// another root queue, so that CPU-bound work scheduled on them never
+// oversubscribes the machine. Long running work items are expected to poll
+// dispatch_cooperative_yield() instead.
+
+static struct dispatch_pthread_root_queue_context_s
+		_dispatch_cooperative_root_queue_contexts[DISPATCH_QOS_NBUCKETS];
+static dispatch_once_t
+		_dispatch_cooperative_root_queue_preds[DISPATCH_QOS_NBUCKETS];
+
+#define _DISPATCH_COOPERATIVE_ROOT_QUEUE_ENTRY(n, label) \
+	[DISPATCH_QOS_BUCKET(DISPATCH_QOS_##n)] = { \
+		DISPATCH_GLOBAL_OBJECT_HEADER(queue_global), \
+		.dq_state = DISPATCH_ROOT_QUEUE_STATE_INIT_VALUE, \
+		.do_ctxt = &_dispatch_cooperative_root_queue_contexts[ \
+				DISPATCH_QOS_BUCKET(DISPATCH_QOS_##n)], \
+		.dq_atomic_flags = DQF_WIDTH(DISPATCH_QUEUE_WIDTH_POOL), \
+		.dq_priority = DISPATCH_PRIORITY_FLAG_COOPERATIVE | \
+				_dispatch_priority_make(DISPATCH_QOS_##n, 0), \
+		.dq_label = (label), \
+	}
+
+static struct dispatch_queue_global_s
+		_dispatch_cooperative_root_queues[DISPATCH_QOS_NBUCKETS] = {
+	_DISPATCH_COOPERATIVE_ROOT_QUEUE_ENTRY(MAINTENANCE,
+			"com.apple.root.maintenance-qos.cooperative"),
+	_DISPATCH_COOPERATIVE_ROOT_QUEUE_ENTRY(BACKGROUND,
+			"com.apple.root.background-qos.cooperative"),
+	_DISPATCH_COOPERATIVE_ROOT_QUEUE_ENTRY(UTILITY,
+			"com.apple.root.utility-qos.cooperative"),
+	_DISPATCH_COOPERATIVE_ROOT_QUEUE_ENTRY(DEFAULT,
+			"com.apple.root.default-qos.cooperative"),
+	_DISPATCH_COOPERATIVE_ROOT_QUEUE_ENTRY(USER_INITIATED,
+			"com.apple.root.user-initiated-qos.cooperative"),
+	_DISPATCH_COOPERATIVE_ROOT_QUEUE_ENTRY(USER_INTERACTIVE,
+			"com.apple.root.user-interactive-qos.cooperative"),
+};
+
+static void
+_dispatch_cooperative_root_queue_init_once(void *ctxt)
+{
+	dispatch_queue_global_t dq = ctxt;
+
+	dq->dq_serialnum =
+			os_atomic_inc_orig(&_dispatch_queue_serial_numbers, relaxed);
+	_dispatch_root_queue_init_pthread_pool(dq, 0, dq->dq_priority);
+	_dispatch_object_debug(dq, "%s", __func__);
+}
+
+#if DISPATCH_USE_INTERNAL_WORKQUEUE
+// Pools which aren't initialized yet are sized after the new active_cpus
+static void
+_dispatch_cooperative_root_queues_resize_pools(int delta)
+{
+	dispatch_queue_global_t dq;
+	size_t i;
+
+	for (i = 0; i < DISPATCH_QOS_NBUCKETS; i++) {
+		if ((uintptr_t)os_atomic_load(
+				&_dispatch_cooperative_root_queue_preds[i], acquire) !=
+				DLOCK_ONCE_DONE) {
+			continue;
+		}
+		dq = &_dispatch_cooperative_root_queues[i];
+		os_atomic_add2o(dq, dgq_thread_pool_size, delta, relaxed);
+		if (delta > 0 && _dispatch_queue_class_probe(dq)) {
+			_dispatch_root_queue_poke(dq, 1, 0);
+		}
+	}
+}
+#endif // DISPATCH_USE_INTERNAL_WORKQUEUE
+
+dispatch_queue_global_t
+_dispatch_get_cooperative_root_queue(dispatch_qos_t qos)
+{
+	if (unlikely(qos < DISPATCH_QOS_MIN || qos > DISPATCH_QOS_MAX)) {
+		DISPATCH_CLIENT_CRASH(qos, "Corrupted priority");
+	}
+	size_t idx = DISPATCH_QOS_BUCKET(qos);
+	dispatch_queue_global_t dq = &_dispatch_cooperative_root_queues[idx];
+	dispatch_once_f(&_dispatch_cooperative_root_queue_preds[idx], dq,
+			_dispatch_cooperative_root_queue_init_once);
+	return dq;
+}
+
+bool
+dispatch_cooperative_yield(void)
+{
+	dispatch_queue_t dq = _dispatch_queue_get_current();
+	if (!dq) return false;
+	while (unlikely(dq->do_targetq)) {
+		dq = dq->do_targetq;
+	}
+	if (dx_type(dq) != DISPATCH_QUEUE_GLOBAL_ROOT_TYPE ||
+			!(dq->dq_priority & DISPATCH_PRIORITY_FLAG_COOPERATIVE)) {
+		return false;
+	}
+	return _dispatch_queue_class_probe(upcast(dq)._dgq);
+}
+
+#else // !DISPATCH_USE_PTHREAD_POOL
+
+dispatch_queue_global_t
+_dispatch_get_cooperative_root_queue(dispatch_qos_t qos)
+{
+	// without a pthread pool to size, the best approximation is the regular
+	// non overcommit root queue which is already bounded by the workqueue
+	return _dispatch_get_root_queue(qos, false);
+}
+
+bool
+dispatch_cooperative_yield(void)
+{
+	return false;
+}
+
+#endif // DISPATCH_USE_PTHREAD_POOL
+#pragma mark -
 #pragma mark dispatch_runloop_queue
 
 DISPATCH_STATIC_GLOBAL(bool _dispatch_program_is_probably_callback_driven);
@@ -7763,6 +9520,7 @@ libdispatch_init(void)
 	_os_object_init();
 	_voucher_init();
 	_dispatch_introspection_init();
+	_dispatch_trace_ring_init();
 }
 
 #if DISPATCH_USE_THREAD_LOCAL_STORAGE
@@ -7876,6 +9634,10 @@ _libdispatch_tsd_cleanup(void *ctx)
 	_tsd_call_cleanup(dispatch_queue_key, _dispatch_queue_cleanup);
 	_tsd_call_cleanup(dispatch_frame_key, _dispatch_frame_cleanup);
 	_tsd_call_cleanup(dispatch_cache_key, _dispatch_cache_cleanup);
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+	_tsd_call_cleanup(dispatch_inline_cache_key,
+			_dispatch_inline_cache_cleanup);
+#endif
 	_tsd_call_cleanup(dispatch_context_key, _dispatch_context_cleanup);
 	_tsd_call_cleanup(dispatch_pthread_root_queue_observer_hooks_key,
 			NULL);
@@ -7889,6 +9651,11 @@ _libdispatch_tsd_cleanup(void *ctx)
 	_tsd_call_cleanup(dispatch_voucher_key, _voucher_thread_cleanup);
 	_tsd_call_cleanup(dispatch_deferred_items_key,
 			_dispatch_deferred_items_cleanup);
+#if DISPATCH_USE_TRACE_RING
+	// last, the cleanups above may still record events
+	_tsd_call_cleanup(dispatch_trace_ring_key,
+			_dispatch_trace_ring_thread_cleanup);
+#endif
 #ifdef __ANDROID__
 	if (_dispatch_thread_detach_callback) {
 		_dispatch_thread_detach_callback();
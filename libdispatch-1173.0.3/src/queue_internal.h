@@ -46,6 +46,8 @@ DISPATCH_OPTIONS(dispatch_queue_flags, uint32_t,
 	DQF_LABEL_NEEDS_FREE    = 0x00200000, // queue label was strdup()ed
 	DQF_MUTABLE             = 0x00400000,
 	DQF_RELEASED            = 0x00800000, // xref_cnt == -1
+	DQF_STICKY              = 0x01000000, // see dispatch_queue_set_sticky()
+	DQF_BOUNDED             = 0x02000000, // see dispatch_queue_set_capacity()
 
 	//
 	// Only applies to sources
@@ -596,6 +598,7 @@ typedef struct dispatch_workloop_attr_s {
 		struct dispatch_queue_specific_head_s *dq_specific_head; \
 		struct dispatch_source_refs_s *ds_refs; \
 		struct dispatch_timer_source_refs_s *ds_timer_refs; \
+		struct dispatch_source_data_refs_s *ds_data_refs; \
 		struct dispatch_mach_recv_refs_s *dm_recv_refs; \
 		struct dispatch_channel_callbacks_s const *dch_callbacks; \
 	}; \
@@ -626,9 +629,63 @@ struct dispatch_workloop_s {
 
 typedef struct dispatch_lane_s {
 	DISPATCH_LANE_CLASS_HEADER(lane);
-	/* 32bit hole on LP64 */
+	struct dispatch_lane_ext_s *volatile dq_ext;
 } DISPATCH_ATOMIC64_ALIGN *dispatch_lane_t;
 
+// Side data of the lane features few queues use, allocated by the first of
+// their setters called on the lane, see _dispatch_lane_ext_create()
+typedef struct dispatch_lane_ext_s {
+	uint32_t volatile dle_sticky_cpu; // 1 + CPU which last drained the lane
+	struct dispatch_queue_capacity_s *dle_capacity; // only if DQF_BOUNDED
+	struct dispatch_queue_deadline_s *dle_deadline;
+	struct dispatch_queue_rate_limit_s *dle_rate_limit;
+} *dispatch_lane_ext_t;
+
+// dqc_depth counts the continuations sitting in dq_items, producers blocked
+// by DISPATCH_QUEUE_CAPACITY_BLOCK wait for dqc_seq to change.
+//
+// DISPATCH_QUEUE_CAPACITY_DROP_OLDEST lanes keep the work items they may
+// discard in the dqc_head/dqc_tail list instead, and dqc_depth counts them
+// under dqc_lock.
+typedef struct dispatch_queue_capacity_s {
+	size_t volatile dqc_depth;
+	size_t dqc_limit;
+	dispatch_queue_capacity_policy_t dqc_policy;
+	uint32_t volatile dqc_waiters;
+	uint32_t volatile dqc_seq;
+	dispatch_unfair_lock_s dqc_lock;
+	struct dispatch_object_s *dqc_head;
+	struct dispatch_object_s *dqc_tail;
+	dispatch_function_t dqc_drop_handler;
+} *dispatch_queue_capacity_t;
+
+// dqd_heap is a min-heap of the pending work items of a deadline queue, keyed
+// by their deadline on the uptime clock, then their submission order
+typedef struct dispatch_queue_deadline_s {
+	dispatch_unfair_lock_s dqd_lock;
+	uint32_t dqd_count;
+	uint32_t dqd_capacity;
+	dispatch_queue_deadline_flags_t dqd_flags;
+	uint64_t dqd_next_seq;
+	struct dispatch_deadline_item_s *dqd_heap;
+	uint64_t volatile dqd_executed;
+	uint64_t volatile dqd_missed;
+	uint64_t volatile dqd_dropped;
+	uint64_t volatile dqd_max_lateness;
+} *dispatch_queue_deadline_t;
+
+// Token bucket of a rate limited lane, kept as the theoretical arrival time
+// of its next work item (GCRA): an item may start once the uptime clock
+// reaches dqrl_tat - dqrl_tolerance, and moves dqrl_tat dqrl_interval later.
+// Only the drainer of the lane updates dqrl_tat.
+typedef struct dispatch_queue_rate_limit_s {
+	uint64_t dqrl_interval;
+	uint64_t dqrl_tolerance;
+	uint64_t dqrl_tat;
+	dispatch_source_t dqrl_timer;
+	uint32_t volatile dqrl_parked;
+} *dispatch_queue_rate_limit_t;
+
 
 // Cache aligned type for static queues (main queue, manager)
 struct dispatch_queue_static_s {
@@ -820,9 +877,13 @@ void _dispatch_root_queue_wakeup(dispatch_queue_global_t dq, dispatch_qos_t qos,
 		dispatch_wakeup_flags_t flags);
 void _dispatch_root_queue_push(dispatch_queue_global_t dq,
 		dispatch_object_t dou, dispatch_qos_t qos);
+dispatch_queue_global_t _dispatch_get_cooperative_root_queue(dispatch_qos_t qos);
 #if DISPATCH_USE_KEVENT_WORKQUEUE
 void _dispatch_kevent_workqueue_init(void);
 #endif
+#if DISPATCH_USE_INTERNAL_WORKQUEUE
+void _dispatch_root_queues_resize_pools(uint32_t old_cpus, uint32_t new_cpus);
+#endif
 #if DISPATCH_USE_PTHREAD_ROOT_QUEUES
 void _dispatch_pthread_root_queue_dispose(dispatch_lane_class_t dq,
 		bool *allow_free);
@@ -1054,6 +1115,8 @@ dispatch_queue_attr_info_t _dispatch_queue_attr_to_info(dispatch_queue_attr_t);
 #define DC_FLAG_NO_INTROSPECTION		0x200ul
 // The item is a channel item, not a continuation
 #define DC_FLAG_CHANNEL_ITEM			0x400ul
+// the block is copied in the continuation itself (dc_ctxt points into it)
+#define DC_FLAG_BLOCK_INLINE			0x800ul
 
 typedef struct dispatch_continuation_s {
 	DISPATCH_CONTINUATION_HEADER(continuation);
@@ -1062,6 +1125,24 @@ typedef struct dispatch_continuation_s {
 dispatch_assert_aliases(dispatch_continuation_s, dispatch_object_s, do_next);
 dispatch_assert_aliases(dispatch_continuation_s, dispatch_object_s, do_vtable);
 
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+// A continuation twice the regular size, with the copy of a small block in
+// its second half. It has its own thread caches and depot since it isn't
+// interchangeable with regular continuations.
+#define DISPATCH_CONTINUATION_INLINE_SIZE (2 * DISPATCH_CONTINUATION_SIZE)
+#define DISPATCH_CONTINUATION_INLINE_BLOCK_SIZE \
+		(DISPATCH_CONTINUATION_INLINE_SIZE - \
+		sizeof(struct dispatch_continuation_s))
+
+typedef struct dispatch_continuation_inline_s {
+	struct dispatch_continuation_s dci_dc;
+	uint8_t dci_block[DISPATCH_CONTINUATION_INLINE_BLOCK_SIZE];
+} *dispatch_continuation_inline_t;
+
+dispatch_static_assert(offsetof(struct dispatch_continuation_inline_s,
+		dci_block) % 16 == 0, "block copies need malloc alignment");
+#endif // DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+
 typedef struct dispatch_sync_context_s {
 	struct dispatch_continuation_s _as_dc[0];
 	DISPATCH_CONTINUATION_HEADER(continuation);
@@ -1097,6 +1178,17 @@ typedef struct dispatch_continuation_vtable_s {
 #endif
 #endif
 
+#ifndef DISPATCH_CONTINUATION_INLINE_CACHE_LIMIT
+#define DISPATCH_CONTINUATION_INLINE_CACHE_LIMIT 128
+#endif
+
+#ifndef DISPATCH_CONTINUATION_DEPOT_BATCH
+#define DISPATCH_CONTINUATION_DEPOT_BATCH 32
+#endif
+#ifndef DISPATCH_CONTINUATION_DEPOT_SLOTS
+#define DISPATCH_CONTINUATION_DEPOT_SLOTS 64u
+#endif
+
 dispatch_continuation_t _dispatch_continuation_alloc_from_heap(void);
 void _dispatch_continuation_free_to_heap(dispatch_continuation_t c);
 void _dispatch_continuation_pop(dispatch_object_t dou,
@@ -1105,12 +1197,29 @@ void _dispatch_continuation_pop(dispatch_object_t dou,
 
 #if DISPATCH_USE_MEMORYPRESSURE_SOURCE
 extern int _dispatch_continuation_cache_limit;
-void _dispatch_continuation_free_to_cache_limit(dispatch_continuation_t c);
 #else
 #define _dispatch_continuation_cache_limit DISPATCH_CONTINUATION_CACHE_LIMIT
+#endif
+#if DISPATCH_USE_MEMORYPRESSURE_SOURCE || DISPATCH_USE_CONTINUATION_DEPOT
+void _dispatch_continuation_free_to_cache_limit(dispatch_continuation_t c);
+#else
 #define _dispatch_continuation_free_to_cache_limit(c) \
 		_dispatch_continuation_free_to_heap(c)
 #endif
+#if DISPATCH_USE_CONTINUATION_DEPOT
+// must only be called when the thread cache is empty
+dispatch_continuation_t _dispatch_continuation_alloc_slow(void);
+void _dispatch_continuation_depot_trim(void);
+#else
+#define _dispatch_continuation_alloc_slow() \
+		_dispatch_continuation_alloc_from_heap()
+#define _dispatch_continuation_depot_trim() ((void)0)
+#endif
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+// must only be called when the thread cache is empty
+dispatch_continuation_t _dispatch_continuation_inline_alloc_slow(void);
+void _dispatch_continuation_inline_free_slow(dispatch_continuation_t dc);
+#endif
 
 #pragma mark -
 #pragma mark dispatch_continuation vtables
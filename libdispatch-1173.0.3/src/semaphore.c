@@ -233,6 +233,14 @@ _dispatch_group_create_and_enter(void)
 	return _dispatch_group_create_with_count(1);
 }
 
+dispatch_group_t
+dispatch_group_create_batched(void)
+{
+	dispatch_group_t dg = _dispatch_group_create_with_count(0);
+	dg->dg_batched = true;
+	return dg;
+}
+
 //销毁
 void
 _dispatch_group_dispose(dispatch_object_t dou, DISPATCH_UNUSED bool *allow_free)
@@ -381,19 +389,20 @@ _dispatch_group_wake(dispatch_group_t dg, uint64_t dg_state, bool needs_release)
 	if (refs) _dispatch_release_n(dg, refs);
 }
 
-//手动指示dispatch_group中的一个关联block已完成，或者说是一个block已解除关联。
-//调用此函数表示一个关联 block 已完成，并且已通过 dispatch_group_async 以外的方式与 dispatch_group 解除了关联。
-void
-dispatch_group_leave(dispatch_group_t dg)
+//手动指示dispatch_group中的n个关联block已完成，或者说是n个block已解除关联。
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_group_leave_n(dispatch_group_t dg, uint32_t n)
 {
 	// The value is incremented on a 64bits wide atomic so that the carry for
-	// the -1 -> 0 transition increments the generation atomically.
+	// the -n -> 0 transition increments the generation atomically.
 	// 以原子方式增加 dg_state 的值，dg_bits 的内存空间是 dg_state 的低 32 bit，
 	// 所以 dg_state + DISPATCH_GROUP_VALUE_INTERVAL 没有进位到 33 bit 时都可以理解为是 dg_bits + DISPATCH_GROUP_VALUE_INTERVAL。
 
 	//（这里注意是把 dg_state 的旧值同时赋值给了 new_state 和 old_state 两个变量）
+	uint64_t interval = n * DISPATCH_GROUP_VALUE_INTERVAL;
 	uint64_t new_state, old_state = os_atomic_add_orig2o(dg, dg_state,
-			DISPATCH_GROUP_VALUE_INTERVAL, release);
+			interval, release);
 	
 	// #define DISPATCH_GROUP_VALUE_MASK   0x00000000fffffffcULL ➡️ 0b0000...11111100ULL
 	// #define DISPATCH_GROUP_VALUE_1   DISPATCH_GROUP_VALUE_MASK
@@ -409,8 +418,9 @@ dispatch_group_leave(dispatch_group_t dg)
 	// old_state 是 0x00000000fffffffcULL，DISPATCH_GROUP_VALUE_INTERVAL 的值是 0x0000000000000004ULL
 	// 所以这里 old_state 是 uint64_t 类型，加 DISPATCH_GROUP_VALUE_INTERVAL 后不会发生溢出会产生正常的进位，old_state = 0x0000000100000000ULL
 
-	if (unlikely(old_value == DISPATCH_GROUP_VALUE_1)) {
-		old_state += DISPATCH_GROUP_VALUE_INTERVAL;
+	// 即 n 为 1 时的 DISPATCH_GROUP_VALUE_1
+	if (unlikely(old_value == (uint32_t)(-interval & DISPATCH_GROUP_VALUE_MASK))) {
+		old_state += interval;
 		do {
 			/// new_state = 0x0000000100000000ULL
 			new_state = old_state;
@@ -452,12 +462,71 @@ dispatch_group_leave(dispatch_group_t dg)
 	// 如果 old_value 为 0，而上面又进行了一个 dg_state + DISPATCH_GROUP_VALUE_INTERVAL 操作，此时就过度 leave 了，则 crash，
 	// 例如创建好一个 dispatch_group 后直接调用 dispatch_group_leave 函数即会触发这个 crash。
 
-	if (unlikely(old_value == 0)) {
+	if (unlikely(_dg_state_value(old_state) < n)) {
 		DISPATCH_CLIENT_CRASH((uintptr_t)old_value,
 				"Unbalanced call to dispatch_group_leave()");
 	}
 }
 
+//手动指示dispatch_group中的一个关联block已完成，或者说是一个block已解除关联。
+//调用此函数表示一个关联 block 已完成，并且已通过 dispatch_group_async 以外的方式与 dispatch_group 解除了关联。
+void
+dispatch_group_leave(dispatch_group_t dg)
+{
+	_dispatch_group_leave_n(dg, 1);
+}
+
+void
+dispatch_group_leave_n(dispatch_group_t dg, size_t n)
+{
+	if (unlikely(n > DISPATCH_GROUP_VALUE_MASK >> 2)) {
+		DISPATCH_CLIENT_CRASH(n, "Unbalanced call to dispatch_group_leave()");
+	}
+	if (n) _dispatch_group_leave_n(dg, (uint32_t)n);
+}
+
+#if DISPATCH_USE_GROUP_LEAVE_BATCHING
+DISPATCH_NOINLINE
+void
+_dispatch_group_leave_flush(void)
+{
+	dispatch_group_t dg = _dispatch_thread_getspecific(dispatch_group_leave_key);
+	uintptr_t count;
+
+	if (dg) {
+		count = (uintptr_t)_dispatch_thread_getspecific(
+				dispatch_group_leave_count_key);
+		_dispatch_thread_setspecific(dispatch_group_leave_key, NULL);
+		_dispatch_thread_setspecific(dispatch_group_leave_count_key, NULL);
+		_dispatch_group_leave_n(dg, (uint32_t)count);
+	}
+}
+
+DISPATCH_NOINLINE
+void
+_dispatch_group_leave_deferred(dispatch_group_t dg)
+{
+	dispatch_group_t pending;
+	uintptr_t count = 0;
+
+	pending = _dispatch_thread_getspecific(dispatch_group_leave_key);
+	if (likely(pending == dg)) {
+		count = (uintptr_t)_dispatch_thread_getspecific(
+				dispatch_group_leave_count_key);
+	} else if (pending) {
+		_dispatch_group_leave_flush();
+	}
+	if (unlikely(++count == DISPATCH_GROUP_LEAVE_BATCH)) {
+		_dispatch_thread_setspecific(dispatch_group_leave_key, NULL);
+		_dispatch_thread_setspecific(dispatch_group_leave_count_key, NULL);
+		return _dispatch_group_leave_n(dg, (uint32_t)count);
+	}
+	_dispatch_thread_setspecific(dispatch_group_leave_key, dg);
+	_dispatch_thread_setspecific(dispatch_group_leave_count_key,
+			(void *)count);
+}
+#endif // DISPATCH_USE_GROUP_LEAVE_BATCHING
+
 //手动标识要执行一个任务块
 //表示一个block与dispatch_group关联，同时block执行完后要调用dispatch_group_leave表示解除关联，否则dispatch_group_s会永远等下去。
 void
@@ -503,6 +572,31 @@ dispatch_group_enter(dispatch_group_t dg)
 	}
 }
 
+void
+dispatch_group_enter_n(dispatch_group_t dg, size_t n)
+{
+	const uint32_t max = DISPATCH_GROUP_VALUE_MASK >> 2;
+	uint32_t old_bits;
+
+	if (unlikely(n > max)) {
+		DISPATCH_CLIENT_CRASH(n,
+				"Too many nested calls to dispatch_group_enter()");
+	}
+	if (unlikely(n == 0)) {
+		return;
+	}
+	// same as dispatch_group_enter(), n intervals at once
+	old_bits = os_atomic_sub_orig2o(dg, dg_bits,
+			(uint32_t)n * DISPATCH_GROUP_VALUE_INTERVAL, acquire);
+	if (unlikely((old_bits & DISPATCH_GROUP_VALUE_MASK) == 0)) {
+		_dispatch_retain(dg); // <rdar://problem/22318411>
+	}
+	if (unlikely(_dg_state_value(old_bits) > max - n)) {
+		DISPATCH_CLIENT_CRASH(old_bits,
+				"Too many nested calls to dispatch_group_enter()");
+	}
+}
+
 DISPATCH_ALWAYS_INLINE
 static inline void
 _dispatch_group_notify(dispatch_group_t dg, dispatch_queue_t dq,
@@ -639,10 +733,12 @@ dispatch_group_async(dispatch_group_t dg, dispatch_queue_t dq,
 {
 	//把入参 block db 封装成 dispatch_continuation_t  dc 的过程中，会把 dc_flags 设置为 DC_FLAG_CONSUME | DC_FLAG_GROUP_ASYNC，这里的 DC_FLAG_GROUP_ASYNC 标志关系到 dc 执行的时候调用的具体函数（这里的提交的任务的 block 和 dispatch_group 关联的点就在这里，dc 执行时会调用 _dispatch_continuation_with_group_invoke(dc)，而我们日常使用的 dispatch_async 函数提交的异步任务的 block 执行的时候调用的是 _dispatch_client_callout(dc->dc_ctxt, dc->dc_func) 函数，它们正是根据 dc_flags 中的 DC_FLAG_GROUP_ASYNC
 
-	// 从缓存中取一个 dispatch_continuation_t 或者新建一个 dispatch_continuation_t 返回赋值给 dc。
-	dispatch_continuation_t dc = _dispatch_continuation_alloc();
 	// 这里的 DC_FLAG_GROUP_ASYNC 的标记很重要，是它标记了 dispatch_continuation 中的函数异步执行时具体调用哪个函数。
 	uintptr_t dc_flags = DC_FLAG_CONSUME | DC_FLAG_GROUP_ASYNC;
+	// 从缓存中取一个 dispatch_continuation_t 或者新建一个 dispatch_continuation_t 返回赋值给 dc。
+	// 小的栈上 block 会直接拷贝进 dc 里（DC_FLAG_BLOCK_INLINE），省掉一次 _Block_copy 分配。
+	dispatch_continuation_t dc =
+			_dispatch_continuation_alloc_for_block(db, &dc_flags);
 	// 优先级
 	dispatch_qos_t qos;
 	// 配置 dsn，（db block 转换为函数）
@@ -103,8 +103,27 @@ struct dispatch_group_s {
 	//把所有的notify回调block存进链表中
 	struct dispatch_continuation_s *volatile dg_notify_head; //链表头
 	struct dispatch_continuation_s *volatile dg_notify_tail; //链表尾
+	bool dg_batched; // see dispatch_group_create_batched()
 };
 
+/*
+ * Batched leaves
+ *
+ * Worker threads draining a root queue don't leave a batched group right
+ * away when they complete one of its dispatch_group_async() items: they
+ * count the leave in their TSD, and apply the whole count with a single
+ * atomic add once it reaches DISPATCH_GROUP_LEAVE_BATCH, or before they run
+ * anything that isn't another item of that same group, or when the drain
+ * ends (_dispatch_group_leave_flush()).
+ *
+ * Deferred leaves are thus only ever held while another item of the group
+ * is running on the same thread, which holds the group above 0 on its own:
+ * waiters and notifications can't observe the count reaching 0 any later
+ * than with immediate leaves, beyond the time it takes the thread to dequeue
+ * its next item.
+ */
+#define DISPATCH_GROUP_LEAVE_BATCH      64
+
 DISPATCH_ALWAYS_INLINE
 static inline uint32_t
 _dg_state_value(uint64_t dg_state)
@@ -124,6 +143,12 @@ void _dispatch_group_dispose(dispatch_object_t dou, bool *allow_free);
 DISPATCH_COLD
 size_t _dispatch_group_debug(dispatch_object_t dou, char *buf,
 		size_t bufsiz);
+#if DISPATCH_USE_GROUP_LEAVE_BATCHING
+void _dispatch_group_leave_deferred(dispatch_group_t dg);
+void _dispatch_group_leave_flush(void);
+#else
+#define _dispatch_group_leave_flush() ((void)0)
+#endif
 
 void _dispatch_semaphore_dispose(dispatch_object_t dou, bool *allow_free);
 DISPATCH_COLD
@@ -33,3 +33,191 @@ size_t strlcpy(char *dst, const char *src, size_t size)
 	return res;
 }
 #endif
+
+#if defined(__linux__) && !DISPATCH_HAVE_HW_CONFIG_COMMPAGE
+#pragma mark -
+#pragma mark cgroup CPU quota
+
+// Reads the first line of a small file, returns false if it can't
+static bool
+_dispatch_hw_read_line(const char *path, char *buf, size_t size)
+{
+	ssize_t n;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0) {
+		return false;
+	}
+	n = read(fd, buf, size - 1);
+	close(fd);
+	if (n <= 0) {
+		return false;
+	}
+	buf[n] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return true;
+}
+
+static uint32_t
+_dispatch_hw_quota_to_cpus(unsigned long long quota, unsigned long long period)
+{
+	// a quota of 1.5 CPUs still lets two threads run part of the time
+	unsigned long long cpus = period ? (quota + period - 1) / period : 0;
+	return cpus > UINT32_MAX ? UINT32_MAX : (uint32_t)(cpus ?: 1);
+}
+
+// Quota of a single cgroup, 0 if it has none
+static uint32_t
+_dispatch_hw_cgroup_dir_cpu_limit(const char *dir, bool v2)
+{
+	char path[PATH_MAX], buf[64];
+	unsigned long long quota, period;
+	long long q;
+
+	if (v2) {
+		// "$MAX $PERIOD", with "max" for no limit
+		snprintf(path, sizeof(path), "/sys/fs/cgroup%s/cpu.max", dir);
+		if (!_dispatch_hw_read_line(path, buf, sizeof(buf)) ||
+				sscanf(buf, "%llu %llu", &quota, &period) != 2) {
+			return 0;
+		}
+		return _dispatch_hw_quota_to_cpus(quota, period);
+	}
+
+	// cpu.cfs_quota_us is -1 for no limit
+	snprintf(path, sizeof(path), "/sys/fs/cgroup/cpu%s/cpu.cfs_quota_us", dir);
+	if (!_dispatch_hw_read_line(path, buf, sizeof(buf)) ||
+			sscanf(buf, "%lld", &q) != 1 || q <= 0) {
+		return 0;
+	}
+	snprintf(path, sizeof(path), "/sys/fs/cgroup/cpu%s/cpu.cfs_period_us", dir);
+	if (!_dispatch_hw_read_line(path, buf, sizeof(buf)) ||
+			sscanf(buf, "%llu", &period) != 1) {
+		return 0;
+	}
+	return _dispatch_hw_quota_to_cpus((unsigned long long)q, period);
+}
+
+#define DISPATCH_HW_CGROUP_DIRS_MAX 16
+
+// The cgroups of the process and those of their ancestors which have a CPU
+// quota file are looked up once, as the process isn't expected to move to
+// another cgroup: the monitor then only reads their quota files when it
+// re-evaluates active_cpus.
+static struct {
+	uint32_t count;
+	struct {
+		bool v2;
+		char *dir;
+	} dirs[DISPATCH_HW_CGROUP_DIRS_MAX];
+} _dispatch_hw_cgroup_dirs;
+static dispatch_once_t _dispatch_hw_cgroup_dirs_pred;
+
+static bool
+_dispatch_hw_cgroup_dir_has_cpu(const char *dir, bool v2)
+{
+	char path[PATH_MAX];
+
+	if (v2) {
+		snprintf(path, sizeof(path), "/sys/fs/cgroup%s/cpu.max", dir);
+	} else {
+		snprintf(path, sizeof(path), "/sys/fs/cgroup/cpu%s/cpu.cfs_quota_us",
+				dir);
+	}
+	return access(path, R_OK) == 0;
+}
+
+// Without a cgroup namespace, /proc/self/cgroup shows the path of the
+// cgroup on the host while containers often mount their own cgroup as the
+// root of /sys/fs/cgroup: walking up to the root covers both cases.
+static void
+_dispatch_hw_cgroup_dirs_add(char *dir, bool v2)
+{
+	uint32_t i;
+	char *slash;
+
+	for (;;) {
+		i = _dispatch_hw_cgroup_dirs.count;
+		if (i < DISPATCH_HW_CGROUP_DIRS_MAX &&
+				_dispatch_hw_cgroup_dir_has_cpu(dir, v2)) {
+			_dispatch_hw_cgroup_dirs.dirs[i].v2 = v2;
+			_dispatch_hw_cgroup_dirs.dirs[i].dir = strdup(dir);
+			if (_dispatch_hw_cgroup_dirs.dirs[i].dir) {
+				_dispatch_hw_cgroup_dirs.count = i + 1;
+			}
+		}
+		if (strcmp(dir, "/") == 0 || !(slash = strrchr(dir, '/'))) {
+			return;
+		}
+		if (slash == dir) {
+			slash[1] = '\0';
+		} else {
+			slash[0] = '\0';
+		}
+	}
+}
+
+static bool
+_dispatch_hw_cgroup1_has_cpu(char *controllers)
+{
+	char *ctrl, *last;
+
+	for (ctrl = strtok_r(controllers, ",", &last); ctrl;
+			ctrl = strtok_r(NULL, ",", &last)) {
+		if (strcmp(ctrl, "cpu") == 0) return true;
+	}
+	return false;
+}
+
+static void
+_dispatch_hw_cgroup_dirs_init(void *ctxt DISPATCH_UNUSED)
+{
+	char line[PATH_MAX + 64], *controllers, *dir;
+	FILE *f = fopen("/proc/self/cgroup", "re");
+
+	if (!f) {
+		return;
+	}
+	// "$ID:$CONTROLLERS:$PATH", with empty controllers for cgroup v2
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\n")] = '\0';
+		if (!(controllers = strchr(line, ':')) ||
+				!(dir = strchr(++controllers, ':'))) {
+			continue;
+		}
+		*dir++ = '\0';
+		if (*dir != '/') {
+			continue;
+		}
+		if (*controllers == '\0') {
+			_dispatch_hw_cgroup_dirs_add(dir, true);
+		} else if (_dispatch_hw_cgroup1_has_cpu(controllers)) {
+			_dispatch_hw_cgroup_dirs_add(dir, false);
+		}
+	}
+	fclose(f);
+}
+
+uint32_t
+_dispatch_hw_cgroup_cpu_limit(void)
+{
+	uint32_t limit = 0, cpus, i;
+
+	dispatch_once_f(&_dispatch_hw_cgroup_dirs_pred, NULL,
+			_dispatch_hw_cgroup_dirs_init);
+	for (i = 0; i < _dispatch_hw_cgroup_dirs.count; i++) {
+		cpus = _dispatch_hw_cgroup_dir_cpu_limit(
+				_dispatch_hw_cgroup_dirs.dirs[i].dir,
+				_dispatch_hw_cgroup_dirs.dirs[i].v2);
+		if (cpus && (!limit || cpus < limit)) limit = cpus;
+	}
+	return limit;
+}
+
+uint32_t
+_dispatch_hw_config_refresh_active_cpus(void)
+{
+	uint32_t cpus = _dispatch_hw_get_config(_dispatch_hw_config_active_cpus);
+	return os_atomic_xchg(&_dispatch_hw_config.active_cpus, cpus, relaxed);
+}
+#endif // defined(__linux__) && !DISPATCH_HAVE_HW_CONFIG_COMMPAGE
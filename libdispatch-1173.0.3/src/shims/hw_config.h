@@ -97,6 +97,13 @@ extern struct _dispatch_hw_configs_s {
 #define DISPATCH_HW_CONFIG() struct _dispatch_hw_configs_s _dispatch_hw_config
 #define dispatch_hw_config(c) (_dispatch_hw_config.c)
 
+#if defined(__linux__)
+// CPUs worth of quota granted by the cgroups of the process, 0 if unlimited
+uint32_t _dispatch_hw_cgroup_cpu_limit(void);
+// Updates active_cpus to the current affinity and quota, returns the old one
+uint32_t _dispatch_hw_config_refresh_active_cpus(void);
+#endif
+
 DISPATCH_ALWAYS_INLINE
 static inline uint32_t
 _dispatch_hw_get_config(_dispatch_hw_config_t c)
@@ -109,15 +116,21 @@ _dispatch_hw_get_config(_dispatch_hw_config_t c)
 		return (uint32_t)sysconf(_SC_NPROCESSORS_CONF);
 	case _dispatch_hw_config_active_cpus:
 		{
+			uint32_t limit = _dispatch_hw_cgroup_cpu_limit();
+			val = 0;
 #ifdef __USE_GNU
 			// Prefer pthread_getaffinity_np because it considers
 			// scheduler cpu affinity.  This matters if the program
 			// is restricted to a subset of the online cpus (eg via numactl).
 			cpu_set_t cpuset;
 			if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) == 0)
-				return (uint32_t)CPU_COUNT(&cpuset);
+				val = (uint32_t)CPU_COUNT(&cpuset);
 #endif
-			return (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+			if (val == 0) val = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+			// a container limited to a CPU quota still sees every CPU of the
+			// host in its affinity mask
+			if (limit && limit < val) val = limit;
+			return val ? val : 1;
 		}
 	}
 #elif defined(_WIN32)
@@ -635,6 +635,64 @@ _dispatch_unfair_lock_unlock_slow(dispatch_unfair_lock_t dul, dispatch_lock cur)
 #endif
 }
 
+#pragma mark - once quiescence
+#if DISPATCH_ONCE_USE_QUIESCENT_COUNTER && defined(__linux__)
+#include <linux/membarrier.h>
+
+uintptr_t volatile _dispatch_once_quiescent_counter;
+
+#define DISPATCH_MEMBARRIER_UNKNOWN		0
+#define DISPATCH_MEMBARRIER_UNAVAILABLE	(-1)
+
+static int volatile _dispatch_membarrier_cmd;
+
+static int
+_dispatch_membarrier_cmd_init(void)
+{
+	int mask = (int)syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0);
+	int cmd = DISPATCH_MEMBARRIER_UNAVAILABLE;
+
+	// registering more than once is harmless, racing callers agree
+	if (mask > 0 && (mask & MEMBARRIER_CMD_PRIVATE_EXPEDITED) &&
+			syscall(SYS_membarrier,
+			MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0) {
+		cmd = MEMBARRIER_CMD_PRIVATE_EXPEDITED;
+	} else if (mask > 0 && (mask & MEMBARRIER_CMD_SHARED)) {
+		cmd = MEMBARRIER_CMD_SHARED;
+	}
+	os_atomic_store(&_dispatch_membarrier_cmd, cmd, relaxed);
+	return cmd;
+}
+
+bool
+_dispatch_once_quiesce(uintptr_t gen)
+{
+	int cmd = os_atomic_load(&_dispatch_membarrier_cmd, relaxed);
+
+	if (unlikely(cmd == DISPATCH_MEMBARRIER_UNKNOWN)) {
+		cmd = _dispatch_membarrier_cmd_init();
+	}
+	if (unlikely(cmd == DISPATCH_MEMBARRIER_UNAVAILABLE)) {
+		// the once keeps its generation, and callers the acquire barrier
+		return false;
+	}
+	while (_dispatch_once_generation() - gen < DISPATCH_ONCE_GEN_SAFE_DELTA) {
+		uintptr_t value = os_atomic_load(&_dispatch_once_quiescent_counter,
+				relaxed);
+		if (unlikely(syscall(SYS_membarrier, cmd, 0) < 0)) {
+			// e.g. denied by a seccomp filter, don't retry on every call
+			os_atomic_store(&_dispatch_membarrier_cmd,
+					DISPATCH_MEMBARRIER_UNAVAILABLE, relaxed);
+			return false;
+		}
+		// another thread may have advanced it meanwhile, which is as good
+		os_atomic_cmpxchg(&_dispatch_once_quiescent_counter, value,
+				value + 1, seq_cst);
+	}
+	return true;
+}
+#endif // DISPATCH_ONCE_USE_QUIESCENT_COUNTER && __linux__
+
 #pragma mark - gate lock
 
 //os_atomic_rmw_loop 用于从操作系统底层获取状态，使用 os_atomic_rmw_loop_give_up 来执行返回操作，即不停查询 &dgo->dgo_once 的值，若变为 DLOCK_ONCE_DONE 则调用 os_atomic_rmw_loop_give_up(return) 退出等待。
@@ -182,6 +182,8 @@ _dispatch_lock_has_failed_trylock(dispatch_lock lock_value)
 #define DISPATCH_ONCE_USE_QUIESCENT_COUNTER 0
 #elif __APPLE__
 #define DISPATCH_ONCE_USE_QUIESCENT_COUNTER 1
+#elif defined(__linux__) && defined(__LP64__)
+#define DISPATCH_ONCE_USE_QUIESCENT_COUNTER 1
 #else
 #define DISPATCH_ONCE_USE_QUIESCENT_COUNTER 0
 #endif
@@ -475,6 +477,39 @@ typedef struct dispatch_once_gate_s {
 } dispatch_once_gate_s, *dispatch_once_gate_t;
 
 #if DISPATCH_ONCE_USE_QUIESCENT_COUNTER
+#if defined(__linux__)
+/*
+ * Linux has no quiescent counter in the commpage, so libdispatch keeps its
+ * own generation, which _dispatch_once_quiesce() advances after each
+ * membarrier(2) that made every thread of the process execute a barrier.
+ *
+ * The generation must have been advanced twice since a once was marked: the
+ * first advance may follow a membarrier issued before the initializer's
+ * stores, but the one after it was issued once the generation read by the
+ * initializer had been replaced, hence after these stores were visible.
+ *
+ * Lock values only use the low 32 bits, generations set the top bit.
+ */
+#define DISPATCH_ONCE_GEN_BIT        ((uintptr_t)1 << 63)
+#define DISPATCH_ONCE_MAKE_GEN(gen)  (((gen) << 2) | DISPATCH_ONCE_GEN_BIT)
+#define DISPATCH_ONCE_IS_GEN(gen) \
+		(((gen) & DISPATCH_ONCE_GEN_BIT) && (gen) != DLOCK_ONCE_DONE)
+#define DISPATCH_ONCE_GEN_SAFE_DELTA  (2 << 2)
+
+extern uintptr_t volatile _dispatch_once_quiescent_counter;
+bool _dispatch_once_quiesce(uintptr_t gen);
+
+DISPATCH_ALWAYS_INLINE
+static inline uintptr_t
+_dispatch_once_generation(void)
+{
+	uintptr_t value;
+	// orders the initializer's stores before the generation it is marked with
+	os_atomic_thread_fence(seq_cst);
+	value = os_atomic_load(&_dispatch_once_quiescent_counter, relaxed);
+	return (uintptr_t)DISPATCH_ONCE_MAKE_GEN(value);
+}
+#else
 #define DISPATCH_ONCE_MAKE_GEN(gen)  (((gen) << 2) + DLOCK_FAILED_TRYLOCK_BIT)
 #define DISPATCH_ONCE_IS_GEN(gen)    (((gen) & 3) == DLOCK_FAILED_TRYLOCK_BIT)
 
@@ -643,6 +678,7 @@ _dispatch_once_generation(void)
 	value = *(volatile uintptr_t *)_COMM_PAGE_CPU_QUIESCENT_COUNTER;
 	return (uintptr_t)DISPATCH_ONCE_MAKE_GEN(value);
 }
+#endif // __linux__
 
 DISPATCH_ALWAYS_INLINE
 static inline uintptr_t
@@ -655,7 +691,11 @@ DISPATCH_ALWAYS_INLINE
 static inline void
 _dispatch_once_mark_done_if_quiesced(dispatch_once_gate_t dgo, uintptr_t gen)
 {
-	if (_dispatch_once_generation() - gen >= DISPATCH_ONCE_GEN_SAFE_DELTA) {
+	if (_dispatch_once_generation() - gen >= DISPATCH_ONCE_GEN_SAFE_DELTA
+#if defined(__linux__)
+			|| _dispatch_once_quiesce(gen)
+#endif
+			) {
 		/*
 		 * See explanation above, when the quiescing counter approach is taken
 		 * then this store needs only to be relaxed as it is used as a witness
@@ -112,6 +112,7 @@ typedef uint32_t dispatch_priority_t;
 #define DISPATCH_PRIORITY_FLAG_FLOOR         ((dispatch_priority_t)0x40000000) // _PTHREAD_PRIORITY_INHERIT_FLAG
 #define DISPATCH_PRIORITY_FLAG_ENFORCE       ((dispatch_priority_t)0x10000000) // _PTHREAD_PRIORITY_ENFORCE_FLAG
 #define DISPATCH_PRIORITY_FLAG_INHERITED     ((dispatch_priority_t)0x20000000)
+#define DISPATCH_PRIORITY_FLAG_COOPERATIVE   ((dispatch_priority_t)0x08000000)
 
 DISPATCH_ALWAYS_INLINE
 static inline bool
@@ -122,6 +122,70 @@ _dispatch_get_nanoseconds(void)
 #endif
 }
 
+#if defined(__linux__) && HAVE_DECL_CLOCK_MONOTONIC && \
+		(defined(__x86_64__) || defined(__i386__)) && \
+		!defined(DISPATCH_USE_TSC_UPTIME)
+#define DISPATCH_USE_TSC_UPTIME 1
+#endif
+
+#if DISPATCH_USE_TSC_UPTIME
+/*
+ * With LIBDISPATCH_TSC_CLOCK=1, on machines with an invariant TSC that the
+ * kernel also uses as its clocksource, _dispatch_uptime() extrapolates
+ * CLOCK_MONOTONIC from the TSC instead of calling clock_gettime().
+ *
+ * The result has to stay on the CLOCK_MONOTONIC timebase since timerfds are
+ * armed against it: the conversion is calibrated against CLOCK_MONOTONIC
+ * during the first few milliseconds, and then slewed at regular intervals
+ * to follow its NTP adjustments without ever going backwards.
+ *
+ * Updates of the conversion are published under dtc_seq, which is odd while
+ * one is in progress.
+ */
+#define DISPATCH_TSC_SHIFT 24
+
+typedef struct dispatch_tsc_clock_s {
+	os_atomic(uint32_t) dtc_seq;
+	uint64_t dtc_mult;
+	uint64_t dtc_tsc_base;
+	uint64_t dtc_ns_base;
+	uint64_t dtc_tsc_next; // the conversion is due for slewing past this
+} dispatch_tsc_clock_s;
+
+extern bool _dispatch_tsc_clock_enabled;
+extern dispatch_tsc_clock_s _dispatch_tsc_clock;
+uint64_t _dispatch_tsc_uptime_slow(uint32_t seq);
+
+DISPATCH_ALWAYS_INLINE
+static inline uint64_t
+_dispatch_tsc_uptime(void)
+{
+	dispatch_tsc_clock_s *dtc = &_dispatch_tsc_clock;
+	uint64_t delta, ns;
+	uint32_t seq;
+
+	for (;;) {
+		seq = os_atomic_load(&dtc->dtc_seq, acquire);
+		if (unlikely(seq & 1)) {
+			dispatch_hardware_pause();
+			continue;
+		}
+		delta = __builtin_ia32_rdtsc();
+		if (unlikely(delta >= dtc->dtc_tsc_next)) {
+			return _dispatch_tsc_uptime_slow(seq);
+		}
+		delta -= dtc->dtc_tsc_base;
+		// a CPU whose TSC is a hair behind the one that set the base
+		if (unlikely((int64_t)delta < 0)) delta = 0;
+		ns = dtc->dtc_ns_base + ((delta * dtc->dtc_mult) >> DISPATCH_TSC_SHIFT);
+		os_atomic_thread_fence(acquire);
+		if (likely(os_atomic_load(&dtc->dtc_seq, relaxed) == seq)) {
+			return ns;
+		}
+	}
+}
+#endif // DISPATCH_USE_TSC_UPTIME
+
 /* On the use of clock sources in the CLOCK_MONOTONIC family
  *
  * The code below requires monotonic clock sources that only tick
@@ -141,6 +205,11 @@ _dispatch_uptime(void)
 #if HAVE_MACH_ABSOLUTE_TIME
 	return mach_absolute_time();
 #elif HAVE_DECL_CLOCK_MONOTONIC && defined(__linux__)
+#if DISPATCH_USE_TSC_UPTIME
+	if (unlikely(_dispatch_tsc_clock_enabled)) {
+		return _dispatch_tsc_uptime();
+	}
+#endif
 	struct timespec ts;
 	dispatch_assume_zero(clock_gettime(CLOCK_MONOTONIC, &ts));
 	return _dispatch_timespec_to_nano(ts);
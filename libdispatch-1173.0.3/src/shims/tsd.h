@@ -152,6 +152,16 @@ struct dispatch_tsd {
 	void *dispatch_wlh_key;
 	void *dispatch_voucher_key;
 	void *dispatch_deferred_items_key;
+#if DISPATCH_USE_TRACE_RING
+	void *dispatch_trace_ring_key;
+#endif
+#if DISPATCH_USE_CONTINUATION_INLINE_BLOCK
+	void *dispatch_inline_cache_key;
+#endif
+#if DISPATCH_USE_GROUP_LEAVE_BATCHING
+	void *dispatch_group_leave_key;
+	void *dispatch_group_leave_count_key;
+#endif
 };
 
 extern _Thread_local struct dispatch_tsd __dispatch_tsd;
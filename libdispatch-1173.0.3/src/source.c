@@ -196,30 +196,69 @@ dispatch_source_get_extended_data(dispatch_source_t ds,
 	return target_size;
 }
 
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_source_is_custom_data(dispatch_source_refs_t dr)
+{
+	switch (dr->du_filter) {
+	case DISPATCH_EVFILT_CUSTOM_ADD:
+	case DISPATCH_EVFILT_CUSTOM_OR:
+	case DISPATCH_EVFILT_CUSTOM_REPLACE:
+		return true;
+	}
+	return false;
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline uint64_t *
+_dispatch_source_data_shard(dispatch_source_data_refs_t dsd)
+{
+	uint32_t cpu;
+#if defined(__linux__)
+	int rc = sched_getcpu();
+	cpu = rc < 0 ? 0 : (uint32_t)rc;
+#else
+	cpu = (uint32_t)_dispatch_cpu_number();
+#endif
+	return &dsd->dsd_shards[cpu % dsd->dsd_shard_count].dsds_data;
+}
+
 void
 dispatch_source_merge_data(dispatch_source_t ds, unsigned long val)
 {
 	dispatch_queue_flags_t dqf = _dispatch_queue_atomic_flags(ds);
 	dispatch_source_refs_t dr = ds->ds_refs;
+	dispatch_source_data_refs_t dsd = ds->ds_data_refs;
+	uint64_t *data = &dr->ds_pending_data;
 
 	if (unlikely(dqf & (DSF_CANCELED | DQF_RELEASED))) {
 		return;
 	}
 
+	if (dr->du_is_sharded) {
+		data = _dispatch_source_data_shard(dsd);
+	}
 	switch (dr->du_filter) {
 	case DISPATCH_EVFILT_CUSTOM_ADD:
-		os_atomic_add2o(dr, ds_pending_data, val, relaxed);
+		os_atomic_add(data, val, seq_cst);
 		break;
 	case DISPATCH_EVFILT_CUSTOM_OR:
-		os_atomic_or2o(dr, ds_pending_data, val, relaxed);
+		os_atomic_or(data, val, seq_cst);
 		break;
 	case DISPATCH_EVFILT_CUSTOM_REPLACE:
-		os_atomic_store2o(dr, ds_pending_data, val, relaxed);
+		os_atomic_xchg(data, val, seq_cst);
 		break;
 	default:
 		DISPATCH_CLIENT_CRASH(dr->du_filter, "Invalid source type");
 	}
 
+	// Only the first merge since the source last latched its data has to wake
+	// it up: dsd_wakeup_pending is cleared before the data is taken, so that
+	// merges which saw it set are always observed by the next latch.
+	if (os_atomic_load2o(dsd, dsd_wakeup_pending, seq_cst) ||
+			os_atomic_xchg2o(dsd, dsd_wakeup_pending, 1, seq_cst)) {
+		return;
+	}
 	dx_wakeup(ds, 0, DISPATCH_WAKEUP_MAKE_DIRTY);
 }
 
@@ -523,13 +562,50 @@ _dispatch_source_timer_data(dispatch_timer_source_refs_t dr, uint64_t prev)
 	return data;
 }
 
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_source_has_pending_data(dispatch_source_refs_t dr)
+{
+	if (os_atomic_load2o(dr, ds_pending_data, relaxed)) {
+		return true;
+	}
+	// sharded data, or a wakeup whose data a previous latch already took
+	return _dispatch_source_is_custom_data(dr) &&
+			os_atomic_load2o((dispatch_source_data_refs_t)dr,
+			dsd_wakeup_pending, relaxed);
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline uint64_t
+_dispatch_source_take_pending_data(dispatch_source_refs_t dr)
+{
+	dispatch_source_data_refs_t dsd = (dispatch_source_data_refs_t)dr;
+	uint64_t data;
+
+	if (!_dispatch_source_is_custom_data(dr)) {
+		return os_atomic_xchg2o(dr, ds_pending_data, 0, relaxed);
+	}
+
+	os_atomic_xchg2o(dsd, dsd_wakeup_pending, 0, seq_cst);
+	data = os_atomic_xchg2o(dr, ds_pending_data, 0, seq_cst);
+	if (dr->du_is_sharded) {
+		for (uint32_t i = 0; i < dsd->dsd_shard_count; i++) {
+			uint64_t v = os_atomic_xchg2o(&dsd->dsd_shards[i], dsds_data,
+					0, seq_cst);
+			data = dr->du_filter == DISPATCH_EVFILT_CUSTOM_OR ?
+					(data | v) : (data + v);
+		}
+	}
+	return data;
+}
+
 static void
 _dispatch_source_latch_and_call(dispatch_source_t ds, dispatch_queue_t cq,
 		dispatch_invoke_flags_t flags)
 {
 	dispatch_source_refs_t dr = ds->ds_refs;
 	dispatch_continuation_t dc = _dispatch_source_get_handler(dr, DS_EVENT_HANDLER);
-	uint64_t prev = os_atomic_xchg2o(dr, ds_pending_data, 0, relaxed);
+	uint64_t prev = _dispatch_source_take_pending_data(dr);
 
 	if (dr->du_is_timer && (dr->du_timer_flags & DISPATCH_TIMER_AFTER)) {
 		_dispatch_trace_item_pop(cq, dc); // see _dispatch_after
@@ -546,7 +622,8 @@ _dispatch_source_latch_and_call(dispatch_source_t ds, dispatch_queue_t cq,
 		dr->ds_data = ~prev;
 		break;
 	default:
-		if (prev == 0 && dr->du_filter == DISPATCH_EVFILT_CUSTOM_REPLACE) {
+		if (prev == 0 && _dispatch_source_is_custom_data(dr)) {
+			// REPLACE with 0, or a wakeup racing with a previous latch
 			return;
 		}
 		dr->ds_data = prev;
@@ -790,7 +867,7 @@ _dispatch_source_invoke2(dispatch_source_t ds, dispatch_invoke_context_t dic,
 
 	dqf = _dispatch_queue_atomic_flags(ds);
 	if (!(dqf & (DSF_CANCELED | DQF_RELEASED)) &&
-			os_atomic_load2o(dr, ds_pending_data, relaxed)) {
+			_dispatch_source_has_pending_data(dr)) {
 		// The source has pending data to deliver via the event handler callback
 		// on the target queue. Some sources need to be rearmed on the kevent
 		// queue after event delivery.
@@ -975,7 +1052,7 @@ _dispatch_source_wakeup(dispatch_source_t ds, dispatch_qos_t qos,
 		// from the target queue
 		tq = DISPATCH_QUEUE_WAKEUP_TARGET;
 	} else if (!(dqf & (DSF_CANCELED | DQF_RELEASED)) &&
-			os_atomic_load2o(dr, ds_pending_data, relaxed)) {
+			_dispatch_source_has_pending_data(dr)) {
 		// The source has pending data to deliver to the target queue.
 		tq = DISPATCH_QUEUE_WAKEUP_TARGET;
 	} else if ((dqf & (DSF_CANCELED | DQF_RELEASED)) && !(dqf & DSF_DELETED)) {
@@ -1353,47 +1430,42 @@ dispatch_source_set_timer(dispatch_source_t ds, dispatch_time_t start,
 #pragma mark dispatch_after
 
 DISPATCH_ALWAYS_INLINE
-static inline void
+static inline struct dispatch_after_refs_s *
 _dispatch_after(dispatch_time_t when, dispatch_queue_t dq,
-		void *ctxt, void *handler, bool block)
+		void *ctxt, void *handler, bool block, bool cancellable)
 {
-	dispatch_timer_source_refs_t dt;
-	dispatch_source_t ds;
 	uint64_t leeway, delta;
 
 	if (when == DISPATCH_TIME_FOREVER) {
 #if DISPATCH_DEBUG
 		DISPATCH_CLIENT_CRASH(0, "dispatch_after called with 'when' == infinity");
 #endif
-		return;
+		return NULL;
 	}
 
-	delta = _dispatch_timeout(when);
-	if (delta == 0) {
+	// the delay only sizes the leeway and tells whether `when` is already
+	// past, the approximate clock saves a full clock read for either
+	delta = _dispatch_timeout_approximate(when);
+	if (delta == 0 && !cancellable) {
 		if (block) {
-			return dispatch_async(dq, handler);
+			dispatch_async(dq, handler);
+		} else {
+			dispatch_async_f(dq, ctxt, handler);
 		}
-		return dispatch_async_f(dq, ctxt, handler);
+		return NULL;
 	}
 	leeway = delta / 10; // <rdar://problem/13447496>
 
 	if (leeway < NSEC_PER_MSEC) leeway = NSEC_PER_MSEC;
 	if (leeway > 60 * NSEC_PER_SEC) leeway = 60 * NSEC_PER_SEC;
 
-	// this function can and should be optimized to not use a dispatch source
-	ds = dispatch_source_create(&_dispatch_source_type_after, 0, 0, dq);
-	dt = ds->ds_timer_refs;
-
 	dispatch_continuation_t dc = _dispatch_continuation_alloc();
+	dispatch_qos_t qos;
 	if (block) {
-		_dispatch_continuation_init(dc, dq, handler, 0, 0);
+		qos = _dispatch_continuation_init(dc, dq, handler, 0, 0);
 	} else {
-		_dispatch_continuation_init_f(dc, dq, ctxt, handler, 0, 0);
+		qos = _dispatch_continuation_init_f(dc, dq, ctxt, handler, 0, 0);
 	}
-	// reference `ds` so that it doesn't show up as a leak
-	dc->dc_data = ds;
-	_dispatch_trace_item_push(dq, dc);
-	os_atomic_store2o(dt, ds_handler[DS_EVENT_HANDLER], dc, relaxed);
 
 	dispatch_clock_t clock;
 	uint64_t target;
@@ -1401,11 +1473,10 @@ _dispatch_after(dispatch_time_t when, dispatch_queue_t dq,
 	if (clock != DISPATCH_CLOCK_WALL) {
 		leeway = _dispatch_time_nano2mach(leeway);
 	}
-	dt->du_timer_flags |= _dispatch_timer_flags_from_clock(clock);
-	dt->dt_timer.target = target;
-	dt->dt_timer.interval = UINT64_MAX;
-	dt->dt_timer.deadline = target + leeway;
-	dispatch_activate(ds);
+	// no dispatch source: the continuation goes straight to the timer heap,
+	// see _dispatch_timers_after_enqueue()
+	return _dispatch_timers_after_enqueue(dc, dq, qos, clock, target, leeway,
+			cancellable);
 }
 
 DISPATCH_NOINLINE
@@ -1413,7 +1484,7 @@ void
 dispatch_after_f(dispatch_time_t when, dispatch_queue_t queue, void *ctxt,
 		dispatch_function_t func)
 {
-	_dispatch_after(when, queue, ctxt, func, false);
+	_dispatch_after(when, queue, ctxt, func, false, false);
 }
 
 #ifdef __BLOCKS__
@@ -1421,10 +1492,39 @@ void
 dispatch_after(dispatch_time_t when, dispatch_queue_t queue,
 		dispatch_block_t work)
 {
-	_dispatch_after(when, queue, NULL, work, true);
+	_dispatch_after(when, queue, NULL, work, true, false);
 }
 #endif
 
+dispatch_after_handle_t
+dispatch_after_cancellable_f(dispatch_time_t when, dispatch_queue_t queue,
+		void *ctxt, dispatch_function_t func)
+{
+	return (dispatch_after_handle_t)_dispatch_after(when, queue, ctxt, func,
+			false, true);
+}
+
+bool
+dispatch_after_cancel(dispatch_after_handle_t handle)
+{
+	dispatch_continuation_t dc;
+
+	if (unlikely(!handle)) return false;
+	dc = _dispatch_timers_after_cancel((struct dispatch_after_refs_s *)handle);
+	if (dc) {
+		_dispatch_source_handler_dispose(dc);
+		return true;
+	}
+	return false;
+}
+
+void
+dispatch_after_handle_release(dispatch_after_handle_t handle)
+{
+	if (unlikely(!handle)) return;
+	_dispatch_timers_after_release((struct dispatch_after_refs_s *)handle);
+}
+
 #pragma mark -
 #pragma mark dispatch_source_debug
 
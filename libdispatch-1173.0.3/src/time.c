@@ -19,6 +19,9 @@
  */
 
 #include "internal.h"
+#if DISPATCH_USE_TSC_UPTIME
+#include <cpuid.h>
+#endif
 
 #if DISPATCH_USE_HOST_TIME
 typedef struct _dispatch_host_time_data_s {
@@ -78,6 +81,144 @@ _dispatch_host_time_init(mach_timebase_info_data_t *tbi)
 }
 #endif // DISPATCH_USE_HOST_TIME
 
+#if DISPATCH_USE_TSC_UPTIME
+#define DISPATCH_TSC_CALIBRATION_NS	(10 * NSEC_PER_MSEC)
+#define DISPATCH_TSC_SLEW_NS		NSEC_PER_SEC
+// keeps the calibration interval shifted by DISPATCH_TSC_SHIFT in 64 bits
+#define DISPATCH_TSC_CALIBRATION_MAX_NS	DISPATCH_TSC_SLEW_NS
+// fastest rate at which the conversion is slewed, in parts per million
+#define DISPATCH_TSC_SLEW_MAX_PPM	500
+// beyond this CLOCK_MONOTONIC got ahead for reasons slewing won't catch up
+// with in a reasonable time, the conversion steps forward instead
+#define DISPATCH_TSC_STEP_NS		NSEC_PER_MSEC
+
+bool _dispatch_tsc_clock_enabled;
+dispatch_tsc_clock_s _dispatch_tsc_clock;
+static uint64_t _dispatch_tsc_calibration_tsc;
+static uint64_t _dispatch_tsc_calibration_ns;
+
+// Returns the TSC at the middle of a CLOCK_MONOTONIC read, returned in `ns`
+static uint64_t
+_dispatch_tsc_sample(uint64_t *ns)
+{
+	struct timespec ts;
+	uint64_t before, after;
+
+	before = __builtin_ia32_rdtsc();
+	dispatch_assume_zero(clock_gettime(CLOCK_MONOTONIC, &ts));
+	after = __builtin_ia32_rdtsc();
+	*ns = _dispatch_timespec_to_nano(ts);
+	return before + (after - before) / 2;
+}
+
+static bool
+_dispatch_tsc_is_usable(void)
+{
+	const char *path =
+			"/sys/devices/system/clocksource/clocksource0/current_clocksource";
+	unsigned int eax, ebx, ecx, edx;
+	char buf[16];
+	ssize_t n;
+	int fd;
+
+	// CPUID.80000007H:EDX[8]: the TSC ticks at a constant rate in every
+	// P-, C- and T-state
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) ||
+			!(edx & (1u << 8))) {
+		return false;
+	}
+	// and the kernel found it to be synchronized across CPUs
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+	n = read(fd, buf, sizeof(buf));
+	close(fd);
+	return n >= 3 && strncmp(buf, "tsc", 3) == 0 && (n == 3 || buf[3] == '\n');
+}
+
+static void
+_dispatch_tsc_clock_init(void)
+{
+	const char *e = getenv("LIBDISPATCH_TSC_CLOCK");
+
+	if (!e || !atoi(e) || !_dispatch_tsc_is_usable()) {
+		return;
+	}
+	_dispatch_tsc_calibration_tsc =
+			_dispatch_tsc_sample(&_dispatch_tsc_calibration_ns);
+	// dtc_tsc_next is 0: every read takes the slow path until calibrated
+	_dispatch_tsc_clock_enabled = true;
+}
+
+DISPATCH_NOINLINE
+uint64_t
+_dispatch_tsc_uptime_slow(uint32_t seq)
+{
+	dispatch_tsc_clock_s *dtc = &_dispatch_tsc_clock;
+	uint64_t tsc, ns, ext, mult, period;
+	int64_t err, max_err;
+
+	tsc = _dispatch_tsc_sample(&ns);
+	if (dtc->dtc_mult == 0 &&
+			ns - _dispatch_tsc_calibration_ns < DISPATCH_TSC_CALIBRATION_NS) {
+		// still calibrating, CLOCK_MONOTONIC is the reference
+		return ns;
+	}
+	if (!os_atomic_cmpxchg(&dtc->dtc_seq, seq, seq + 1, acquire)) {
+		// another thread is updating the conversion, wait for it
+		return _dispatch_tsc_uptime();
+	}
+	os_atomic_thread_fence(release);
+
+	if (dtc->dtc_mult == 0) {
+		if (unlikely(ns - _dispatch_tsc_calibration_ns >
+				DISPATCH_TSC_CALIBRATION_MAX_NS)) {
+			// nobody read the clock during the calibration window, and the
+			// shift below would overflow: start calibrating again from here
+			_dispatch_tsc_calibration_tsc = tsc;
+			_dispatch_tsc_calibration_ns = ns;
+			os_atomic_store(&dtc->dtc_seq, seq + 2, release);
+			return ns;
+		}
+		mult = ((ns - _dispatch_tsc_calibration_ns) << DISPATCH_TSC_SHIFT) /
+				(tsc - _dispatch_tsc_calibration_tsc);
+		ext = ns;
+	} else {
+		period = dtc->dtc_tsc_next - dtc->dtc_tsc_base;
+		if (tsc - dtc->dtc_tsc_base > 2 * period) {
+			// nobody read the clock for a while: stepping to CLOCK_MONOTONIC
+			// can't go backwards from any value returned so far
+			ext = ns;
+			err = 0;
+		} else {
+			ext = dtc->dtc_ns_base + (((tsc - dtc->dtc_tsc_base) *
+					dtc->dtc_mult) >> DISPATCH_TSC_SHIFT);
+			err = (int64_t)(ns - ext);
+			if (err > (int64_t)DISPATCH_TSC_STEP_NS) {
+				ext = ns;
+				err = 0;
+			}
+		}
+		// aim at CLOCK_MONOTONIC by the end of the next slewing period
+		max_err = (int64_t)(DISPATCH_TSC_SLEW_NS / 1000000 *
+				DISPATCH_TSC_SLEW_MAX_PPM);
+		if (err > max_err) err = max_err;
+		if (err < -max_err) err = -max_err;
+		mult = dtc->dtc_mult * (uint64_t)((int64_t)DISPATCH_TSC_SLEW_NS + err) /
+				DISPATCH_TSC_SLEW_NS;
+	}
+	if (unlikely(mult == 0)) mult = 1;
+
+	dtc->dtc_mult = mult;
+	dtc->dtc_tsc_base = tsc;
+	dtc->dtc_ns_base = ext;
+	dtc->dtc_tsc_next = tsc + (DISPATCH_TSC_SLEW_NS << DISPATCH_TSC_SHIFT) / mult;
+	os_atomic_store(&dtc->dtc_seq, seq + 2, release);
+	return ext;
+}
+#endif // DISPATCH_USE_TSC_UPTIME
+
 void
 _dispatch_time_init(void)
 {
@@ -86,6 +227,9 @@ _dispatch_time_init(void)
 	(void)dispatch_assume_zero(mach_timebase_info(&tbi));
 	_dispatch_host_time_init(&tbi);
 #endif // DISPATCH_USE_HOST_TIME
+#if DISPATCH_USE_TSC_UPTIME
+	_dispatch_tsc_clock_init();
+#endif
 }
 
 dispatch_time_t
@@ -190,6 +334,29 @@ _dispatch_timeout(dispatch_time_t when)
 	}
 }
 
+// Same as _dispatch_timeout() with _dispatch_approximate_time() standing in
+// for the uptime clock. It lags behind by up to a scheduler tick, so the
+// timeout can be overestimated by as much but never underestimated.
+uint64_t
+_dispatch_timeout_approximate(dispatch_time_t when)
+{
+	dispatch_clock_t clock;
+	uint64_t value, now;
+
+	if (when == DISPATCH_TIME_FOREVER) {
+		return DISPATCH_TIME_FOREVER;
+	}
+	if (when == DISPATCH_TIME_NOW) {
+		return 0;
+	}
+	_dispatch_time_to_clock_and_value(when, &clock, &value);
+	if (clock != DISPATCH_CLOCK_UPTIME) {
+		return _dispatch_timeout(when);
+	}
+	now = _dispatch_approximate_time();
+	return now >= value ? 0 : _dispatch_time_mach2nano(value - now);
+}
+
 uint64_t
 _dispatch_time_nanoseconds_since_epoch(dispatch_time_t when)
 {
@@ -29,6 +29,8 @@
 
 #if DISPATCH_PURE_C
 
+#include "trace_ring_internal.h"
+
 #if DISPATCH_USE_DTRACE_INTROSPECTION
 #define _dispatch_trace_callout(_c, _f, _dcc) do { \
 		if (unlikely(DISPATCH_CALLOUT_ENTRY_ENABLED() || \
@@ -44,12 +46,13 @@
 			_dcc; \
 		} \
 	} while (0)
-#elif DISPATCH_INTROSPECTION
+#elif DISPATCH_INTROSPECTION || DISPATCH_USE_TRACE_RING
 #define _dispatch_trace_callout(_c, _f, _dcc) \
 		do { (void)(_c); (void)(_f); _dcc; } while (0)
 #endif // DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION
 
-#if DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION
+#if DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION || \
+		DISPATCH_USE_TRACE_RING
 DISPATCH_ALWAYS_INLINE
 static inline void
 _dispatch_trace_client_callout(void *ctxt, dispatch_function_t f)
@@ -57,7 +60,9 @@ _dispatch_trace_client_callout(void *ctxt, dispatch_function_t f)
 	dispatch_function_t func = (f == _dispatch_call_block_and_release &&
 			ctxt ? _dispatch_Block_invoke(ctxt) : f);
 	_dispatch_introspection_callout_entry(ctxt, func);
+	_dispatch_trace_ring_callout_entry(ctxt, func);
 	_dispatch_trace_callout(ctxt, func, _dispatch_client_callout(ctxt, f));
+	_dispatch_trace_ring_callout_return(ctxt, func);
 	_dispatch_introspection_callout_return(ctxt, func);
 }
 
@@ -67,13 +72,16 @@ _dispatch_trace_client_callout2(void *ctxt, size_t i, void (*f)(void *, size_t))
 {
 	dispatch_function_t func = (dispatch_function_t)f;
 	_dispatch_introspection_callout_entry(ctxt, func);
+	_dispatch_trace_ring_callout_entry(ctxt, func);
 	_dispatch_trace_callout(ctxt, func, _dispatch_client_callout2(ctxt, i, f));
+	_dispatch_trace_ring_callout_return(ctxt, func);
 	_dispatch_introspection_callout_return(ctxt, func);
 }
 
 #define _dispatch_client_callout		_dispatch_trace_client_callout
 #define _dispatch_client_callout2		_dispatch_trace_client_callout2
-#endif // DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION
+#endif // DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION ||
+       // DISPATCH_USE_TRACE_RING
 
 #ifdef _COMM_PAGE_KDEBUG_ENABLE
 #define DISPATCH_KTRACE_ENABLED \
@@ -263,6 +271,8 @@ _dispatch_trace_item_push_list(dispatch_queue_global_t dq,
 			_dispatch_trace_item_push_inline(dq->_as_dq, dou);
 		} while (dou != _tail._do && (dou = dou->do_next));
 	}
+	_dispatch_trace_ring_item_push_list(dq, _head, _tail);
+	_dispatch_introspection_batch_item_push_list(dq, _head, _tail);
 	_dispatch_introspection_queue_push_list(dq, _head, _tail);
 }
 
@@ -275,6 +285,8 @@ _dispatch_trace_item_push(dispatch_queue_class_t dqu, dispatch_object_t _tail)
 	}
 
 	_dispatch_trace_item_push_inline(dqu._dq, _tail._do);
+	_dispatch_trace_ring_item_push(dqu, _tail);
+	_dispatch_introspection_batch_item_push(dqu, _tail);
 	_dispatch_introspection_queue_push(dqu, _tail);
 }
 
@@ -296,6 +308,7 @@ _dispatch_trace_item_pop(dispatch_queue_class_t dqu, dispatch_object_t dou)
 	}
 
 	_dispatch_trace_item_pop_inline(dqu._dq, dou);
+	_dispatch_trace_ring_item_pop(dqu, dou);
 	_dispatch_introspection_queue_pop(dqu, dou);
 }
 
@@ -335,9 +348,12 @@ _dispatch_trace_source_callout_entry_internal(dispatch_source_t ds, long kind,
 			_dispatch_trace_source_callout_entry_internal(__VA_ARGS__); \
 		})
 
-#define _dispatch_trace_runtime_event(evt, ptr, value) \
-		_dispatch_introspection_runtime_event(\
-				dispatch_introspection_runtime_event_##evt, ptr, value)
+#define _dispatch_trace_runtime_event(evt, ptr, value) do { \
+		_dispatch_trace_ring_runtime_event( \
+				dispatch_introspection_runtime_event_##evt, ptr, value); \
+		_dispatch_introspection_runtime_event( \
+				dispatch_introspection_runtime_event_##evt, ptr, value); \
+	} while (0)
 
 #define DISPATCH_TRACE_ARG(arg) , arg
 #else
@@ -367,18 +383,23 @@ _dispatch_trace_source_callout_entry_internal(dispatch_source_t ds, long kind,
 		new_state) \
 		do { (void)(ask0); (void)(ask1); (void)(old_state); \
 			(void)(new_state); } while (0)
-#define _dispatch_trace_item_push(dq, dou) \
-		do { (void)(dq); (void)(dou); } while(0)
-#define _dispatch_trace_item_push_list(dq, head, tail) \
-		do { (void)(dq); (void)(head); (void)tail; } while(0)
+#define _dispatch_trace_item_push(dq, dou) do { \
+		_dispatch_trace_ring_item_push(dq, dou); \
+		_dispatch_introspection_batch_item_push(dq, dou); \
+	} while (0)
+#define _dispatch_trace_item_push_list(dq, head, tail) do { \
+		_dispatch_trace_ring_item_push_list(dq, head, tail); \
+		_dispatch_introspection_batch_item_push_list(dq, head, tail); \
+	} while (0)
 #define _dispatch_trace_item_pop(dq, dou) \
-		do { (void)(dq); (void)(dou); } while(0)
+		_dispatch_trace_ring_item_pop(dq, dou)
 #define _dispatch_trace_item_complete(dou) ((void)0)
 #define _dispatch_trace_item_sync_push_pop(dq, ctxt, func, flags) \
 		do { (void)(dq); (void)(ctxt); (void)(func); (void)(flags); } while(0)
 #define _dispatch_trace_source_callout_entry(ds, k, dq, dc) ((void)0)
 #define _dispatch_trace_runtime_event(evt, ptr, value) \
-		do { (void)(ptr); (void)(value); } while(0)
+		_dispatch_trace_ring_runtime_event( \
+				dispatch_introspection_runtime_event_##evt, ptr, value)
 #define DISPATCH_TRACE_ARG(arg)
 #endif // DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION
 
@@ -453,12 +474,16 @@ _dispatch_trace_timer_configure(dispatch_source_t ds, dispatch_clock_t clock,
 			_dispatch_trace_timer_params(clock, values, 0, &params));
 }
 
+// Timers armed by dispatch_after() have no owning source (see event.c) and
+// are not reported by the probes below
+
 DISPATCH_ALWAYS_INLINE
 static inline void
 _dispatch_trace_timer_program(dispatch_timer_source_refs_t dr, uint64_t deadline)
 {
+	_dispatch_trace_ring_timer_program(dr, deadline);
 	if (unlikely(DISPATCH_TIMER_PROGRAM_ENABLED())) {
-		if (deadline && dr) {
+		if (deadline && dr && dr->du_owner_wref) {
 			dispatch_source_t ds = _dispatch_source_from_refs(dr);
 			dispatch_clock_t clock = DISPATCH_TIMER_CLOCK(dr->du_ident);
 			struct dispatch_trace_timer_params_s params;
@@ -474,7 +499,7 @@ static inline void
 _dispatch_trace_timer_wake(dispatch_timer_source_refs_t dr)
 {
 	if (unlikely(DISPATCH_TIMER_WAKE_ENABLED())) {
-		if (dr) {
+		if (dr && dr->du_owner_wref) {
 			dispatch_source_t ds = _dispatch_source_from_refs(dr);
 			DISPATCH_TIMER_WAKE(ds, _dispatch_trace_timer_function(dr));
 		}
@@ -486,8 +511,9 @@ static inline void
 _dispatch_trace_timer_fire(dispatch_timer_source_refs_t dr, uint64_t data,
 		uint64_t missed)
 {
+	_dispatch_trace_ring_timer_fire(dr, data, missed);
 	if (unlikely(DISPATCH_TIMER_FIRE_ENABLED())) {
-		if (!(data - missed) && dr) {
+		if (!(data - missed) && dr && dr->du_owner_wref) {
 			dispatch_source_t ds = _dispatch_source_from_refs(dr);
 			DISPATCH_TIMER_FIRE(ds, _dispatch_trace_timer_function(dr));
 		}
@@ -500,11 +526,11 @@ _dispatch_trace_timer_fire(dispatch_timer_source_refs_t dr, uint64_t data,
 #define _dispatch_trace_timer_configure(ds, clock, values) \
 		do { (void)(ds); (void)(clock); (void)(values); } while(0)
 #define _dispatch_trace_timer_program(dr, deadline) \
-		do { (void)(dr); (void)(deadline); } while(0)
+		_dispatch_trace_ring_timer_program(dr, deadline)
 #define _dispatch_trace_timer_wake(dr) \
 		do { (void)(dr); } while(0)
 #define _dispatch_trace_timer_fire(dr, data, missed) \
-		do { (void)(dr); (void)(data); (void)(missed); } while(0)
+		_dispatch_trace_ring_timer_fire(dr, data, missed)
 
 #endif // DISPATCH_USE_DTRACE
 
@@ -0,0 +1,506 @@
+/*
+ * This source file is part of the Swift.org open source project
+ *
+ * Copyright (c) 2026 Apple Inc. and the Swift project authors
+ *
+ * Licensed under Apache License v2.0 with Runtime Library Exception
+ *
+ * See https://swift.org/LICENSE.txt for license information
+ * See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+ *
+ */
+
+#include "internal.h"
+
+#if DISPATCH_USE_TRACE_RING
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#define DISPATCH_TRACE_RING_BUFFER_COUNT	256
+#define DISPATCH_TRACE_RING_DEFAULT_SIZE	(64ul << 20)
+#define DISPATCH_TRACE_RING_DRAIN_INTERVAL	(50 * NSEC_PER_MSEC)
+
+dispatch_static_assert(sizeof(dispatch_trace_ring_chunk_s) ==
+		DISPATCH_TRACE_RING_CHUNK_SIZE);
+dispatch_static_assert(sizeof(dispatch_trace_ring_header_s) <=
+		DISPATCH_TRACE_RING_CHUNK_SIZE);
+
+bool _dispatch_trace_ring_enabled;
+
+static struct dispatch_trace_ring_buffer_s *_dispatch_trace_ring_buffers;
+// generation << 32 | (index + 1) of the first free buffer, 0 when empty
+static uint64_t _dispatch_trace_ring_free_head;
+static dispatch_trace_ring_buffer_t volatile _dispatch_trace_ring_full;
+static uint64_t _dispatch_trace_ring_dropped;
+
+static dispatch_trace_ring_header_s *_dispatch_trace_ring_file;
+static size_t _dispatch_trace_ring_size;
+static const char *_dispatch_trace_ring_chrome_path;
+static dispatch_unfair_lock_s _dispatch_trace_ring_drain_lock;
+static _dispatch_sema4_t _dispatch_trace_ring_sema;
+
+#pragma mark -
+#pragma mark buffer pool
+
+static dispatch_trace_ring_buffer_t
+_dispatch_trace_ring_buffer_pop(void)
+{
+	uint64_t old_head, new_head;
+	uint32_t idx;
+
+	// the generation protects against ABA, the buffer we read the link of
+	// may have been popped and freed again in the meantime
+	os_atomic_rmw_loop(&_dispatch_trace_ring_free_head, old_head, new_head,
+			acquire, {
+		idx = (uint32_t)old_head;
+		if (unlikely(!idx)) {
+			os_atomic_rmw_loop_give_up(return NULL);
+		}
+		new_head = ((old_head & ~0xffffffffull) + (1ull << 32)) |
+				os_atomic_load(&_dispatch_trace_ring_buffers[idx - 1].
+				dtb_free_next, relaxed);
+	});
+	return &_dispatch_trace_ring_buffers[idx - 1];
+}
+
+// only called by the drain thread
+static void
+_dispatch_trace_ring_buffer_free(dispatch_trace_ring_buffer_t dtb)
+{
+	uint32_t idx = (uint32_t)(dtb - _dispatch_trace_ring_buffers) + 1;
+	uint64_t old_head, new_head;
+
+	os_atomic_store(&dtb->dtb_count, 0, relaxed);
+	dtb->dtb_drained = 0;
+	os_atomic_rmw_loop(&_dispatch_trace_ring_free_head, old_head, new_head,
+			release, {
+		os_atomic_store(&dtb->dtb_free_next, (uint32_t)old_head, relaxed);
+		new_head = ((old_head & ~0xffffffffull) + (1ull << 32)) | idx;
+	});
+}
+
+static void
+_dispatch_trace_ring_buffer_retire(dispatch_trace_ring_buffer_t dtb)
+{
+	dispatch_trace_ring_buffer_t old_head, new_head;
+
+	os_atomic_rmw_loop(&_dispatch_trace_ring_full, old_head, new_head,
+			release, {
+		dtb->dtb_full_next = old_head;
+		new_head = dtb;
+	});
+	if (!old_head) {
+		_dispatch_sema4_signal(&_dispatch_trace_ring_sema, 1);
+	}
+}
+
+DISPATCH_NOINLINE
+dispatch_trace_ring_buffer_t
+_dispatch_trace_ring_buffer_refill(dispatch_trace_ring_buffer_t dtb)
+{
+	if (dtb) {
+		_dispatch_trace_ring_buffer_retire(dtb);
+	}
+	dtb = _dispatch_trace_ring_buffer_pop();
+	if (likely(dtb)) {
+		dtb->dtb_thread = (uint64_t)_dispatch_get_tsd_base()->tid;
+#if defined(__linux__)
+		int cpu = sched_getcpu();
+		dtb->dtb_cpu = cpu < 0 ? 0 : (uint32_t)cpu;
+#else
+		dtb->dtb_cpu = 0;
+#endif
+	} else {
+		os_atomic_inc(&_dispatch_trace_ring_dropped, relaxed);
+	}
+	_dispatch_thread_setspecific(dispatch_trace_ring_key, dtb);
+	return dtb;
+}
+
+void DISPATCH_TSD_DTOR_CC
+_dispatch_trace_ring_thread_cleanup(void *ctxt)
+{
+	_dispatch_thread_setspecific(dispatch_trace_ring_key, NULL);
+	_dispatch_trace_ring_buffer_retire(ctxt);
+}
+
+#pragma mark -
+#pragma mark drain
+
+static void
+_dispatch_trace_ring_buffer_flush(dispatch_trace_ring_buffer_t dtb)
+{
+	dispatch_trace_ring_header_s *dtrh = _dispatch_trace_ring_file;
+	dispatch_trace_ring_chunk_s *dtrc;
+	uint32_t count = os_atomic_load(&dtb->dtb_count, acquire);
+	uint64_t seq = dtrh->dtrh_chunk_seq;
+
+	if (count == dtb->dtb_drained) return;
+
+	dtrc = (dispatch_trace_ring_chunk_s *)((char *)dtrh +
+			DISPATCH_TRACE_RING_CHUNK_SIZE *
+			(1 + seq % dtrh->dtrh_chunk_count));
+	dtrc->dtrc_seq = seq;
+	dtrc->dtrc_thread = dtb->dtb_thread;
+	dtrc->dtrc_cpu = dtb->dtb_cpu;
+	dtrc->dtrc_count = count - dtb->dtb_drained;
+	memcpy(dtrc->dtrc_events, &dtb->dtb_events[dtb->dtb_drained],
+			dtrc->dtrc_count * sizeof(dispatch_trace_ring_event_s));
+	dtrh->dtrh_events += dtrc->dtrc_count;
+	os_atomic_store(&dtrh->dtrh_chunk_seq, seq + 1, release);
+	dtb->dtb_drained = count;
+}
+
+static void
+_dispatch_trace_ring_drain(void)
+{
+	dispatch_trace_ring_header_s *dtrh = _dispatch_trace_ring_file;
+	dispatch_trace_ring_buffer_t dtb, next, head = NULL;
+
+	_dispatch_unfair_lock_lock(&_dispatch_trace_ring_drain_lock);
+
+	// retired buffers come back to the pool, oldest first
+	dtb = os_atomic_xchg(&_dispatch_trace_ring_full, NULL, acquire);
+	for (; dtb; dtb = next) {
+		next = dtb->dtb_full_next;
+		dtb->dtb_full_next = head;
+		head = dtb;
+	}
+	for (dtb = head; dtb; dtb = next) {
+		next = dtb->dtb_full_next;
+		_dispatch_trace_ring_buffer_flush(dtb);
+		_dispatch_trace_ring_buffer_free(dtb);
+	}
+
+	// then the events threads recorded since the last drain
+	for (size_t i = 0; i < DISPATCH_TRACE_RING_BUFFER_COUNT; i++) {
+		_dispatch_trace_ring_buffer_flush(&_dispatch_trace_ring_buffers[i]);
+	}
+
+	dtrh->dtrh_dropped = os_atomic_load(&_dispatch_trace_ring_dropped,
+			relaxed);
+	dtrh->dtrh_ts_last = _dispatch_trace_ring_timestamp();
+	dtrh->dtrh_ns_last = _dispatch_uptime();
+
+	_dispatch_unfair_lock_unlock(&_dispatch_trace_ring_drain_lock);
+}
+
+static void *
+_dispatch_trace_ring_drain_thread(void *ctxt DISPATCH_UNUSED)
+{
+	(void)dispatch_assume_zero(_dispatch_sigmask());
+	for (;;) {
+		_dispatch_sema4_timedwait(&_dispatch_trace_ring_sema,
+				dispatch_time(DISPATCH_TIME_NOW,
+				DISPATCH_TRACE_RING_DRAIN_INTERVAL));
+		_dispatch_trace_ring_drain();
+	}
+	return NULL;
+}
+
+static void
+_dispatch_trace_ring_atexit(void)
+{
+	const char *path = _dispatch_trace_ring_chrome_path;
+	int fd, r;
+
+	if (!os_atomic_load(&_dispatch_trace_ring_enabled, relaxed)) return;
+	_dispatch_trace_ring_drain();
+	if (!path) return;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+			0644);
+	if (fd == -1) {
+		_dispatch_log("unable to open chrome trace file %s: %d", path, errno);
+		return;
+	}
+	// keep the drain thread from rewriting chunks while they are converted
+	_dispatch_unfair_lock_lock(&_dispatch_trace_ring_drain_lock);
+	r = _dispatch_trace_ring_export_chrome(_dispatch_trace_ring_file,
+			_dispatch_trace_ring_size, fd);
+	_dispatch_unfair_lock_unlock(&_dispatch_trace_ring_drain_lock);
+	if (r) {
+		_dispatch_log("unable to write chrome trace file %s: %d", path, r);
+	}
+	close(fd);
+}
+
+#pragma mark -
+#pragma mark init
+
+void
+_dispatch_trace_ring_init(void)
+{
+	const char *path = getenv("LIBDISPATCH_TRACE_RING");
+	const char *chrome = getenv("LIBDISPATCH_TRACE_CHROME");
+	const char *e = getenv("LIBDISPATCH_TRACE_RING_SIZE");
+	size_t size = DISPATCH_TRACE_RING_DEFAULT_SIZE;
+	dispatch_trace_ring_header_s *dtrh;
+	pthread_attr_t attr;
+	pthread_t tid;
+	int fd, r;
+
+	if (path && !*path) path = NULL;
+	if (chrome && !*chrome) chrome = NULL;
+	if (!path && !chrome) return;
+	if (e) {
+		unsigned long mb = strtoul(e, NULL, 0);
+		if (mb) size = (size_t)mb << 20;
+	}
+
+	if (path) {
+		fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+				0644);
+		if (fd == -1) {
+			_dispatch_log("unable to open trace ring file %s: %d", path, errno);
+			return;
+		}
+		if (ftruncate(fd, (off_t)size) == -1) {
+			_dispatch_log("unable to size trace ring file %s: %d", path, errno);
+			close(fd);
+			return;
+		}
+		dtrh = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+	} else {
+		// only converted at exit, no need for a file
+		dtrh = mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
+	if (dtrh == MAP_FAILED) {
+		_dispatch_log("unable to map trace ring file %s: %d",
+				path ? path : "<anonymous>", errno);
+		return;
+	}
+	if (chrome) {
+		_dispatch_trace_ring_chrome_path = _dispatch_strdup_if_mutable(chrome);
+	}
+
+	_dispatch_trace_ring_buffers = _dispatch_calloc(
+			DISPATCH_TRACE_RING_BUFFER_COUNT,
+			sizeof(struct dispatch_trace_ring_buffer_s));
+	for (uint32_t i = 0; i < DISPATCH_TRACE_RING_BUFFER_COUNT - 1; i++) {
+		_dispatch_trace_ring_buffers[i].dtb_free_next = i + 2;
+	}
+	_dispatch_trace_ring_free_head = 1;
+
+	dtrh->dtrh_magic = DISPATCH_TRACE_RING_MAGIC;
+	dtrh->dtrh_version = DISPATCH_TRACE_RING_VERSION;
+	dtrh->dtrh_chunk_size = DISPATCH_TRACE_RING_CHUNK_SIZE;
+	dtrh->dtrh_chunk_count = size / DISPATCH_TRACE_RING_CHUNK_SIZE - 1;
+	dtrh->dtrh_pid = (uint64_t)getpid();
+	dtrh->dtrh_ts_base = dtrh->dtrh_ts_last = _dispatch_trace_ring_timestamp();
+	dtrh->dtrh_ns_base = dtrh->dtrh_ns_last = _dispatch_uptime();
+	_dispatch_trace_ring_file = dtrh;
+	_dispatch_trace_ring_size = size;
+
+	_dispatch_sema4_init(&_dispatch_trace_ring_sema, _DSEMA4_POLICY_FIFO);
+	_dispatch_sema4_create(&_dispatch_trace_ring_sema, _DSEMA4_POLICY_FIFO);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	r = pthread_create(&tid, &attr, _dispatch_trace_ring_drain_thread, NULL);
+	pthread_attr_destroy(&attr);
+	if (unlikely(r)) {
+		_dispatch_log("unable to create trace ring drain thread: %d", r);
+		return;
+	}
+	atexit(_dispatch_trace_ring_atexit);
+	os_atomic_store(&_dispatch_trace_ring_enabled, true, release);
+}
+
+void
+_dispatch_trace_ring_atfork_child(void)
+{
+	// the drain thread didn't survive the fork, and the file is the parent's
+	os_atomic_store(&_dispatch_trace_ring_enabled, false, relaxed);
+}
+
+#endif // DISPATCH_USE_TRACE_RING
+
+bool
+_dispatch_trace_ring_get_stats(dispatch_trace_ring_stats_s *stats)
+{
+#if DISPATCH_USE_TRACE_RING
+	if (os_atomic_load(&_dispatch_trace_ring_enabled, acquire)) {
+		dispatch_trace_ring_header_s *dtrh = _dispatch_trace_ring_file;
+		stats->dtrs_events = os_atomic_load(&dtrh->dtrh_events, relaxed);
+		stats->dtrs_dropped = os_atomic_load(&_dispatch_trace_ring_dropped,
+				relaxed);
+		stats->dtrs_chunks = os_atomic_load(&dtrh->dtrh_chunk_seq, relaxed);
+		return true;
+	}
+#endif
+	*stats = (dispatch_trace_ring_stats_s){ };
+	return false;
+}
+
+#pragma mark -
+#pragma mark chrome trace export
+
+static const char *const _dispatch_trace_ring_runtime_event_names[] = {
+	[dispatch_introspection_runtime_event_worker_event_delivery] =
+			"worker event delivery",
+	[dispatch_introspection_runtime_event_worker_unpark] = "worker unpark",
+	[dispatch_introspection_runtime_event_worker_request] = "worker request",
+	[dispatch_introspection_runtime_event_worker_park] = "worker park",
+	[dispatch_introspection_runtime_event_sync_wait] = "sync wait",
+	[dispatch_introspection_runtime_event_async_sync_handoff] =
+			"async sync handoff",
+	[dispatch_introspection_runtime_event_sync_sync_handoff] =
+			"sync sync handoff",
+	[dispatch_introspection_runtime_event_sync_async_handoff] =
+			"sync async handoff",
+};
+
+// Chrome trace timestamps are in microseconds since the ring was created,
+// the header has two samples of the event timebase to convert from
+static double
+_dispatch_trace_ring_chrome_ts(const dispatch_trace_ring_header_s *dtrh,
+		uint64_t ts)
+{
+	double delta = (double)(int64_t)(ts - dtrh->dtrh_ts_base);
+	if (dtrh->dtrh_ts_last > dtrh->dtrh_ts_base &&
+			dtrh->dtrh_ns_last > dtrh->dtrh_ns_base) {
+		delta *= (double)(dtrh->dtrh_ns_last - dtrh->dtrh_ns_base) /
+				(double)(dtrh->dtrh_ts_last - dtrh->dtrh_ts_base);
+	}
+	return delta / 1000.0;
+}
+
+static void
+_dispatch_trace_ring_chrome_prefix(FILE *f,
+		const dispatch_trace_ring_header_s *dtrh,
+		const dispatch_trace_ring_chunk_s *dtrc,
+		const dispatch_trace_ring_event_s *dtre)
+{
+	fprintf(f, ",\n{\"pid\":%llu,\"tid\":%llu,\"ts\":%.3f,",
+			(unsigned long long)dtrh->dtrh_pid,
+			(unsigned long long)dtrc->dtrc_thread,
+			_dispatch_trace_ring_chrome_ts(dtrh, dtre->dtre_timestamp));
+}
+
+static void
+_dispatch_trace_ring_chrome_event(FILE *f,
+		const dispatch_trace_ring_header_s *dtrh,
+		const dispatch_trace_ring_chunk_s *dtrc,
+		const dispatch_trace_ring_event_s *dtre)
+{
+	unsigned long long arg1 = dtre->dtre_arg1, arg2 = dtre->dtre_arg2;
+	const char *name = NULL;
+
+	switch (dtre->dtre_type) {
+	case DISPATCH_TRACE_RING_QUEUE_PUSH:
+		// flows need a slice to start from, pushes don't always happen
+		// from a callout
+		_dispatch_trace_ring_chrome_prefix(f, dtrh, dtrc, dtre);
+		fprintf(f, "\"ph\":\"X\",\"dur\":0,\"cat\":\"queue\","
+				"\"name\":\"enqueue\",\"args\":{\"queue\":\"0x%llx\","
+				"\"serial\":%u,\"item\":\"0x%llx\"}}",
+				arg1, dtre->dtre_arg3, arg2);
+		_dispatch_trace_ring_chrome_prefix(f, dtrh, dtrc, dtre);
+		fprintf(f, "\"ph\":\"s\",\"cat\":\"queue\",\"name\":\"item\","
+				"\"id\":\"0x%llx\"}", arg2);
+		break;
+	case DISPATCH_TRACE_RING_QUEUE_POP:
+		// binds to the next slice of the thread: the callout of the item
+		_dispatch_trace_ring_chrome_prefix(f, dtrh, dtrc, dtre);
+		fprintf(f, "\"ph\":\"f\",\"cat\":\"queue\",\"name\":\"item\","
+				"\"id\":\"0x%llx\"}", arg2);
+		break;
+	case DISPATCH_TRACE_RING_CALLOUT_ENTRY:
+		_dispatch_trace_ring_chrome_prefix(f, dtrh, dtrc, dtre);
+		fprintf(f, "\"ph\":\"B\",\"cat\":\"callout\",\"name\":\"0x%llx\","
+				"\"args\":{\"ctxt\":\"0x%llx\",\"serial\":%u}}",
+				arg1, arg2, dtre->dtre_arg3);
+		break;
+	case DISPATCH_TRACE_RING_CALLOUT_RETURN:
+		_dispatch_trace_ring_chrome_prefix(f, dtrh, dtrc, dtre);
+		fprintf(f, "\"ph\":\"E\"}");
+		break;
+	case DISPATCH_TRACE_RING_TIMER_PROGRAM:
+		_dispatch_trace_ring_chrome_prefix(f, dtrh, dtrc, dtre);
+		fprintf(f, "\"ph\":\"i\",\"s\":\"t\",\"cat\":\"timer\","
+				"\"name\":\"timer program\",\"args\":{\"timer\":\"0x%llx\","
+				"\"clock\":%u,\"delay_ns\":%llu}}",
+				arg1, dtre->dtre_arg3, arg2);
+		break;
+	case DISPATCH_TRACE_RING_TIMER_FIRE:
+		_dispatch_trace_ring_chrome_prefix(f, dtrh, dtrc, dtre);
+		fprintf(f, "\"ph\":\"i\",\"s\":\"t\",\"cat\":\"timer\","
+				"\"name\":\"timer fire\",\"args\":{\"timer\":\"0x%llx\","
+				"\"data\":%llu,\"missed\":%u}}",
+				arg1, arg2, dtre->dtre_arg3);
+		break;
+	case DISPATCH_TRACE_RING_RUNTIME_EVENT:
+		if (dtre->dtre_arg3 <
+				countof(_dispatch_trace_ring_runtime_event_names)) {
+			name = _dispatch_trace_ring_runtime_event_names[dtre->dtre_arg3];
+		}
+		_dispatch_trace_ring_chrome_prefix(f, dtrh, dtrc, dtre);
+		fprintf(f, "\"ph\":\"i\",\"s\":\"t\",\"cat\":\"worker\","
+				"\"name\":\"%s\",\"args\":{\"ptr\":\"0x%llx\","
+				"\"value\":%llu}}", name ? name : "runtime event", arg1, arg2);
+		break;
+	default:
+		break;
+	}
+}
+
+int
+_dispatch_trace_ring_export_chrome(const void *ring, size_t size, int fd)
+{
+	const dispatch_trace_ring_header_s *dtrh = ring;
+	const dispatch_trace_ring_chunk_s *dtrc;
+	uint64_t count, first, last;
+	FILE *f;
+	int dfd;
+
+	if (size < 2 * DISPATCH_TRACE_RING_CHUNK_SIZE ||
+			dtrh->dtrh_magic != DISPATCH_TRACE_RING_MAGIC ||
+			dtrh->dtrh_version != DISPATCH_TRACE_RING_VERSION ||
+			dtrh->dtrh_chunk_size != DISPATCH_TRACE_RING_CHUNK_SIZE ||
+			dtrh->dtrh_chunk_count == 0 || dtrh->dtrh_chunk_count >
+			size / DISPATCH_TRACE_RING_CHUNK_SIZE - 1) {
+		return EINVAL;
+	}
+	if ((dfd = dup(fd)) == -1) return errno;
+	if (!(f = fdopen(dfd, "w"))) {
+		int err = errno;
+		close(dfd);
+		return err;
+	}
+
+	count = dtrh->dtrh_chunk_count;
+	last = dtrh->dtrh_chunk_seq;
+	first = last > count ? last - count : 0;
+
+	fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+			"{\"ph\":\"M\",\"pid\":%llu,\"name\":\"process_name\","
+			"\"args\":{\"name\":\"libdispatch [%llu]\"}}",
+			(unsigned long long)dtrh->dtrh_pid,
+			(unsigned long long)dtrh->dtrh_pid);
+	// chunks of a thread are in order, viewers sort events across threads
+	for (uint64_t seq = first; seq < last; seq++) {
+		dtrc = (const dispatch_trace_ring_chunk_s *)((const char *)ring +
+				DISPATCH_TRACE_RING_CHUNK_SIZE * (1 + seq % count));
+		if (dtrc->dtrc_seq != seq ||
+				dtrc->dtrc_count > DISPATCH_TRACE_RING_CHUNK_EVENTS) {
+			continue;
+		}
+		for (uint32_t i = 0; i < dtrc->dtrc_count; i++) {
+			_dispatch_trace_ring_chrome_event(f, dtrh, dtrc,
+					&dtrc->dtrc_events[i]);
+		}
+	}
+	fprintf(f, "\n],\"otherData\":{\"events\":%llu,\"dropped\":%llu}}\n",
+			(unsigned long long)dtrh->dtrh_events,
+			(unsigned long long)dtrh->dtrh_dropped);
+
+	if (ferror(f)) {
+		fclose(f);
+		return EIO;
+	}
+	return fclose(f) ? errno : 0;
+}
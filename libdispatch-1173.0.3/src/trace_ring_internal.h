@@ -0,0 +1,222 @@
+/*
+ * This source file is part of the Swift.org open source project
+ *
+ * Copyright (c) 2026 Apple Inc. and the Swift project authors
+ *
+ * Licensed under Apache License v2.0 with Runtime Library Exception
+ *
+ * See https://swift.org/LICENSE.txt for license information
+ * See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+ *
+ */
+
+/*
+ * IMPORTANT: This header file describes INTERNAL interfaces to libdispatch
+ * which are subject to change in future releases of Mac OS X. Any applications
+ * relying on these interfaces WILL break.
+ */
+
+#ifndef __DISPATCH_TRACE_RING_INTERNAL__
+#define __DISPATCH_TRACE_RING_INTERNAL__
+
+#include "trace_ring_private.h"
+
+#if DISPATCH_USE_TRACE_RING
+
+/*
+ * Each thread fills a buffer from a fixed pool without any atomic other than
+ * the release of its event count. Full buffers are handed to the drain thread
+ * on a lock-free list, and come back to the pool once written to the file.
+ * The drain thread also picks up the tail of the buffers still being filled,
+ * so that idle threads don't hold on to their events forever.
+ */
+typedef struct dispatch_trace_ring_buffer_s {
+	struct dispatch_trace_ring_buffer_s *volatile dtb_full_next;
+	os_atomic(uint32_t) dtb_free_next; // index + 1 of the next free buffer
+	os_atomic(uint32_t) dtb_count;
+	uint32_t dtb_drained; // only touched by the drain thread
+	uint32_t dtb_cpu;
+	uint64_t dtb_thread;
+	dispatch_trace_ring_event_s dtb_events[DISPATCH_TRACE_RING_CHUNK_EVENTS];
+} *dispatch_trace_ring_buffer_t;
+
+extern bool _dispatch_trace_ring_enabled;
+
+void _dispatch_trace_ring_init(void);
+void _dispatch_trace_ring_atfork_child(void);
+void DISPATCH_TSD_DTOR_CC _dispatch_trace_ring_thread_cleanup(void *ctxt);
+dispatch_trace_ring_buffer_t _dispatch_trace_ring_buffer_refill(
+		dispatch_trace_ring_buffer_t dtb);
+
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_trace_ring_is_enabled(void)
+{
+	return unlikely(os_atomic_load(&_dispatch_trace_ring_enabled, relaxed));
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline uint64_t
+_dispatch_trace_ring_timestamp(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+	uint64_t t;
+	__asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (t));
+	return t;
+#else
+	return _dispatch_uptime();
+#endif
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_trace_ring_record(dispatch_trace_ring_event_type_t type,
+		uint64_t arg1, uint64_t arg2, uint32_t arg3)
+{
+	dispatch_trace_ring_buffer_t dtb;
+	dispatch_trace_ring_event_s *dtre;
+	uint32_t count;
+
+	dtb = _dispatch_thread_getspecific(dispatch_trace_ring_key);
+	if (unlikely(!dtb || os_atomic_load(&dtb->dtb_count, relaxed) ==
+			DISPATCH_TRACE_RING_CHUNK_EVENTS)) {
+		dtb = _dispatch_trace_ring_buffer_refill(dtb);
+		if (unlikely(!dtb)) return;
+	}
+	count = os_atomic_load(&dtb->dtb_count, relaxed);
+	dtre = &dtb->dtb_events[count];
+	dtre->dtre_timestamp = _dispatch_trace_ring_timestamp();
+	dtre->dtre_arg1 = arg1;
+	dtre->dtre_arg2 = arg2;
+	dtre->dtre_type = type;
+	dtre->dtre_arg3 = arg3;
+	os_atomic_store(&dtb->dtb_count, count + 1, release);
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline uint32_t
+_dispatch_trace_ring_queue_serialnum(dispatch_queue_t dq)
+{
+	return dq ? (uint32_t)dq->dq_serialnum : 0;
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_trace_ring_item_push(dispatch_queue_class_t dqu, dispatch_object_t dou)
+{
+	if (_dispatch_trace_ring_is_enabled()) {
+		_dispatch_trace_ring_record(DISPATCH_TRACE_RING_QUEUE_PUSH,
+				(uintptr_t)dqu._dq, (uintptr_t)dou._do,
+				_dispatch_trace_ring_queue_serialnum(dqu._dq));
+	}
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_trace_ring_item_push_list(dispatch_queue_global_t dq,
+		dispatch_object_t _head, dispatch_object_t _tail)
+{
+	if (_dispatch_trace_ring_is_enabled()) {
+		struct dispatch_object_s *dou = _head._do;
+		do {
+			_dispatch_trace_ring_record(DISPATCH_TRACE_RING_QUEUE_PUSH,
+					(uintptr_t)dq, (uintptr_t)dou,
+					_dispatch_trace_ring_queue_serialnum(dq->_as_dq));
+		} while (dou != _tail._do && (dou = dou->do_next));
+	}
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_trace_ring_item_pop(dispatch_queue_class_t dqu, dispatch_object_t dou)
+{
+	if (_dispatch_trace_ring_is_enabled()) {
+		_dispatch_trace_ring_record(DISPATCH_TRACE_RING_QUEUE_POP,
+				(uintptr_t)dqu._dq, (uintptr_t)dou._do,
+				_dispatch_trace_ring_queue_serialnum(dqu._dq));
+	}
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_trace_ring_callout(dispatch_trace_ring_event_type_t type,
+		void *ctxt, dispatch_function_t f)
+{
+	if (_dispatch_trace_ring_is_enabled()) {
+		dispatch_queue_t dq = _dispatch_queue_get_current();
+		_dispatch_trace_ring_record(type, (uintptr_t)f, (uintptr_t)ctxt,
+				_dispatch_trace_ring_queue_serialnum(dq));
+	}
+}
+
+#define _dispatch_trace_ring_callout_entry(ctxt, f) \
+		_dispatch_trace_ring_callout(DISPATCH_TRACE_RING_CALLOUT_ENTRY, \
+				ctxt, f)
+#define _dispatch_trace_ring_callout_return(ctxt, f) \
+		_dispatch_trace_ring_callout(DISPATCH_TRACE_RING_CALLOUT_RETURN, \
+				ctxt, f)
+
+// `delay` is relative to now, in the units of the clock of the timer
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_trace_ring_timer_program(dispatch_timer_source_refs_t dr,
+		uint64_t delay)
+{
+	if (_dispatch_trace_ring_is_enabled() && dr) {
+		dispatch_clock_t clock = DISPATCH_TIMER_CLOCK(dr->du_ident);
+		if (clock != DISPATCH_CLOCK_WALL) {
+			delay = _dispatch_time_mach2nano(delay);
+		}
+		_dispatch_trace_ring_record(DISPATCH_TRACE_RING_TIMER_PROGRAM,
+				(uintptr_t)dr, delay, clock);
+	}
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_trace_ring_timer_fire(dispatch_timer_source_refs_t dr,
+		uint64_t data, uint64_t missed)
+{
+	if (_dispatch_trace_ring_is_enabled() && dr) {
+		_dispatch_trace_ring_record(DISPATCH_TRACE_RING_TIMER_FIRE,
+				(uintptr_t)dr, data, (uint32_t)missed);
+	}
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_trace_ring_runtime_event(enum dispatch_introspection_runtime_event evt,
+		const void *ptr, uint64_t value)
+{
+	if (_dispatch_trace_ring_is_enabled()) {
+		_dispatch_trace_ring_record(DISPATCH_TRACE_RING_RUNTIME_EVENT,
+				(uintptr_t)ptr, value, evt);
+	}
+}
+
+#else
+
+#define _dispatch_trace_ring_init() ((void)0)
+#define _dispatch_trace_ring_atfork_child() ((void)0)
+#define _dispatch_trace_ring_item_push(dq, dou) \
+		do { (void)(dq); (void)(dou); } while(0)
+#define _dispatch_trace_ring_item_push_list(dq, head, tail) \
+		do { (void)(dq); (void)(head); (void)(tail); } while(0)
+#define _dispatch_trace_ring_item_pop(dq, dou) \
+		do { (void)(dq); (void)(dou); } while(0)
+#define _dispatch_trace_ring_callout_entry(ctxt, f) \
+		do { (void)(ctxt); (void)(f); } while(0)
+#define _dispatch_trace_ring_callout_return(ctxt, f) \
+		do { (void)(ctxt); (void)(f); } while(0)
+#define _dispatch_trace_ring_timer_program(dr, deadline) \
+		do { (void)(dr); (void)(deadline); } while(0)
+#define _dispatch_trace_ring_timer_fire(dr, data, missed) \
+		do { (void)(dr); (void)(data); (void)(missed); } while(0)
+#define _dispatch_trace_ring_runtime_event(evt, ptr, value) \
+		do { (void)(ptr); (void)(value); } while(0)
+
+#endif // DISPATCH_USE_TRACE_RING
+
+#endif // __DISPATCH_TRACE_RING_INTERNAL__
@@ -0,0 +1,218 @@
+/*
+ * This source file is part of the Swift.org open source project
+ *
+ * Copyright (c) 2026 Apple Inc. and the Swift project authors
+ *
+ * Licensed under Apache License v2.0 with Runtime Library Exception
+ *
+ * See https://swift.org/LICENSE.txt for license information
+ * See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+ *
+ */
+
+/*
+ * Usage: dispatch-trace-decode [-s] <file>
+ *        decodes a file written by a process run with
+ *        LIBDISPATCH_TRACE_RING=<file>, events of all threads are printed in
+ *        timestamp order, -s only prints the number of events of each type
+ *
+ *        LIBDISPATCH_TRACE_CHROME=<file> makes the process itself write the
+ *        same events in the Chrome trace event format when it exits
+ */
+
+#include "trace_ring_private.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct dtd_event_s {
+	dispatch_trace_ring_event_s dte_event;
+	uint64_t dte_thread;
+	uint32_t dte_cpu;
+} dtd_event_s;
+
+static const char *const dtd_event_names[] = {
+	[DISPATCH_TRACE_RING_QUEUE_PUSH] = "queue-push",
+	[DISPATCH_TRACE_RING_QUEUE_POP] = "queue-pop",
+	[DISPATCH_TRACE_RING_CALLOUT_ENTRY] = "callout-entry",
+	[DISPATCH_TRACE_RING_CALLOUT_RETURN] = "callout-return",
+	[DISPATCH_TRACE_RING_TIMER_PROGRAM] = "timer-program",
+	[DISPATCH_TRACE_RING_TIMER_FIRE] = "timer-fire",
+	[DISPATCH_TRACE_RING_RUNTIME_EVENT] = "runtime-event",
+};
+#define DTD_EVENT_TYPE_COUNT \
+		(sizeof(dtd_event_names) / sizeof(dtd_event_names[0]))
+
+// values of enum dispatch_introspection_runtime_event
+static const char *const dtd_runtime_event_names[] = {
+	[1] = "worker-event-delivery",
+	[2] = "worker-unpark",
+	[3] = "worker-request",
+	[4] = "worker-park",
+	[10] = "sync-wait",
+	[11] = "async-sync-handoff",
+	[12] = "sync-sync-handoff",
+	[13] = "sync-async-handoff",
+};
+
+static int
+dtd_event_cmp(const void *a, const void *b)
+{
+	uint64_t ta = ((const dtd_event_s *)a)->dte_event.dtre_timestamp;
+	uint64_t tb = ((const dtd_event_s *)b)->dte_event.dtre_timestamp;
+	return ta < tb ? -1 : ta > tb;
+}
+
+// Timestamps are converted to nanoseconds since the file was created, using
+// the two clock samples of the header
+static double
+dtd_ns(const dispatch_trace_ring_header_s *dtrh, uint64_t ts)
+{
+	double delta = (double)(int64_t)(ts - dtrh->dtrh_ts_base);
+	if (dtrh->dtrh_ts_last > dtrh->dtrh_ts_base &&
+			dtrh->dtrh_ns_last > dtrh->dtrh_ns_base) {
+		delta *= (double)(dtrh->dtrh_ns_last - dtrh->dtrh_ns_base) /
+				(double)(dtrh->dtrh_ts_last - dtrh->dtrh_ts_base);
+	}
+	return delta;
+}
+
+static void
+dtd_print(const dispatch_trace_ring_header_s *dtrh, const dtd_event_s *dte)
+{
+	const dispatch_trace_ring_event_s *dtre = &dte->dte_event;
+	const char *name = "unknown";
+
+	if (dtre->dtre_type < DTD_EVENT_TYPE_COUNT &&
+			dtd_event_names[dtre->dtre_type]) {
+		name = dtd_event_names[dtre->dtre_type];
+	}
+	printf("%14.3f us  %-8" PRIu64 " %-4u %-15s ",
+			dtd_ns(dtrh, dtre->dtre_timestamp) / 1000.0, dte->dte_thread,
+			dte->dte_cpu, name);
+
+	switch (dtre->dtre_type) {
+	case DISPATCH_TRACE_RING_QUEUE_PUSH:
+	case DISPATCH_TRACE_RING_QUEUE_POP:
+		printf("queue 0x%-14" PRIx64 " #%-6u item 0x%" PRIx64 "\n",
+				dtre->dtre_arg1, dtre->dtre_arg3, dtre->dtre_arg2);
+		break;
+	case DISPATCH_TRACE_RING_CALLOUT_ENTRY:
+	case DISPATCH_TRACE_RING_CALLOUT_RETURN:
+		printf("func  0x%-14" PRIx64 " #%-6u ctxt 0x%" PRIx64 "\n",
+				dtre->dtre_arg1, dtre->dtre_arg3, dtre->dtre_arg2);
+		break;
+	case DISPATCH_TRACE_RING_TIMER_PROGRAM:
+		printf("timer 0x%-14" PRIx64 " clock %u delay %" PRIu64 " ns\n",
+				dtre->dtre_arg1, dtre->dtre_arg3, dtre->dtre_arg2);
+		break;
+	case DISPATCH_TRACE_RING_TIMER_FIRE:
+		printf("timer 0x%-14" PRIx64 " data %" PRIu64 " missed %u\n",
+				dtre->dtre_arg1, dtre->dtre_arg2, dtre->dtre_arg3);
+		break;
+	case DISPATCH_TRACE_RING_RUNTIME_EVENT:
+		name = "unknown";
+		if (dtre->dtre_arg3 < sizeof(dtd_runtime_event_names) /
+				sizeof(dtd_runtime_event_names[0]) &&
+				dtd_runtime_event_names[dtre->dtre_arg3]) {
+			name = dtd_runtime_event_names[dtre->dtre_arg3];
+		}
+		printf("%-21s ptr 0x%" PRIx64 " value %" PRIu64 "\n",
+				name, dtre->dtre_arg1, dtre->dtre_arg2);
+		break;
+	default:
+		printf("0x%" PRIx64 " 0x%" PRIx64 " 0x%x\n",
+				dtre->dtre_arg1, dtre->dtre_arg2, dtre->dtre_arg3);
+		break;
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	dispatch_trace_ring_header_s dtrh;
+	dispatch_trace_ring_chunk_s dtrc;
+	uint64_t counts[DTD_EVENT_TYPE_COUNT + 1] = { 0 };
+	uint64_t first, torn = 0;
+	dtd_event_s *events = NULL;
+	size_t n = 0, cap = 0;
+	bool summary = false;
+	FILE *f;
+
+	if (argc == 3 && strcmp(argv[1], "-s") == 0) {
+		summary = true;
+		argv++, argc--;
+	}
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s [-s] <file>\n", argv[0]);
+		return 2;
+	}
+	if (!(f = fopen(argv[1], "rb"))) {
+		perror(argv[1]);
+		return 1;
+	}
+	if (fread(&dtrh, sizeof(dtrh), 1, f) != 1 ||
+			dtrh.dtrh_magic != DISPATCH_TRACE_RING_MAGIC ||
+			dtrh.dtrh_version != DISPATCH_TRACE_RING_VERSION ||
+			dtrh.dtrh_chunk_size != DISPATCH_TRACE_RING_CHUNK_SIZE ||
+			dtrh.dtrh_chunk_count == 0) {
+		fprintf(stderr, "%s: not a dispatch trace ring file\n", argv[1]);
+		return 1;
+	}
+
+	// once the ring wrapped, only the last dtrh_chunk_count chunks are left
+	first = dtrh.dtrh_chunk_seq > dtrh.dtrh_chunk_count ?
+			dtrh.dtrh_chunk_seq - dtrh.dtrh_chunk_count : 0;
+	for (uint64_t seq = first; seq < dtrh.dtrh_chunk_seq; seq++) {
+		long off = (long)(DISPATCH_TRACE_RING_CHUNK_SIZE *
+				(1 + seq % dtrh.dtrh_chunk_count));
+		if (fseek(f, off, SEEK_SET) || fread(&dtrc, sizeof(dtrc), 1, f) != 1) {
+			break;
+		}
+		// overwritten while the process was still running
+		if (dtrc.dtrc_seq != seq ||
+				dtrc.dtrc_count > DISPATCH_TRACE_RING_CHUNK_EVENTS) {
+			torn++;
+			continue;
+		}
+		for (uint32_t i = 0; i < dtrc.dtrc_count; i++) {
+			uint32_t type = dtrc.dtrc_events[i].dtre_type;
+			counts[type < DTD_EVENT_TYPE_COUNT ? type : 0]++;
+			if (summary) continue;
+			if (n == cap) {
+				cap = cap ? 2 * cap : 4096;
+				if (!(events = realloc(events, cap * sizeof(*events)))) {
+					perror("realloc");
+					return 1;
+				}
+			}
+			events[n++] = (dtd_event_s){
+				.dte_event = dtrc.dtrc_events[i],
+				.dte_thread = dtrc.dtrc_thread,
+				.dte_cpu = dtrc.dtrc_cpu,
+			};
+		}
+	}
+	fclose(f);
+
+	fprintf(stderr, "pid %" PRIu64 ": %" PRIu64 " events, %" PRIu64
+			" dropped, %" PRIu64 " chunks overwritten, %" PRIu64 " torn\n",
+			dtrh.dtrh_pid, dtrh.dtrh_events, dtrh.dtrh_dropped, first, torn);
+	if (summary) {
+		for (uint32_t type = 1; type < DTD_EVENT_TYPE_COUNT; type++) {
+			printf("%-15s %" PRIu64 "\n", dtd_event_names[type], counts[type]);
+		}
+		if (counts[0]) printf("%-15s %" PRIu64 "\n", "unknown", counts[0]);
+		return 0;
+	}
+
+	qsort(events, n, sizeof(*events), dtd_event_cmp);
+	for (size_t i = 0; i < n; i++) {
+		dtd_print(&dtrh, &events[i]);
+	}
+	free(events);
+	return 0;
+}